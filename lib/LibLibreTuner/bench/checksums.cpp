@@ -0,0 +1,56 @@
+/* Throughput of the checksum kernels over a calibration-sized buffer in
+ * GB/s. The word sum is measured with every instruction set the CPU
+ * supports; the scalar one is the reference. */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "support/checksumkernels.h"
+
+using namespace lt;
+
+namespace
+{
+
+constexpr std::size_t Size = 1 << 20;
+constexpr int Repeats = 200;
+
+// Keeps results alive so the compiler cannot drop the work
+volatile uint32_t sink;
+
+template <typename Func> void run(const char * name, Func && func)
+{
+    func();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < Repeats; ++i)
+        sink = func();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    double gbs = static_cast<double>(Size) * Repeats / elapsed.count() / 1e9;
+    std::printf("%-12s %8.2f\n", name, gbs);
+}
+
+} // namespace
+
+int main()
+{
+    std::vector<uint8_t> data(Size);
+    for (std::size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>(i * 31 + (i >> 7));
+    const uint8_t * p = data.data();
+
+    std::printf("GB/s over %zu bytes\n", Size);
+    std::printf("%-12s %8s\n", "algorithm", "GB/s");
+    run("sum32", [&] { return checksum::sum32BE(p, Size / 4); });
+    run("sum32-scalar", [&] { return checksum::sum32BEScalar(p, Size / 4); });
+    if (checksum::supportedIsa() >= checksum::Isa::SSE2)
+        run("sum32-sse2", [&] { return checksum::sum32BE(p, Size / 4, checksum::Isa::SSE2); });
+    if (checksum::supportedIsa() >= checksum::Isa::AVX2)
+        run("sum32-avx2", [&] { return checksum::sum32BE(p, Size / 4, checksum::Isa::AVX2); });
+    run("sum16", [&] { return static_cast<uint32_t>(checksum::sum16BE(p, Size / 2)); });
+    run("xor32", [&] { return checksum::xor32BE(p, Size / 4); });
+    run("crc32", [&] { return checksum::crc32(p, Size); });
+    run("crc16", [&] { return static_cast<uint32_t>(checksum::crc16(p, Size)); });
+    return 0;
+}
@@ -0,0 +1,104 @@
+/* Microbenchmark of whole-table operations for every stored type,
+ * endianness and presented type. Compares the per-cell path (virtual
+ * get()/set() per entry) with the typed range kernels. */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "rom/table.h"
+
+using namespace lt;
+
+namespace
+{
+
+constexpr int EntryCount = 1 << 16;
+constexpr int Repeats = 50;
+
+// Keeps results alive so the compiler cannot drop the work
+volatile double sink;
+
+template <typename Func> double measure(Func && func)
+{
+    func();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < Repeats; ++i)
+        func();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / (static_cast<double>(Repeats) * EntryCount);
+}
+
+const char * endiannessName(Endianness endianness)
+{
+    return endianness == Endianness::Big ? "big" : "little";
+}
+
+template <typename P, typename T, Endianness endianness> void run(const char * typeName, const char * presentedName)
+{
+    std::vector<uint8_t> data(EntryCount * sizeof(T) * 2 + 1);
+    for (std::size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>(i * 31);
+    MemoryBuffer buffer(std::move(data));
+
+    EntriesImpl<P, T, endianness> entries(buffer.view(0, EntryCount * sizeof(T)));
+    EntriesImpl<P, T, endianness> base(buffer.view(EntryCount * sizeof(T), EntryCount * sizeof(T)));
+    // Tables only see Entries<P>; keep the compiler from devirtualizing
+    Entries<P> * volatile handle = &entries;
+    Entries<P> & virt = *handle;
+    const Affine transform{0.5, 10.0};
+
+    std::vector<P> values(EntryCount);
+    std::vector<uint8_t> mask(EntryCount);
+
+    double cellGet = measure([&] {
+        for (int i = 0; i < EntryCount; ++i)
+            values[i] = static_cast<P>(transform.apply(virt.get(i)));
+        sink = values[EntryCount - 1];
+    });
+    double decode = measure([&] {
+        virt.decodeRange(0, EntryCount, values.data(), transform);
+        sink = values[EntryCount - 1];
+    });
+    double cellSet = measure([&] {
+        for (int i = 0; i < EntryCount; ++i)
+            virt.set(i, static_cast<P>(transform.invert(values[i])));
+    });
+    double encode = measure([&] { virt.encodeRange(0, EntryCount, values.data(), transform); });
+    double fill = measure([&] { virt.fillRange(0, EntryCount, static_cast<P>(42), transform); });
+    double add = measure([&] { virt.scaleOffsetRange(0, EntryCount, 1.0, 0.0, transform); });
+    double copy = measure([&] { virt.copyRange(base, 0, EntryCount); });
+    double compare = measure([&] { sink = static_cast<double>(virt.compareRange(base, 0, EntryCount, mask.data())); });
+
+    std::printf("%-7s %-6s %-6s %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f\n", typeName,
+                endiannessName(endianness), presentedName, cellGet, decode, cellSet, encode, fill, add, copy,
+                compare);
+}
+
+template <typename P, Endianness endianness> void runTypes(const char * presentedName)
+{
+    run<P, uint8_t, endianness>("uint8", presentedName);
+    run<P, uint16_t, endianness>("uint16", presentedName);
+    run<P, uint32_t, endianness>("uint32", presentedName);
+    run<P, int8_t, endianness>("int8", presentedName);
+    run<P, int16_t, endianness>("int16", presentedName);
+    run<P, int32_t, endianness>("int32", presentedName);
+    run<P, float, endianness>("float", presentedName);
+}
+
+} // namespace
+
+int main()
+{
+    std::printf("ns per entry, %d entries\n", EntryCount);
+    std::printf("%-7s %-6s %-6s %9s %9s %9s %9s %9s %9s %9s %9s\n", "stored", "endian", "shown", "get", "decode",
+                "set", "encode", "fill", "add", "copy", "compare");
+
+    runTypes<double, Endianness::Big>("double");
+    runTypes<double, Endianness::Little>("double");
+    runTypes<float, Endianness::Big>("float");
+    runTypes<float, Endianness::Little>("float");
+    return 0;
+}
@@ -0,0 +1,213 @@
+#include "journal.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+namespace lt
+{
+
+std::size_t EditJournal::Entry::memoryUsage() const noexcept
+{
+    std::size_t usage = sizeof(Entry);
+    for (const Span & span : spans)
+        usage += sizeof(Span) + span.before.size() + span.after.size();
+    return usage;
+}
+
+EditJournal::EditJournal(MemoryBuffer & buffer, std::size_t limit) : buffer_(buffer), limit_(limit)
+{
+    buffer_.addObserver(this);
+}
+
+EditJournal::~EditJournal() { buffer_.removeObserver(this); }
+
+void EditJournal::beginGroup()
+{
+    if (depth_++ == 0 && pending_)
+        seal();
+}
+
+void EditJournal::endGroup()
+{
+    if (depth_ == 0)
+        return;
+    if (--depth_ == 0 && pending_)
+        seal();
+}
+
+void EditJournal::flush()
+{
+    if (depth_ == 0 && pending_)
+        seal();
+}
+
+void EditJournal::beforeWrite(const MemoryBuffer & buffer, int offset, int size)
+{
+    assert(&buffer == &buffer_);
+    assert(offset >= 0 && size >= 0 && offset + size <= buffer.size());
+    if (size == 0)
+        return;
+
+    if (depth_ == 0 && pending_)
+        seal();
+    if (!pending_)
+    {
+        pending_ = true;
+        current_.spans.clear();
+        // A new edit invalidates the undone entries
+        for (const Entry & entry : redo_)
+            memoryUsage_ -= entry.memoryUsage();
+        redo_.clear();
+    }
+
+    // Spans touching or overlapping [offset, offset + size) are merged
+    // with the new range
+    auto & spans = current_.spans;
+    int end = offset + size;
+    auto first = std::lower_bound(spans.begin(), spans.end(), offset,
+                                  [](const Span & span, int value) { return span.end() < value; });
+    auto last = std::upper_bound(first, spans.end(), end,
+                                 [](int value, const Span & span) { return value < span.offset; });
+    if (first != last)
+    {
+        offset = std::min(offset, first->offset);
+        end = std::max(end, std::prev(last)->end());
+    }
+
+    Span merged;
+    merged.offset = offset;
+    merged.before.assign(buffer_.data() + offset, buffer_.data() + end);
+    // Keep the original bytes of ranges written earlier in this entry
+    for (auto it = first; it != last; ++it)
+        std::copy(it->before.begin(), it->before.end(), merged.before.begin() + (it->offset - offset));
+
+    auto pos = spans.erase(first, last);
+    spans.insert(pos, std::move(merged));
+}
+
+EditJournal::Entry EditJournal::sealed(const Entry & entry) const
+{
+    Entry result;
+    for (const Span & span : entry.spans)
+    {
+        const uint8_t * current = buffer_.data() + span.offset;
+        if (std::equal(span.before.begin(), span.before.end(), current))
+            continue;
+        Span & copy = result.spans.emplace_back(span);
+        copy.after.assign(current, current + span.size());
+    }
+    return result;
+}
+
+void EditJournal::seal()
+{
+    Entry entry = sealed(current_);
+    current_.spans.clear();
+    pending_ = false;
+
+    // Writes that did not change anything are not worth an undo step
+    if (entry.spans.empty())
+        return;
+    memoryUsage_ += entry.memoryUsage();
+    undo_.emplace_back(std::move(entry));
+    trim();
+}
+
+void EditJournal::trim()
+{
+    // The newest entry is kept even if it alone exceeds the limit
+    while (memoryUsage_ > limit_ && undo_.size() + redo_.size() > 1 && !undo_.empty())
+    {
+        memoryUsage_ -= undo_.front().memoryUsage();
+        undo_.pop_front();
+    }
+}
+
+void EditJournal::setLimit(std::size_t limit)
+{
+    limit_ = limit;
+    trim();
+}
+
+void EditJournal::clear() noexcept
+{
+    undo_.clear();
+    redo_.clear();
+    current_.spans.clear();
+    pending_ = false;
+    memoryUsage_ = 0;
+}
+
+void EditJournal::apply(const Entry & entry, bool forward)
+{
+    // Writes go around the views and only notify the other observers, so
+    // they are not recorded
+    for (const Span & span : entry.spans)
+    {
+        const std::vector<uint8_t> & bytes = forward ? span.after : span.before;
+        buffer_.beforeWrite(span.offset, span.size(), this);
+        std::memcpy(buffer_.data() + span.offset, bytes.data(), bytes.size());
+    }
+}
+
+bool EditJournal::undo()
+{
+    if (depth_ != 0)
+        throw std::runtime_error("cannot undo while an edit group is open");
+    flush();
+    if (undo_.empty())
+        return false;
+
+    Entry entry = std::move(undo_.back());
+    undo_.pop_back();
+    apply(entry, false);
+    redo_.emplace_back(std::move(entry));
+    applied_();
+    return true;
+}
+
+bool EditJournal::redo()
+{
+    if (depth_ != 0)
+        throw std::runtime_error("cannot redo while an edit group is open");
+    flush();
+    if (redo_.empty())
+        return false;
+
+    Entry entry = std::move(redo_.back());
+    redo_.pop_back();
+    apply(entry, true);
+    undo_.emplace_back(std::move(entry));
+    applied_();
+    return true;
+}
+
+uint64_t EditJournal::fingerprint() const noexcept
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    const uint8_t * data = buffer_.data();
+    for (int i = 0; i < buffer_.size(); ++i)
+    {
+        hash ^= data[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+bool EditJournal::valid(const std::vector<Entry> & entries) const noexcept
+{
+    for (const Entry & entry : entries)
+    {
+        for (const Span & span : entry.spans)
+        {
+            if (span.offset < 0 || span.offset > buffer_.size() || span.before.size() != span.after.size() ||
+                span.before.size() > static_cast<std::size_t>(buffer_.size() - span.offset))
+                return false;
+        }
+    }
+    return true;
+}
+
+} // namespace lt
@@ -0,0 +1,184 @@
+#ifndef LT_JOURNAL_H
+#define LT_JOURNAL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "../support/event.h"
+#include "memorybuffer.h"
+
+namespace lt
+{
+
+/* Undo/redo history of a MemoryBuffer stored as byte-range deltas. The
+ * journal observes writes made through views of the buffer and records
+ * the bytes before and after each change. Writes to neighbouring or
+ * overlapping bytes within one entry are coalesced into a single span.
+ *
+ * Writes made inside a group form one entry. Outside of a group, every
+ * write starts a new entry. Undo and redo only touch the bytes recorded
+ * in the entry. The oldest entries are dropped when the history grows
+ * beyond the memory limit. */
+class EditJournal : public WriteObserver
+{
+public:
+    // Default memory limit of the history in bytes
+    static constexpr std::size_t DefaultLimit = 16 * 1024 * 1024;
+
+    // Bytes at `offset` before and after an edit
+    struct Span
+    {
+        int offset{0};
+        std::vector<uint8_t> before;
+        std::vector<uint8_t> after;
+
+        inline int size() const noexcept { return static_cast<int>(before.size()); }
+        inline int end() const noexcept { return offset + size(); }
+
+        template <class Archive> void serialize(Archive & archive) { archive(offset, before, after); }
+    };
+
+    // One undo step. Spans are sorted and do not touch.
+    struct Entry
+    {
+        std::vector<Span> spans;
+
+        std::size_t memoryUsage() const noexcept;
+
+        template <class Archive> void serialize(Archive & archive) { archive(spans); }
+    };
+
+    // Groups all writes during its lifetime into one entry
+    class Group
+    {
+    public:
+        explicit Group(EditJournal & journal) : journal_(&journal) { journal_->beginGroup(); }
+        Group(const Group &) = delete;
+        Group(Group && other) noexcept : journal_(other.journal_) { other.journal_ = nullptr; }
+        Group & operator=(const Group &) = delete;
+        Group & operator=(Group &&) = delete;
+        ~Group()
+        {
+            if (journal_ != nullptr)
+                journal_->endGroup();
+        }
+
+    private:
+        EditJournal * journal_;
+    };
+
+    explicit EditJournal(MemoryBuffer & buffer, std::size_t limit = DefaultLimit);
+    ~EditJournal() override;
+
+    EditJournal(const EditJournal &) = delete;
+    EditJournal & operator=(const EditJournal &) = delete;
+
+    // Starts a group that ends when the returned object is destroyed
+    inline Group group() { return Group(*this); }
+
+    // Groups may be nested; the entry is sealed when the outermost ends
+    void beginGroup();
+    void endGroup();
+
+    inline bool canUndo() const noexcept { return pending_ || !undo_.empty(); }
+    inline bool canRedo() const noexcept { return !pending_ && !redo_.empty(); }
+
+    /* Reverts the last entry. Returns false if there is nothing to
+     * undo. Must not be called inside a group. */
+    bool undo();
+    // Reapplies the last undone entry. Returns false if there is none.
+    bool redo();
+
+    // Removes all history
+    void clear() noexcept;
+
+    // Approximate memory used by the history in bytes
+    inline std::size_t memoryUsage() const noexcept { return memoryUsage_; }
+
+    inline std::size_t limit() const noexcept { return limit_; }
+    // Sets the memory limit and drops old entries that no longer fit
+    void setLimit(std::size_t limit);
+
+    // Seals the entry that is being recorded outside of a group
+    void flush();
+
+    // Returns an FNV-1a hash of the buffer. Used to check that a saved
+    // history belongs to the data it is loaded for.
+    uint64_t fingerprint() const noexcept;
+
+    inline MemoryBuffer & buffer() const noexcept { return buffer_; }
+
+    // Called after undo() or redo() changed the buffer
+    template <typename F> Event<>::ConnectionPtr onApplied(F && f) noexcept
+    {
+        return applied_.connect(std::forward<F>(f));
+    }
+
+    // WriteObserver
+    void beforeWrite(const MemoryBuffer & buffer, int offset, int size) override;
+
+    /* Serializes the history with the size and fingerprint of the buffer.
+     * An entry being recorded is written as if it were sealed. */
+    template <class Archive> void save(Archive & archive, std::uint32_t const /*version*/) const
+    {
+        std::vector<Entry> undo(undo_.begin(), undo_.end());
+        if (pending_)
+            undo.emplace_back(sealed(current_));
+        archive(buffer_.size(), fingerprint(), undo, redo_);
+    }
+
+    /* Restores a history. If the buffer differs from the one it was saved
+     * for, the history is discarded and the journal is left empty. */
+    template <class Archive> void load(Archive & archive, std::uint32_t const /*version*/)
+    {
+        int size;
+        uint64_t hash;
+        std::vector<Entry> undo, redo;
+        archive(size, hash, undo, redo);
+
+        clear();
+        if (size != buffer_.size() || hash != fingerprint() || !valid(undo) || !valid(redo))
+            return;
+        for (Entry & entry : undo)
+        {
+            memoryUsage_ += entry.memoryUsage();
+            undo_.emplace_back(std::move(entry));
+        }
+        for (const Entry & entry : redo)
+            memoryUsage_ += entry.memoryUsage();
+        redo_ = std::move(redo);
+        trim();
+    }
+
+private:
+    // Returns a copy of `entry` with the current bytes as after-bytes
+    Entry sealed(const Entry & entry) const;
+    // Moves the pending entry onto the undo stack
+    void seal();
+    // Drops the oldest entries until the history fits the limit
+    void trim();
+    // Writes the before- or after-bytes of `entry` into the buffer
+    void apply(const Entry & entry, bool forward);
+    // Returns false if any span lies outside of the buffer
+    bool valid(const std::vector<Entry> & entries) const noexcept;
+
+    MemoryBuffer & buffer_;
+    std::size_t limit_;
+    std::size_t memoryUsage_{0};
+
+    std::deque<Entry> undo_;
+    std::vector<Entry> redo_;
+
+    // Entry being recorded
+    Entry current_;
+    bool pending_{false};
+    int depth_{0};
+
+    Event<> applied_;
+};
+
+} // namespace lt
+
+#endif // LT_JOURNAL_H
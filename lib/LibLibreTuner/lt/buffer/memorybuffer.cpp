@@ -1,12 +1,30 @@
 #include "memorybuffer.h"
 #include "view.h"
 
+#include <utility>
+
 namespace lt
 {
+MemoryBuffer & MemoryBuffer::operator=(MemoryBuffer && other) noexcept
+{
+    if (this != &other)
+    {
+        // Moving a vector keeps its storage, so `data_` stays valid
+        owned_ = std::move(other.owned_);
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        owner_ = std::move(other.owner_);
+        readOnly_ = std::exchange(other.readOnly_, false);
+        observers_ = std::exchange(other.observers_, {});
+        dirty_ = std::move(other.dirty_);
+    }
+    return *this;
+}
+
 View MemoryBuffer::view() { return View(*this, 0, size()); }
 
 View MemoryBuffer::view(int offset, int size)
 {
     return View(*this, offset, size);
 }
-}
\ No newline at end of file
+}
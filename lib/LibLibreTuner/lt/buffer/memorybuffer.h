@@ -1,61 +1,146 @@
 #ifndef LIBRETUNER_MEMORYBUFFER_H
 #define LIBRETUNER_MEMORYBUFFER_H
 
+#include <algorithm>
+#include <cassert>
 #include <vector>
 #include <cstdint>
 #include <memory>
+#include <stdexcept>
+
+#include "../support/intervalset.h"
 
 namespace lt
 {
 class View;
+class MemoryBuffer;
+
+// Notified before bytes of a MemoryBuffer are modified
+class WriteObserver
+{
+public:
+    virtual ~WriteObserver() = default;
+
+    // Called before `size` bytes at `offset` of `buffer` are written
+    virtual void beforeWrite(const MemoryBuffer & buffer, int offset, int size) = 0;
+};
 
+/* Byte buffer that either owns its data or refers to memory owned by
+ * someone else, such as a mapped file. */
 class MemoryBuffer
 {
 public:
-    using iterator = std::vector<uint8_t>::iterator;
-    using const_iterator = std::vector<uint8_t>::const_iterator;
+    using iterator = uint8_t *;
+    using const_iterator = const uint8_t *;
 
     MemoryBuffer(const MemoryBuffer&) = delete;
-    MemoryBuffer(MemoryBuffer&&) = default;
     MemoryBuffer & operator=(const MemoryBuffer&) = delete;
-    MemoryBuffer & operator=(MemoryBuffer&&) = default;
+    MemoryBuffer(MemoryBuffer && other) noexcept { *this = std::move(other); }
+    MemoryBuffer & operator=(MemoryBuffer && other) noexcept;
 
     MemoryBuffer() = default;
-    explicit MemoryBuffer(std::vector<uint8_t> && data) : data_(std::move(data))
+    // Observers must be removed before the buffer they watch is destroyed
+    ~MemoryBuffer() { assert(observers_.empty()); }
+    explicit MemoryBuffer(std::vector<uint8_t> && data) : owned_(std::move(data))
     {
+        reset();
     }
 
     template <typename It> MemoryBuffer(It begin, It end)
     {
         static_assert(sizeof(std::decay_t<decltype(*std::declval<It>())>) == 1,
                       "Iterator type must be byte");
-        data_.assign(begin, end);
+        owned_.assign(begin, end);
+        reset();
     }
 
-    inline iterator begin() { return data_.begin(); }
-    inline iterator end() { return data_.end(); }
-    inline const_iterator cbegin() const { return data_.cbegin(); }
-    inline const_iterator cend() const { return data_.cend(); }
+    /* Refers to `size` bytes at `data` without copying them. `owner` keeps
+     * the memory alive for as long as the buffer exists. Unless `writable`
+     * is true, the buffer is read-only: writing through a view throws
+     * std::runtime_error. Pass true only for memory private to the
+     * buffer, such as a copy-on-write mapping. */
+    MemoryBuffer(std::shared_ptr<const void> owner, const uint8_t * data, int size, bool writable = false)
+        : data_(const_cast<uint8_t *>(data)), size_(size), owner_(std::move(owner)), readOnly_(!writable)
+    {
+    }
+
+    inline iterator begin() { return data_; }
+    inline iterator end() { return data_ + size_; }
+    inline const_iterator cbegin() const { return data_; }
+    inline const_iterator cend() const { return data_ + size_; }
 
-    inline uint8_t * operator*() noexcept { return data_.data(); }
+    inline uint8_t * operator*() noexcept { return data_; }
     inline uint8_t & operator[](int index) { return data_[index]; }
     inline const uint8_t & operator[](int index) const { return data_[index]; }
 
-    inline int size() const noexcept { return static_cast<int>(data_.size()); }
-    inline uint8_t * data() noexcept { return data_.data(); }
-    inline const uint8_t * data() const noexcept { return data_.data(); }
+    inline int size() const noexcept { return size_; }
+    inline uint8_t * data() noexcept { return data_; }
+    inline const uint8_t * data() const noexcept { return data_; }
+
+    // Returns true if the data is owned elsewhere and must not be written
+    inline bool readOnly() const noexcept { return readOnly_; }
 
     View view();
     View view(int offset, int size);
 
+    /* Adds an observer notified before writes made through views.
+     * Observers are notified in the order they were added. */
+    inline void addObserver(WriteObserver * observer) { observers_.push_back(observer); }
+    inline void removeObserver(WriteObserver * observer) noexcept
+    {
+        observers_.erase(std::remove(observers_.begin(), observers_.end(), observer), observers_.end());
+    }
+
+    /* Marks `size` bytes at `offset` dirty and notifies the observers
+     * that they will be written. `source` is not notified; it is the
+     * observer making the write, if any. */
+    inline void beforeWrite(int offset, int size, const WriteObserver * source = nullptr)
+    {
+        if (readOnly_)
+            throw std::runtime_error("attempt to write to a read-only buffer");
+        markDirty(offset, size);
+        for (WriteObserver * observer : observers_)
+        {
+            if (observer != source)
+                observer->beforeWrite(*this, offset, size);
+        }
+    }
+
+    /* Ranges written through views since the last clearDirty().
+     * Writes through data() or operator[] are not tracked; use
+     * markDirty() for those. */
+    inline const IntervalSet & dirty() const noexcept { return dirty_; }
+    inline bool isDirty() const noexcept { return !dirty_.empty(); }
+    inline void clearDirty() noexcept { dirty_.clear(); }
+
+    // Marks `size` bytes at `offset` modified
+    inline void markDirty(int offset, int size) { dirty_.insert(offset, offset + size); }
+
+    // Reads the data as a byte vector, the layout of older files
     template <class Archive>
-    void serialize(Archive & archive)
+    void load(Archive & archive)
     {
-        archive(data_);
+        archive(owned_);
+        owner_.reset();
+        readOnly_ = false;
+        reset();
     }
 
 private:
-    std::vector<uint8_t> data_;
+    // Points the buffer at `owned_`
+    inline void reset() noexcept
+    {
+        data_ = owned_.data();
+        size_ = static_cast<int>(owned_.size());
+    }
+
+    std::vector<uint8_t> owned_;
+    uint8_t * data_{nullptr};
+    int size_{0};
+    std::shared_ptr<const void> owner_;
+    bool readOnly_{false};
+    std::vector<WriteObserver *> observers_;
+    IntervalSet dirty_;
 };
 } // namespace lt
 
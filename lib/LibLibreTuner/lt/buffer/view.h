@@ -38,6 +38,7 @@ public:
     {
         if (offset + static_cast<int>(sizeof(T)) > size())
             throw std::runtime_error("TuneView::get(): index out of range");
+        buffer_.beforeWrite(offset_ + offset, sizeof(T));
         auto it = std::next(buffer_.begin(), offset_ + offset);
 
         T val = endian::convert<T, endian::current, endianness>(t);
@@ -59,6 +60,18 @@ public:
     inline uint8_t * data() noexcept { return buffer_.data(); }
     inline const uint8_t * data() const noexcept { return buffer_.data(); }
 
+    // Returns a pointer to the first byte of the view
+    inline uint8_t * bytes() noexcept { return buffer_.data() + offset_; }
+    inline const uint8_t * bytes() const noexcept { return buffer_.data() + offset_; }
+
+    /* Returns a pointer for writing `size` bytes at `offset` of the view.
+     * Notifies the buffer's observer first. */
+    inline uint8_t * writeBytes(int offset, int size)
+    {
+        buffer_.beforeWrite(offset_ + offset, size);
+        return buffer_.data() + offset_ + offset;
+    }
+
     MemoryBuffer::iterator begin()
     {
         return std::next(buffer_.begin(), offset_);
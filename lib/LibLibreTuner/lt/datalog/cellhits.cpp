@@ -0,0 +1,262 @@
+/*
+ * LibreTuner
+ * Copyright (C) 2018 Altenius
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cellhits.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+
+#include "../rom/lookup.h"
+
+namespace lt
+{
+
+void CellStats::merge(const CellStats & other) noexcept
+{
+    hits += other.hits;
+    dwell += other.dwell;
+    sum += other.sum;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+}
+
+CellHits::CellHits(int width, int height)
+    : width_(width), height_(height), cells_(static_cast<std::size_t>(width * height))
+{
+}
+
+double CellHits::maxHits() const noexcept
+{
+    double hits = 0;
+    for (const CellStats & cell : cells_)
+        hits = std::max(hits, cell.hits);
+    return hits;
+}
+
+void CellHits::merge(const CellHits & other) noexcept
+{
+    for (std::size_t i = 0; i < cells_.size(); ++i)
+        cells_[i].merge(other.cells_[i]);
+    samples_ += other.samples_;
+    invalidSamples_ += other.invalidSamples_;
+}
+
+namespace
+{
+
+enum Role
+{
+    RoleX,
+    RoleY,
+    RoleValue,
+    RoleCount,
+};
+
+// A PID's samples, copied out of the log so it is not locked while
+// they are accumulated
+using Column = std::vector<PidLogEntry>;
+
+// The fewest driving samples worth a worker thread
+constexpr std::size_t MinPartSize = PidLogChunk::Capacity;
+
+// Accumulates a range of the driving PID's samples
+class Worker
+{
+public:
+    Worker(const Column * const (&columns)[RoleCount], int driver, const AxisBreakpoints & xPoints,
+           const AxisBreakpoints & yPoints, const CellHitOptions & options, CellHits & out)
+        : columns_(columns), driver_(driver), xPoints_(xPoints), yPoints_(yPoints), options_(options), out_(out)
+    {
+    }
+
+    void run(std::size_t first, std::size_t last)
+    {
+        const Column & driver = *columns_[driver_];
+        if (first >= last)
+            return;
+
+        // Start each held PID at its last sample at or before the first
+        // driving sample
+        for (int role = 0; role < RoleCount; ++role)
+        {
+            if (role == driver_ || columns_[role] == nullptr)
+                continue;
+            const Column & held = *columns_[role];
+            auto it = std::upper_bound(held.begin(), held.end(), driver[first].time,
+                                       [](std::size_t time, const PidLogEntry & entry) { return time < entry.time; });
+            cursors_[role] = it == held.begin() ? 0 : static_cast<std::size_t>(it - held.begin()) - 1;
+        }
+
+        // The last sample of the log is held for no time
+        for (std::size_t i = first; i < last; ++i)
+            add(driver[i], i + 1 < driver.size() ? driver[i + 1].time - driver[i].time : 0);
+    }
+
+private:
+    const Column * const (&columns_)[RoleCount];
+    int driver_;
+    const AxisBreakpoints & xPoints_;
+    const AxisBreakpoints & yPoints_;
+    const CellHitOptions & options_;
+    CellHits & out_;
+
+    std::size_t cursors_[RoleCount]{};
+    // Consecutive samples are usually in nearby cells
+    int xHint_{0}, yHint_{0};
+
+    void add(const PidLogEntry & entry, std::size_t gap)
+    {
+        double values[RoleCount]{};
+        values[driver_] = entry.value;
+        for (int role = 0; role < RoleCount; ++role)
+        {
+            if (role == driver_ || columns_[role] == nullptr)
+                continue;
+
+            const Column & held = *columns_[role];
+            std::size_t & cursor = cursors_[role];
+            if (held.empty() || held[cursor].time > entry.time)
+                return;
+            while (cursor + 1 < held.size() && held[cursor + 1].time <= entry.time)
+                ++cursor;
+            values[role] = held[cursor].value;
+        }
+
+        // Unused roles are 0
+        if (!std::isfinite(values[RoleX]) || !std::isfinite(values[RoleY]) || !std::isfinite(values[RoleValue]))
+        {
+            out_.addInvalidSamples(1);
+            return;
+        }
+
+        double dwell = static_cast<double>(std::min(gap, options_.maxGap));
+        double value = values[RoleValue];
+
+        if (!options_.clampToEdges && (!xPoints_.contains(values[RoleX]) || !yPoints_.contains(values[RoleY])))
+            return;
+
+        AxisBreakpoints::Segment column = xPoints_.find(values[RoleX], xHint_);
+        AxisBreakpoints::Segment row = yPoints_.find(values[RoleY], yHint_);
+        if (options_.bilinear)
+        {
+            addWeighted(row.lower, column.lower, (1.0 - row.weight) * (1.0 - column.weight), dwell, value);
+            addWeighted(row.lower, column.lower + 1, (1.0 - row.weight) * column.weight, dwell, value);
+            addWeighted(row.lower + 1, column.lower, row.weight * (1.0 - column.weight), dwell, value);
+            addWeighted(row.lower + 1, column.lower + 1, row.weight * column.weight, dwell, value);
+        }
+        else
+        {
+            out_.at(row.nearest(), column.nearest()).add(1.0, dwell, value);
+        }
+        out_.addSamples(1);
+    }
+
+    inline void addWeighted(int row, int column, double weight, double dwell, double value) noexcept
+    {
+        // Zero weights may point past the last cell of an axis
+        if (weight > 0)
+            out_.at(row, column).add(weight, dwell, value);
+    }
+};
+
+// Copies the samples of `pid` from `log`, which must be locked
+Column copyColumn(const DataLog & log, const Pid * pid)
+{
+    auto it = log.logs().find(pid->code);
+    if (it == log.logs().end())
+        throw std::runtime_error("PID '" + pid->name + "' is not in the log");
+
+    Column column;
+    column.reserve(it->second.size());
+    it->second.forEach([&column](const PidLogEntry & entry) { column.push_back(entry); });
+    return column;
+}
+
+} // namespace
+
+CellHits accumulateCellHits(const DataLog & log, const Table & table, const Pid & xPid, const Pid * yPid,
+                            const Pid * valuePid, const CellHitOptions & options)
+{
+    if (yPid == nullptr && table.height() > 1)
+        throw std::runtime_error("a Y axis PID is required for two-dimensional tables");
+
+    AxisBreakpoints xPoints(table.xAxis().get(), table.width());
+    AxisBreakpoints yPoints(table.yAxis().get(), table.height());
+
+    CellHits result(table.width(), table.height());
+    result.setHasValues(valuePid != nullptr);
+
+    // Only the copy holds the lock, so logging continues during the pass
+    Column copies[RoleCount];
+    {
+        auto lock = log.lock();
+        copies[RoleX] = copyColumn(log, &xPid);
+        if (yPid != nullptr)
+            copies[RoleY] = copyColumn(log, yPid);
+        if (valuePid != nullptr)
+            copies[RoleValue] = copyColumn(log, valuePid);
+    }
+
+    const Column * columns[RoleCount] = {&copies[RoleX], yPid != nullptr ? &copies[RoleY] : nullptr,
+                                         valuePid != nullptr ? &copies[RoleValue] : nullptr};
+    int driver = RoleX;
+    if (columns[RoleY] != nullptr && columns[RoleY]->size() > columns[RoleX]->size())
+        driver = RoleY;
+
+    const Column & driverColumn = *columns[driver];
+    if (driverColumn.empty())
+        return result;
+
+    // Split the driving samples evenly
+    unsigned threads = options.threads != 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    std::size_t parts = std::clamp<std::size_t>(driverColumn.size() / MinPartSize, 1, threads);
+
+    std::vector<CellHits> partial(parts, CellHits(table.width(), table.height()));
+    std::vector<std::exception_ptr> errors(parts);
+    auto work = [&](std::size_t part) {
+        try
+        {
+            Worker worker(columns, driver, xPoints, yPoints, options, partial[part]);
+            worker.run(part * driverColumn.size() / parts, (part + 1) * driverColumn.size() / parts);
+        }
+        catch (...)
+        {
+            errors[part] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (std::size_t part = 1; part < parts; ++part)
+        workers.emplace_back(work, part);
+    work(0);
+    for (std::thread & worker : workers)
+        worker.join();
+
+    for (std::size_t part = 0; part < parts; ++part)
+    {
+        if (errors[part])
+            std::rethrow_exception(errors[part]);
+        result.merge(partial[part]);
+    }
+    return result;
+}
+
+} // namespace lt
@@ -0,0 +1,137 @@
+/*
+ * LibreTuner
+ * Copyright (C) 2018 Altenius
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LT_CELLHITS_H
+#define LT_CELLHITS_H
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "../rom/table.h"
+#include "datalog.h"
+
+namespace lt
+{
+
+// Logged operating points that fell into one table cell
+struct CellStats
+{
+    // Number of samples. Fractional when samples are distributed
+    // bilinearly.
+    double hits{0};
+    // Time spent in the cell in milliseconds
+    double dwell{0};
+    // Weighted sum, minimum and maximum of the value PID
+    double sum{0};
+    double min{std::numeric_limits<double>::infinity()};
+    double max{-std::numeric_limits<double>::infinity()};
+
+    inline bool empty() const noexcept { return hits <= 0; }
+    inline double mean() const noexcept { return hits > 0 ? sum / hits : 0; }
+
+    // Adds a sample with weight `weight` that was held for `dwell` ms
+    inline void add(double weight, double dwellTime, double value) noexcept
+    {
+        hits += weight;
+        dwell += weight * dwellTime;
+        sum += weight * value;
+        if (value < min)
+            min = value;
+        if (value > max)
+            max = value;
+    }
+
+    void merge(const CellStats & other) noexcept;
+};
+
+// Per-cell statistics of a log overlaid onto a table
+class CellHits
+{
+public:
+    CellHits() = default;
+    CellHits(int width, int height);
+
+    inline int width() const noexcept { return width_; }
+    inline int height() const noexcept { return height_; }
+
+    inline const CellStats & at(int row, int column) const noexcept { return cells_[row * width_ + column]; }
+    inline CellStats & at(int row, int column) noexcept { return cells_[row * width_ + column]; }
+
+    // Returns true if a value PID was accumulated
+    inline bool hasValues() const noexcept { return hasValues_; }
+    inline void setHasValues(bool hasValues) noexcept { hasValues_ = hasValues; }
+
+    // Returns the number of samples that were accumulated
+    inline std::size_t samples() const noexcept { return samples_; }
+    inline void addSamples(std::size_t count) noexcept { samples_ += count; }
+
+    // Returns the number of samples skipped for a value that is not finite
+    inline std::size_t invalidSamples() const noexcept { return invalidSamples_; }
+    inline void addInvalidSamples(std::size_t count) noexcept { invalidSamples_ += count; }
+
+    // Returns the highest hit count of any cell
+    double maxHits() const noexcept;
+
+    // Adds the statistics of `other`, which must have the same size
+    void merge(const CellHits & other) noexcept;
+
+private:
+    int width_{0};
+    int height_{0};
+    std::size_t samples_{0};
+    std::size_t invalidSamples_{0};
+    bool hasValues_{false};
+    std::vector<CellStats> cells_;
+};
+using CellHitsPtr = std::shared_ptr<CellHits>;
+
+struct CellHitOptions
+{
+    /* If true, each sample is split across the four surrounding cells
+     * with bilinear weights. Otherwise it counts for the nearest cell. */
+    bool bilinear{false};
+    /* If true, samples outside of the axes count for the edge cells.
+     * Otherwise they are skipped. */
+    bool clampToEdges{true};
+    /* Gaps between samples longer than this (in ms) count as this long
+     * so pauses in logging do not inflate dwell times. */
+    std::size_t maxGap{1000};
+    // Number of worker threads. 0 uses the hardware concurrency.
+    unsigned threads{0};
+};
+
+/* Accumulates where the samples of `log` fall on `table`. `xPid` selects
+ * the column through the table's X axis and `yPid` the row through the
+ * Y axis; `yPid` may be null for one-dimensional tables. If `valuePid`
+ * is not null, its mean, minimum and maximum are collected per cell.
+ *
+ * The PID with the most samples drives the timeline; the others are
+ * sample-and-hold aligned to its timestamps. Samples before every PID
+ * has a value are skipped, as are samples where any PID is NaN or
+ * infinite, such as formulas dividing by zero; those are counted in
+ * invalidSamples(). The samples are copied out while the log is locked,
+ * then split across worker threads and the partial results are merged.
+ * Throws std::runtime_error if a PID is not in the log. */
+CellHits accumulateCellHits(const DataLog & log, const Table & table, const Pid & xPid, const Pid * yPid,
+                            const Pid * valuePid, const CellHitOptions & options = CellHitOptions{});
+
+} // namespace lt
+
+#endif // LT_CELLHITS_H
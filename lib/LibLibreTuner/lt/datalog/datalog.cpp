@@ -23,30 +23,35 @@ namespace lt
 
 bool DataLog::add(const Pid & pid, PidLogEntry entry)
 {
-    PidLog * log = pidLog(pid);
-    if (log == nullptr)
+    PidLog * log;
     {
-        log = &addPid(pid);
-    }
+        std::lock_guard<std::mutex> lock(mutex_);
+        log = pidLog(pid);
+        if (log == nullptr)
+        {
+            log = &createPid(pid);
+        }
 
-    if (empty_)
-    {
-        empty_ = false;
-        beginTime_ = std::chrono::steady_clock::now();
-    }
+        if (empty_)
+        {
+            empty_ = false;
+            beginTime_ = std::chrono::steady_clock::now();
+        }
 
-    log->entries.emplace_back(entry);
-    if (entry.time > maxTime_)
-    {
-        maxTime_ = entry.time;
-    }
-    if (entry.value > maxValue_)
-    {
-        maxValue_ = entry.value;
-    }
-    else if (entry.value < minValue_)
-    {
-        minValue_ = entry.value;
+        log->append(entry);
+        sampleCount_.fetch_add(1, std::memory_order_relaxed);
+        if (entry.time > maxTime_)
+        {
+            maxTime_ = entry.time;
+        }
+        if (entry.value > maxValue_)
+        {
+            maxValue_ = entry.value;
+        }
+        else if (entry.value < minValue_)
+        {
+            minValue_ = entry.value;
+        }
     }
 
     addEvent_(*log, entry);
@@ -65,26 +70,64 @@ PidLog * DataLog::pidLog(const Pid & pid) noexcept
 
 PidLog & DataLog::addPid(const Pid & pid) noexcept
 {
-    PidLog log{pid, {}};
+    std::lock_guard<std::mutex> lock(mutex_);
+    return createPid(pid);
+}
+
+PidLog & DataLog::createPid(const Pid & pid) noexcept
+{
+    PidLog log(pid, precision_);
+    log.setCompressColdChunks(compressCold_);
     logs_.emplace(pid.code, std::move(log));
     return logs_.find(pid.code)->second;
 }
 
+void DataLog::setCompressColdChunks(bool compress) noexcept
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    compressCold_ = compress;
+    for (auto & log : logs_)
+    {
+        log.second.setCompressColdChunks(compress);
+    }
+}
+
+std::size_t DataLog::memoryUsage() const noexcept
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::size_t usage = 0;
+    for (const auto & log : logs_)
+    {
+        usage += log.second.memoryUsage();
+    }
+    return usage;
+}
+
 bool DataLog::add(const Pid & pid, double value)
 {
-    if (empty_)
+    return add(pid, value, std::chrono::steady_clock::now());
+}
+
+bool DataLog::add(const Pid & pid, double value, DataLogTimePoint time)
+{
+    std::size_t elapsed = 0;
     {
-        empty_ = false;
-        beginTime_ = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (empty_)
+        {
+            empty_ = false;
+            beginTime_ = time;
+        }
+        if (time > beginTime_)
+        {
+            elapsed = static_cast<std::size_t>(
+                std::chrono::duration_cast<std::chrono::milliseconds>(
+                    time - beginTime_)
+                    .count());
+        }
     }
 
-    return add(
-        pid,
-        PidLogEntry{value,
-                    static_cast<std::size_t>(
-                        std::chrono::duration_cast<std::chrono::milliseconds>(
-                            std::chrono::steady_clock::now() - beginTime_)
-                            .count())});
+    return add(pid, PidLogEntry{value, elapsed});
 }
 
 } // namespace lt
@@ -19,32 +19,22 @@
 #ifndef LT_DATALOG_H
 #define LT_DATALOG_H
 
+#include <atomic>
 #include <chrono>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <vector>
 
 #include "../support/event.h"
 #include "pid.h"
+#include "pidlog.h"
 
 namespace lt
 {
 using DataLogTimePoint = std::chrono::steady_clock::time_point;
 
-struct PidLogEntry
-{
-    double value;
-    // Miliseconds since log start
-    std::size_t time;
-};
-
-struct PidLog
-{
-    Pid pid;
-    std::vector<PidLogEntry> entries;
-};
-
 class DataLog
 {
 public:
@@ -61,10 +51,20 @@ public:
     // Adds a value at the current time
     bool add(const Pid & pid, double value);
 
+    // Adds a value sampled at `time`
+    bool add(const Pid & pid, double value, DataLogTimePoint time);
+
     // Returns the PID log or nullptr if it does not exist. Add with
     // addPid()
     PidLog * pidLog(const Pid & pid) noexcept;
 
+    /* Locks the log against concurrent add() calls. Hold the lock while
+     * reading logs from a thread other than the one adding samples. */
+    inline std::unique_lock<std::mutex> lock() const { return std::unique_lock<std::mutex>(mutex_); }
+
+    // Returns all PID logs keyed by PID code
+    inline const std::unordered_map<uint32_t, PidLog> & logs() const noexcept { return logs_; }
+
     // Adds a PID to the log. Overwrites any previous logs with the same
     // pid.
     PidLog & addPid(const Pid & pid) noexcept;
@@ -75,6 +75,9 @@ public:
     // Returns true if the log is empty
     inline bool empty() const noexcept { return empty_; }
 
+    // Returns the number of samples added. May be called from any thread.
+    inline std::size_t sampleCount() const noexcept { return sampleCount_.load(std::memory_order_relaxed); }
+
     template <typename Func>
     inline AddConnectionPtr onAdd(Func && func) noexcept
     {
@@ -87,6 +90,18 @@ public:
     inline double minValue() const noexcept { return minValue_; }
     inline double maxValue() const noexcept { return maxValue_; }
 
+    // Sets the value precision of PID logs added after the call
+    inline void setPrecision(ValuePrecision precision) noexcept { precision_ = precision; }
+    inline ValuePrecision precision() const noexcept { return precision_; }
+
+    /* If true, PID logs compress their chunks once they are full.
+     * Applies to existing logs and logs added after the call. */
+    void setCompressColdChunks(bool compress) noexcept;
+    inline bool compressColdChunks() const noexcept { return compressCold_; }
+
+    // Returns the number of bytes used by all samples
+    std::size_t memoryUsage() const noexcept;
+
 private:
     DataLogTimePoint beginTime_;
     std::size_t maxTime_{0};
@@ -94,10 +109,17 @@ private:
     double minValue_{0};
     std::string name_;
     bool empty_{true};
+    ValuePrecision precision_{ValuePrecision::Double};
+    bool compressCold_{false};
+    std::atomic<std::size_t> sampleCount_{0};
 
     AddEvent addEvent_;
+    mutable std::mutex mutex_;
 
     std::unordered_map<uint32_t, PidLog> logs_;
+
+    // Adds a PID log. The mutex must be held.
+    PidLog & createPid(const Pid & pid) noexcept;
 };
 using DataLogPtr = std::shared_ptr<DataLog>;
 
@@ -0,0 +1,37 @@
+/*
+ * LibreTuner
+ * Copyright (C) 2018 Altenius
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "datalogfeed.h"
+
+namespace lt
+{
+
+DataLogFeed::DataLogFeed(DataLog & log, std::size_t capacity) : state_(std::make_shared<State>(capacity))
+{
+    // Captures the state rather than `this` so it outlives a dispatch
+    // in progress
+    connection_ = log.onAdd([state = state_](const PidLog & pidLog, const PidLogEntry & entry) {
+        std::lock_guard lock(state->producer);
+        if (!state->ring.push(Sample{&pidLog, entry}))
+        {
+            state->dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+}
+
+} // namespace lt
@@ -0,0 +1,121 @@
+/*
+ * LibreTuner
+ * Copyright (C) 2018 Altenius
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LT_DATALOGFEED_H
+#define LT_DATALOGFEED_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../support/ringbuffer.h"
+#include "datalog.h"
+
+namespace lt
+{
+
+/* Batches samples added to a DataLog for a consumer on another thread
+ * (e.g. a view refreshing at a fixed frame rate). Adding a sample only
+ * pushes it to a ring buffer; the consumer drains the buffer without
+ * locking and receives the new samples grouped per PID. Samples may be
+ * added from several threads. Producers are serialized by a mutex,
+ * which is uncontended while a single thread is logging. If the consumer
+ * falls behind and the buffer fills up, samples are dropped and
+ * counted. */
+class DataLogFeed
+{
+public:
+    static constexpr std::size_t DefaultCapacity = 1 << 14;
+
+    explicit DataLogFeed(DataLog & log, std::size_t capacity = DefaultCapacity);
+
+    DataLogFeed(const DataLogFeed &) = delete;
+    DataLogFeed & operator=(const DataLogFeed &) = delete;
+
+    /* Calls `func(const PidLog & log, const PidLogEntry * entries,
+     * std::size_t count)` once per PID with the samples added since the
+     * last call, in order. Returns the total number of samples. Must
+     * only be called from one thread. */
+    template <typename Func> std::size_t drain(Func && func);
+
+    // Returns the number of samples dropped because the buffer was full
+    inline std::size_t dropped() const noexcept { return state_->dropped.load(std::memory_order_relaxed); }
+
+private:
+    struct Sample
+    {
+        const PidLog * log;
+        PidLogEntry entry;
+    };
+
+    struct Span
+    {
+        const PidLog * log;
+        std::vector<PidLogEntry> entries;
+    };
+
+    /* Shared with the callback, which may still be running on the logging
+     * thread while the feed is destroyed */
+    struct State
+    {
+        explicit State(std::size_t capacity) : ring(capacity) {}
+
+        SpscRing<Sample> ring;
+        std::mutex producer;
+        std::atomic<std::size_t> dropped{0};
+    };
+
+    std::shared_ptr<State> state_;
+    // Reused between drains
+    std::vector<Span> spans_;
+
+    DataLog::AddConnectionPtr connection_;
+};
+
+template <typename Func> std::size_t DataLogFeed::drain(Func && func)
+{
+    std::size_t count = state_->ring.drain([this](const Sample & sample) {
+        // Few PIDs are logged at once, so a linear search is fastest
+        auto it = std::find_if(spans_.begin(), spans_.end(),
+                               [&sample](const Span & span) { return span.log == sample.log; });
+        if (it == spans_.end())
+        {
+            spans_.push_back(Span{sample.log, {}});
+            it = std::prev(spans_.end());
+        }
+        it->entries.push_back(sample.entry);
+    });
+
+    for (Span & span : spans_)
+    {
+        if (!span.entries.empty())
+        {
+            func(*span.log, span.entries.data(), span.entries.size());
+            span.entries.clear();
+        }
+    }
+    return count;
+}
+
+} // namespace lt
+
+#endif // LT_DATALOGFEED_H
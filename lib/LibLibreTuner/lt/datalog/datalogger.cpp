@@ -18,6 +18,8 @@
 
 #include "datalogger.h"
 
+#include <algorithm>
+#include <thread>
 #include <utility>
 
 #include <shunting-yard.h>
@@ -61,26 +63,88 @@ public:
 };
 
 UdsDataLogger::UdsDataLogger(DataLog & log, network::UdsPtr && uds)
-    : DataLogger(log), uds_(std::move(uds)), iter_(pids_.begin())
+    : DataLogger(log), uds_(std::move(uds))
 {
-    static CParseInit cparseInit;
 }
 
-void UdsDataLogger::addPid(Pid pid) { pids_.emplace_front(std::move(pid)); }
+UdsDataLogger::~UdsDataLogger() = default;
 
-Pid * UdsDataLogger::nextPid()
+double UdsDataLogger::Entry::evaluate(const uint8_t * data,
+                                      std::size_t size) const
 {
-    if (pids_.empty())
+    if (!fallback)
     {
-        return nullptr;
+        return formula.evaluate(data, size);
     }
 
-    if (iter_ == pids_.end())
+    switch (size)
     {
-        iter_ = pids_.begin();
+    case 0:
+        break;
+    default:
+    case 3:
+        fallback->setZ(data[2]);
+        // Fallthrough
+    case 2:
+        fallback->setY(data[1]);
+        // Fallthrough
+    case 1:
+        fallback->setX(data[0]);
+        break;
     }
+    return fallback->evaluate();
+}
 
-    return &*iter_++;
+void UdsDataLogger::addPid(Pid pid)
+{
+    std::lock_guard lock(pendingMutex_);
+    pending_.emplace_back(std::move(pid));
+    hasPending_ = true;
+}
+
+void UdsDataLogger::addPending()
+{
+    std::vector<Pid> pending;
+    {
+        std::lock_guard lock(pendingMutex_);
+        pending.swap(pending_);
+        hasPending_ = false;
+    }
+
+    for (Pid & pid : pending)
+    {
+        Entry * entry;
+        {
+            // rates() walks the list from other threads
+            std::lock_guard lock(statsMutex_);
+            entry = &pids_.emplace_front(Entry{std::move(pid), {}, {}});
+        }
+        try
+        {
+            entry->formula = Formula::compile(entry->pid.formula);
+        }
+        catch (const std::runtime_error &)
+        {
+            // Unsupported syntax. Parse once with cparse and reuse the
+            // result.
+            static CParseInit cparseInit;
+            entry->fallback = std::make_unique<PidEvaluator>(entry->pid);
+        }
+    }
+
+    // Rebuild the requests so the new PIDs are scheduled
+    if (configured_)
+    {
+        clearComposites();
+        configured_ = false;
+    }
+}
+
+void UdsDataLogger::fallBack(UdsBatching batching) noexcept
+{
+    clearComposites();
+    batching_ = batching;
+    configured_ = false;
 }
 
 void UdsDataLogger::processNext()
@@ -88,9 +152,18 @@ void UdsDataLogger::processNext()
     if (!uds_)
     {
         disable();
+        return;
+    }
+    if (hasPending_)
+    {
+        addPending();
     }
-    Pid * pid = nextPid();
-    if (pid == nullptr)
+    if (!configured_)
+    {
+        configure();
+        return;
+    }
+    if (requests_.empty())
     {
         // PID list is empty. Disable to avoid infinite loop
         disable();
@@ -103,34 +176,373 @@ void UdsDataLogger::processNext()
         // return;
     }
 
-    // Request the data
-    std::vector<uint8_t> response = uds_->readDataByIdentifier(pid->code);
+    // Earliest deadline first. Requests without a rate fill the time in
+    // which no timed request is due.
+    auto later = [this](std::size_t lhs, std::size_t rhs) {
+        return requests_[lhs].deadline > requests_[rhs].deadline;
+    };
 
-    PidEvaluator evaluator(*pid);
+    Clock::time_point now = Clock::now();
+    Request * next = nullptr;
+    if (!queue_.empty() && requests_[queue_.front()].deadline <= now)
+    {
+        std::pop_heap(queue_.begin(), queue_.end(), later);
+        next = &requests_[queue_.back()];
+        // Skip missed periods instead of bursting to catch up. The next
+        // deadline is always in the future, so a late request cannot be
+        // fired again right away and starve the others.
+        next->deadline += next->period;
+        if (next->deadline <= now)
+        {
+            next->deadline +=
+                ((now - next->deadline) / next->period + 1) * next->period;
+        }
+        std::push_heap(queue_.begin(), queue_.end(), later);
+    }
+    else if (!bestEffort_.empty())
+    {
+        if (nextBestEffort_ >= bestEffort_.size())
+        {
+            nextBestEffort_ = 0;
+        }
+        next = &requests_[bestEffort_[nextBestEffort_++]];
+    }
+    else
+    {
+        // Nothing is due. Sleep in short steps to stay responsive to
+        // disable().
+        std::this_thread::sleep_until(
+            std::min(requests_[queue_.front()].deadline,
+                     now + std::chrono::milliseconds(10)));
+        return;
+    }
+    const Request & request = *next;
 
-    switch (response.size())
+    try
     {
-    case 0:
-        break;
-    default:
-    case 3:
-        evaluator.setZ(response[2]);
-        // Fallthrough
-    case 2:
-        evaluator.setY(response[1]);
-        // Fallthrough
-    case 1:
-        evaluator.setX(response[0]);
-        break;
+        if (!read(request))
+        {
+            // The batched response could not be split. It is dropped and
+            // PIDs are read one by one from now on.
+            fallBack(UdsBatching::None);
+        }
+    }
+    catch (const network::UdsNegativeResponse &)
+    {
+        if (request.entries.size() == 1 && request.composite == 0)
+        {
+            throw;
+        }
+        // The ECU rejected the batched request. Fall back to a simpler
+        // mode.
+        fallBack(batching_ == UdsBatching::Composite ? UdsBatching::MultiRead
+                                                     : UdsBatching::None);
+    }
+
+    updateRates(now);
+}
+
+void UdsDataLogger::configure()
+{
+    // Record sizes are needed to split batched responses
+    for (Entry & entry : pids_)
+    {
+        if (entry.size == 0)
+        {
+            readSingle(entry);
+        }
+    }
+
+    requests_.clear();
+    queue_.clear();
+    bestEffort_.clear();
+
+    if (batching_ == UdsBatching::Composite)
+    {
+        try
+        {
+            buildComposite();
+        }
+        catch (const network::UdsNegativeResponse &)
+        {
+            // 0x2C is unsupported or the identifiers are out of range
+            clearComposites();
+            requests_.clear();
+            batching_ = UdsBatching::MultiRead;
+        }
+    }
+    if (batching_ == UdsBatching::MultiRead)
+    {
+        buildMultiRead();
+    }
+    else if (batching_ == UdsBatching::None)
+    {
+        buildSingle();
     }
 
-    double result = evaluator.evaluate();
-    log_.add(*pid, result);
+    // Every timed request is due immediately
+    for (std::size_t i = 0; i < requests_.size(); ++i)
+    {
+        if (requests_[i].period == Clock::duration::zero())
+        {
+            bestEffort_.push_back(i);
+        }
+        else
+        {
+            queue_.push_back(i);
+        }
+    }
+    windowStart_ = Clock::now();
+    configured_ = true;
+}
+
+std::vector<UdsDataLogger::Entry *> UdsDataLogger::sortedEntries()
+{
+    std::vector<Entry *> entries;
+    for (Entry & entry : pids_)
+    {
+        entries.push_back(&entry);
+    }
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const Entry * lhs, const Entry * rhs) {
+                         return lhs->pid.rate > rhs->pid.rate;
+                     });
+    return entries;
+}
+
+void UdsDataLogger::addRequest(Request && request)
+{
+    double rate = request.entries.front()->pid.rate;
+    if (rate > 0)
+    {
+        request.period = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(1.0 / rate));
+    }
+    requests_.emplace_back(std::move(request));
+}
+
+void UdsDataLogger::buildComposite()
+{
+    Request request;
+    std::size_t recordSize = 0;
+    std::vector<network::DidSource> sources;
+
+    auto define = [&]() {
+        if (request.entries.empty())
+        {
+            return;
+        }
+        auto id = static_cast<uint16_t>(CompositeIdBase + composites_.size());
+
+        // Remove any stale definition. Fails if the identifier was never
+        // defined.
+        try
+        {
+            uds_->clearDataIdentifier(id);
+        }
+        catch (const network::UdsNegativeResponse &)
+        {
+        }
+
+        sources.clear();
+        for (const Entry * entry : request.entries)
+        {
+            sources.push_back(network::DidSource{
+                entry->pid.code, 1, static_cast<uint8_t>(entry->size)});
+        }
+        uds_->defineDataIdentifier(id, sources.data(), sources.size());
+        composites_.push_back(id);
+
+        request.composite = id;
+        addRequest(std::move(request));
+        request = Request{};
+        recordSize = 0;
+    };
+
+    for (Entry * entry : sortedEntries())
+    {
+        if (entry->size == 0 || entry->size > MaxCompositeSize)
+        {
+            // Cannot be packed
+            addRequest(Request{0, {entry}});
+            continue;
+        }
+        if (recordSize + entry->size > MaxCompositeSize ||
+            (!request.entries.empty() &&
+             request.entries.front()->pid.rate != entry->pid.rate))
+        {
+            define();
+        }
+        request.entries.push_back(entry);
+        recordSize += entry->size;
+    }
+    define();
+}
+
+void UdsDataLogger::buildMultiRead()
+{
+    Request request;
+    for (Entry * entry : sortedEntries())
+    {
+        if (entry->size == 0)
+        {
+            addRequest(Request{0, {entry}});
+            continue;
+        }
+        if (!request.entries.empty() &&
+            request.entries.front()->pid.rate != entry->pid.rate)
+        {
+            addRequest(std::move(request));
+            request = Request{};
+        }
+        request.entries.push_back(entry);
+        if (request.entries.size() == MaxRequestIds)
+        {
+            addRequest(std::move(request));
+            request = Request{};
+        }
+    }
+    if (!request.entries.empty())
+    {
+        addRequest(std::move(request));
+    }
+}
+
+void UdsDataLogger::buildSingle()
+{
+    for (Entry * entry : sortedEntries())
+    {
+        addRequest(Request{0, {entry}});
+    }
+}
+
+void UdsDataLogger::clearComposites() noexcept
+{
+    for (uint16_t id : composites_)
+    {
+        try
+        {
+            uds_->clearDataIdentifier(id);
+        }
+        catch (const std::exception &)
+        {
+        }
+    }
+    composites_.clear();
+}
+
+void UdsDataLogger::record(Entry & entry, double value)
+{
+    ingest_.push(entry.pid, value);
+    ++entry.windowSamples;
+}
+
+void UdsDataLogger::updateRates(Clock::time_point now)
+{
+    std::chrono::duration<double> elapsed = now - windowStart_;
+    if (elapsed < std::chrono::seconds(1))
+    {
+        return;
+    }
+
+    std::lock_guard lock(statsMutex_);
+    for (Entry & entry : pids_)
+    {
+        entry.achieved = entry.windowSamples / elapsed.count();
+        entry.windowSamples = 0;
+    }
+    windowStart_ = now;
+}
+
+std::vector<PidRate> UdsDataLogger::rates() const
+{
+    std::lock_guard lock(statsMutex_);
+
+    std::vector<PidRate> rates;
+    for (const Entry & entry : pids_)
+    {
+        rates.push_back(PidRate{entry.pid.code, entry.pid.rate, entry.achieved});
+    }
+    return rates;
+}
+
+void UdsDataLogger::readSingle(Entry & entry)
+{
+    std::vector<uint8_t> response =
+        uds_->readDataByIdentifier(entry.pid.code);
+    entry.size = response.size();
+
+    record(entry, entry.evaluate(response.data(), response.size()));
+}
+
+bool UdsDataLogger::read(const Request & request)
+{
+    if (request.composite == 0 && request.entries.size() == 1)
+    {
+        readSingle(*request.entries.front());
+        return true;
+    }
+
+    std::vector<uint8_t> response;
+    std::size_t expected = 0;
+
+    if (request.composite != 0)
+    {
+        response = uds_->readDataByIdentifier(request.composite);
+        for (const Entry * entry : request.entries)
+        {
+            expected += entry->size;
+        }
+    }
+    else
+    {
+        uint16_t ids[MaxRequestIds];
+        for (std::size_t i = 0; i < request.entries.size(); ++i)
+        {
+            ids[i] = request.entries[i]->pid.code;
+            expected += 2 + request.entries[i]->size;
+        }
+        response = uds_->readDataByIdentifiers(ids, request.entries.size());
+    }
+
+    if (response.size() != expected)
+    {
+        return false;
+    }
+
+    // Multi-identifier responses echo each identifier. Check all of them
+    // before recording anything.
+    if (request.composite == 0)
+    {
+        const uint8_t * data = response.data();
+        for (const Entry * entry : request.entries)
+        {
+            if (data[0] != (entry->pid.code >> 8) ||
+                data[1] != (entry->pid.code & 0xFF))
+            {
+                return false;
+            }
+            data += 2 + entry->size;
+        }
+    }
+
+    const uint8_t * data = response.data();
+    for (Entry * entry : request.entries)
+    {
+        if (request.composite == 0)
+        {
+            data += 2;
+        }
+        record(*entry, entry->evaluate(data, entry->size));
+        data += entry->size;
+    }
+    return true;
 }
 
 void UdsDataLogger::run()
 {
     running_ = true;
+    ingest_.start();
     try
     {
         while (running_)
@@ -140,6 +552,8 @@ void UdsDataLogger::run()
     {
         disable();
     }
+    clearComposites();
+    ingest_.stop();
 }
 
 void UdsDataLogger::disable() { running_ = false; }
@@ -20,23 +20,38 @@
 #define LT_DATALOGGER_H
 
 #include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <forward_list>
 #include <mutex>
 #include <string>
+#include <vector>
 
 #include "../network/uds/uds.h"
 #include "datalog.h"
+#include "datalogingest.h"
+#include "formula.h"
 
 namespace lt
 {
 
 class DataLogger;
+class PidEvaluator;
+
+// Requested and achieved sample rate of a logged PID
+struct PidRate
+{
+    uint16_t code;
+    // Target rate in Hz. 0 if the PID is polled as fast as possible.
+    double requested;
+    // Measured rate in Hz over the last second
+    double achieved;
+};
 
 class DataLogger
 {
 public:
-    explicit DataLogger(DataLog & log) : log_(log) {}
+    explicit DataLogger(DataLog & log) : log_(log), ingest_(log) {}
 
     virtual ~DataLogger() = default;
 
@@ -49,11 +64,35 @@ public:
 
     virtual void addPid(Pid pid) = 0;
 
+    /* Returns the requested and achieved rate of every PID. May be
+     * called from any thread. */
+    virtual std::vector<PidRate> rates() const { return {}; }
+
+    /* Returns the number of samples dropped because storing them fell
+     * behind. May be called from any thread. */
+    inline std::size_t droppedSamples() const noexcept { return ingest_.dropped(); }
+
 protected:
     DataLog & log_;
+    /* Samples are pushed here instead of being added to log_, so the
+     * logger never blocks on listeners of the log. Implementations start
+     * it when run() begins and stop it before run() returns. */
+    DataLogIngest ingest_;
 };
 using DataLoggerPtr = std::unique_ptr<DataLogger>;
 
+/* How UdsDataLogger groups PID reads into UDS requests */
+enum class UdsBatching
+{
+    // One ReadDataByIdentifier request per PID
+    None,
+    // ReadDataByIdentifier requests carrying multiple identifiers
+    MultiRead,
+    // PIDs are packed into dynamically defined identifiers (0x2C) that
+    // are read with one request per sweep
+    Composite,
+};
+
 class UdsDataLogger : public DataLogger
 {
 public:
@@ -63,24 +102,116 @@ public:
     UdsDataLogger & operator=(UdsDataLogger &&) = delete;
     UdsDataLogger & operator=(const UdsDataLogger &) = delete;
 
-    ~UdsDataLogger() override = default;
+    ~UdsDataLogger() override;
 
+    /* Adds a PID to the logger. The PID is polled at `pid.rate`. May be
+     * called while logging, from any thread; the logger compiles the
+     * formula and rebuilds its requests before the next read. */
     void addPid(Pid pid) override;
 
+    std::vector<PidRate> rates() const override;
+
     void disable() override;
 
     /* Starts logging. */
     void run() override;
 
+    /* Sets the preferred batching mode. If the ECU rejects a batched
+     * request, the logger falls back to the next simpler mode. Must be
+     * called before run(). */
+    inline void setBatching(UdsBatching batching) noexcept
+    {
+        batching_ = batching;
+    }
+
+    // Returns the batching mode currently in use
+    inline UdsBatching batching() const noexcept { return batching_; }
+
+    // First dynamically defined identifier used for composite reads
+    static constexpr uint16_t CompositeIdBase = 0xF300;
+    // Maximum record size of a single composite identifier
+    static constexpr std::size_t MaxCompositeSize = 64;
+    // Maximum number of identifiers in a multi-identifier read
+    static constexpr std::size_t MaxRequestIds = 8;
+
 private:
-    Pid * nextPid();
+    struct Entry
+    {
+        Pid pid;
+        Formula formula;
+        // Set if the formula could not be compiled and must be
+        // evaluated with cparse
+        std::unique_ptr<PidEvaluator> fallback;
+        // Size of the data record. Learned from the first response.
+        std::size_t size{0};
+
+        // Samples taken in the current rate window
+        std::size_t windowSamples{0};
+        // Guarded by statsMutex_
+        double achieved{0};
+
+        double evaluate(const uint8_t * data, std::size_t size) const;
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    // A single UDS request covering one or more PIDs of the same rate
+    struct Request
+    {
+        // Identifier of the composite record or 0
+        uint16_t composite{0};
+        std::vector<Entry *> entries;
+
+        // Zero if the request is polled as fast as possible
+        Clock::duration period{};
+        Clock::time_point deadline{};
+    };
+
     void processNext();
+    // Adds the PIDs queued by addPid()
+    void addPending();
+    // Switches to a simpler batching mode and rebuilds the requests
+    void fallBack(UdsBatching batching) noexcept;
+
+    // Reads PIDs of unknown size one-by-one and builds the request list
+    void configure();
+    void buildComposite();
+    void buildMultiRead();
+    void buildSingle();
+    void clearComposites() noexcept;
+
+    // Adds a request and computes its period from the PID rate
+    void addRequest(Request && request);
+    // PIDs ordered by descending rate so equal rates can share requests
+    std::vector<Entry *> sortedEntries();
+
+    /* Reads and records the PIDs of `request`. Returns false, recording
+     * nothing, if a batched response does not match the request. */
+    bool read(const Request & request);
+    void readSingle(Entry & entry);
+    void record(Entry & entry, double value);
+    void updateRates(Clock::time_point now);
 
     std::chrono::steady_clock::time_point freeze_time_;
 
     network::UdsPtr uds_;
-    std::forward_list<Pid> pids_;
-    std::forward_list<Pid>::iterator iter_;
+    std::forward_list<Entry> pids_;
+
+    std::vector<Request> requests_;
+    // Min-heap of timed request indices ordered by deadline
+    std::vector<std::size_t> queue_;
+    // Requests without a rate, polled round-robin when nothing is due
+    std::vector<std::size_t> bestEffort_;
+    std::size_t nextBestEffort_{0};
+    Clock::time_point windowStart_;
+    mutable std::mutex statsMutex_;
+    // PIDs added by addPid() that are not yet in pids_
+    std::mutex pendingMutex_;
+    std::vector<Pid> pending_;
+    std::atomic<bool> hasPending_{false};
+    bool configured_{false};
+    std::vector<uint16_t> composites_;
+    std::atomic<UdsBatching> batching_{UdsBatching::Composite};
 
     std::atomic<bool> running_{false};
     size_t current_pid_ = 0;
@@ -0,0 +1,112 @@
+/*
+ * LibreTuner
+ * Copyright (C) 2018 Altenius
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "datalogingest.h"
+
+namespace lt
+{
+
+DataLogIngest::DataLogIngest(DataLog & log, std::size_t capacity) : log_(log), ring_(capacity) {}
+
+DataLogIngest::~DataLogIngest() { stop(); }
+
+void DataLogIngest::start()
+{
+    if (thread_.joinable())
+    {
+        return;
+    }
+    running_.store(true, std::memory_order_release);
+    thread_ = std::thread([this]() { run(); });
+}
+
+void DataLogIngest::stop()
+{
+    if (!thread_.joinable())
+    {
+        return;
+    }
+    running_.store(false, std::memory_order_release);
+    thread_.join();
+}
+
+bool DataLogIngest::push(const Pid & pid, double value, DataLogTimePoint time) noexcept
+{
+    auto it = known_.find(pid.code);
+    const Pid * copy;
+    try
+    {
+        if (it == known_.end())
+        {
+            pids_.push_front(pid);
+            copy = &pids_.front();
+            known_.emplace(pid.code, copy);
+        }
+        else
+        {
+            copy = it->second;
+        }
+    }
+    catch (const std::bad_alloc &)
+    {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    if (!ring_.push(Sample{copy, value, time}))
+    {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+std::size_t DataLogIngest::store()
+{
+    std::size_t failed = 0;
+    std::size_t count = ring_.drain([this, &failed](const Sample & sample) {
+        try
+        {
+            log_.add(*sample.pid, sample.value, sample.time);
+        }
+        catch (const std::exception &)
+        {
+            ++failed;
+        }
+    });
+
+    stored_.fetch_add(count - failed, std::memory_order_relaxed);
+    dropped_.fetch_add(failed, std::memory_order_relaxed);
+    return count;
+}
+
+void DataLogIngest::run()
+{
+    while (running_.load(std::memory_order_acquire))
+    {
+        if (store() == 0)
+        {
+            std::this_thread::sleep_for(PollInterval);
+        }
+    }
+
+    // Store samples pushed before the ingest was stopped
+    store();
+}
+
+} // namespace lt
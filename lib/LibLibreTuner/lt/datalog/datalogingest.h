@@ -0,0 +1,103 @@
+/*
+ * LibreTuner
+ * Copyright (C) 2018 Altenius
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LT_DATALOGINGEST_H
+#define LT_DATALOGINGEST_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <forward_list>
+#include <thread>
+#include <unordered_map>
+
+#include "../support/ringbuffer.h"
+#include "datalog.h"
+
+namespace lt
+{
+
+/* Hands samples from an acquisition thread to a DataLog. The acquisition
+ * thread pushes samples into a lock-free ring buffer and never blocks.
+ * A storage thread owned by the ingest drains the buffer and is the only
+ * thread that adds to the log, so listeners of the log (views, file
+ * writers) never run on the acquisition thread. The storage thread only
+ * runs between start() and stop(). If storage falls behind and the
+ * buffer fills up, samples are dropped and counted. */
+class DataLogIngest
+{
+public:
+    static constexpr std::size_t DefaultCapacity = 1 << 16;
+    // How long the storage thread sleeps when the buffer is empty
+    static constexpr std::chrono::milliseconds PollInterval{2};
+
+    explicit DataLogIngest(DataLog & log, std::size_t capacity = DefaultCapacity);
+
+    // Stops the storage thread if running
+    ~DataLogIngest();
+
+    // Starts the storage thread. Does nothing if it is running.
+    void start();
+
+    /* Stops the storage thread and waits for it to store the remaining
+     * samples. Does nothing if it is not running. */
+    void stop();
+
+    DataLogIngest(const DataLogIngest &) = delete;
+    DataLogIngest & operator=(const DataLogIngest &) = delete;
+
+    /* Queues a sample of `pid` taken at `time`. Returns false if the
+     * buffer is full. Must only be called from one thread. */
+    bool push(const Pid & pid, double value,
+              DataLogTimePoint time = std::chrono::steady_clock::now()) noexcept;
+
+    // Returns the number of samples dropped because the buffer was full
+    inline std::size_t dropped() const noexcept { return dropped_.load(std::memory_order_relaxed); }
+
+    // Returns the number of samples added to the log
+    inline std::size_t stored() const noexcept { return stored_.load(std::memory_order_relaxed); }
+
+private:
+    struct Sample
+    {
+        const Pid * pid;
+        double value;
+        DataLogTimePoint time;
+    };
+
+    DataLog & log_;
+    SpscRing<Sample> ring_;
+    std::atomic<std::size_t> dropped_{0};
+    std::atomic<std::size_t> stored_{0};
+    std::atomic<bool> running_{false};
+
+    /* Copies of pushed PIDs. Only the producer adds to these; the
+     * storage thread reads the copies through the pointers in the
+     * ring, which stay valid because list nodes never move. */
+    std::forward_list<Pid> pids_;
+    std::unordered_map<uint16_t, const Pid *> known_;
+
+    std::thread thread_;
+
+    void run();
+    std::size_t store();
+};
+
+} // namespace lt
+
+#endif // LT_DATALOGINGEST_H
@@ -0,0 +1,393 @@
+/*
+ * LibreTuner
+ * Copyright (C) 2018 Altenius
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "formula.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+
+namespace lt
+{
+
+namespace
+{
+constexpr double NaN = std::numeric_limits<double>::quiet_NaN();
+
+// Converts `value` to an integer operand. Returns false if it is not
+// finite or does not fit in int64_t.
+bool toInteger(double value, int64_t & out) noexcept
+{
+    // -2^63 and 2^63 are exact; NaN fails both comparisons
+    if (!(value >= -9223372036854775808.0 && value < 9223372036854775808.0))
+        return false;
+    out = static_cast<int64_t>(value);
+    return true;
+}
+
+double apply(Formula::Op op, double lhs, double rhs) noexcept
+{
+    switch (op)
+    {
+    case Formula::Op::Add:
+        return lhs + rhs;
+    case Formula::Op::Sub:
+        return lhs - rhs;
+    case Formula::Op::Mul:
+        return lhs * rhs;
+    case Formula::Op::Div:
+        return lhs / rhs;
+    case Formula::Op::Pow:
+        return std::pow(lhs, rhs);
+    case Formula::Op::Mod:
+    case Formula::Op::Shl:
+    case Formula::Op::Shr:
+        break;
+    default:
+        return lhs;
+    }
+
+    // Integer operators, matching the previous cparse behaviour. Operands
+    // that are not integers in range give NaN.
+    int64_t a;
+    int64_t b;
+    if (!toInteger(lhs, a) || !toInteger(rhs, b))
+        return NaN;
+    if (op == Formula::Op::Mod)
+    {
+        if (b == 0)
+            return NaN;
+        // INT64_MIN % -1 overflows
+        if (b == -1)
+            return 0.0;
+        return static_cast<double>(a % b);
+    }
+
+    if (b < 0 || b > 63)
+        return NaN;
+    const auto count = static_cast<unsigned>(b);
+    if (op == Formula::Op::Shl)
+        return static_cast<double>(static_cast<int64_t>(static_cast<uint64_t>(a) << count));
+    // Arithmetic shift without shifting a negative value
+    return static_cast<double>(a >= 0 ? a >> count : ~(~a >> count));
+}
+} // namespace
+
+// Recursive descent compiler. Each rule returns a program fragment that
+// leaves exactly one value on the stack.
+class FormulaCompiler
+{
+public:
+    using Instruction = Formula::Instruction;
+    using Op = Formula::Op;
+    using Source = Formula::Source;
+
+    explicit FormulaCompiler(const std::string & expression) : expr_(expression) {}
+
+    Formula compile()
+    {
+        Fragment fragment = parseShift();
+        skipWhitespace();
+        if (pos_ != expr_.size())
+            fail("unexpected character '" + std::string(1, expr_[pos_]) + "'");
+        if (fragment.depth > Formula::MaxStack)
+            fail("expression is too deeply nested");
+
+        Formula formula;
+        formula.program_ = std::move(fragment.code);
+        formula.variables_ = variables_;
+        return formula;
+    }
+
+private:
+    struct Fragment
+    {
+        std::vector<Instruction> code;
+        // Maximum stack depth reached while executing the fragment
+        int depth{1};
+
+        bool isPush() const noexcept { return code.size() == 1 && code.front().op == Op::Push; }
+        bool isConstant() const noexcept { return isPush() && code.front().source == Source::Constant; }
+        double constant() const noexcept { return code.front().value; }
+    };
+
+    const std::string & expr_;
+    std::size_t pos_{0};
+    int variables_{0};
+
+    [[noreturn]] void fail(const std::string & message) const
+    {
+        throw std::runtime_error("formula '" + expr_ + "': " + message);
+    }
+
+    void skipWhitespace() noexcept
+    {
+        while (pos_ < expr_.size() && std::isspace(static_cast<unsigned char>(expr_[pos_])))
+            ++pos_;
+    }
+
+    // Consumes `token` if it is next in the input
+    bool accept(const char * token) noexcept
+    {
+        skipWhitespace();
+        std::size_t len = std::char_traits<char>::length(token);
+        if (expr_.compare(pos_, len, token) != 0)
+            return false;
+        pos_ += len;
+        return true;
+    }
+
+    static Fragment constant(double value)
+    {
+        Fragment fragment;
+        fragment.code.push_back(Instruction{Op::Push, Source::Constant, 0, value});
+        return fragment;
+    }
+
+    static Fragment binary(Fragment && lhs, Fragment && rhs, Op op)
+    {
+        // Fold constant subexpressions
+        if (lhs.isConstant() && rhs.isConstant())
+            return constant(apply(op, lhs.constant(), rhs.constant()));
+
+        if (rhs.isPush())
+        {
+            // Use the operand directly instead of pushing it
+            Instruction instruction = rhs.code.front();
+            instruction.op = op;
+
+            if (instruction.source == Source::Constant && mergeConstant(lhs, instruction))
+                return std::move(lhs);
+
+            lhs.code.push_back(instruction);
+            return std::move(lhs);
+        }
+
+        lhs.depth = std::max(lhs.depth, rhs.depth + 1);
+        lhs.code.insert(lhs.code.end(), rhs.code.begin(), rhs.code.end());
+        lhs.code.push_back(Instruction{op, Source::Stack, 0, 0.0});
+        return std::move(lhs);
+    }
+
+    /* Merges a constant scale or offset into a preceding operation of the
+     * same kind, e.g. `x * 100 / 65536` becomes `x * 0.00152587890625`.
+     * Returns true if `next` was merged. */
+    static bool mergeConstant(Fragment & fragment, const Instruction & next)
+    {
+        if (fragment.code.size() < 2)
+            return false;
+
+        Instruction & prev = fragment.code.back();
+        if (prev.source != Source::Constant)
+            return false;
+
+        auto isScale = [](Op op) { return op == Op::Mul || op == Op::Div; };
+        auto isOffset = [](Op op) { return op == Op::Add || op == Op::Sub; };
+
+        if (isScale(prev.op) && isScale(next.op))
+        {
+            double factor = prev.op == Op::Mul ? prev.value : 1.0 / prev.value;
+            factor = next.op == Op::Mul ? factor * next.value : factor / next.value;
+            prev.op = Op::Mul;
+            prev.value = factor;
+            return true;
+        }
+        if (isOffset(prev.op) && isOffset(next.op))
+        {
+            double offset = prev.op == Op::Add ? prev.value : -prev.value;
+            offset = next.op == Op::Add ? offset + next.value : offset - next.value;
+            prev.op = Op::Add;
+            prev.value = offset;
+            return true;
+        }
+        return false;
+    }
+
+    // shift := additive (('<<' | '>>') additive)*
+    Fragment parseShift()
+    {
+        Fragment lhs = parseAdditive();
+        while (true)
+        {
+            if (accept("<<"))
+                lhs = binary(std::move(lhs), parseAdditive(), Op::Shl);
+            else if (accept(">>"))
+                lhs = binary(std::move(lhs), parseAdditive(), Op::Shr);
+            else
+                return lhs;
+        }
+    }
+
+    // additive := multiplicative (('+' | '-') multiplicative)*
+    Fragment parseAdditive()
+    {
+        Fragment lhs = parseMultiplicative();
+        while (true)
+        {
+            if (accept("+"))
+                lhs = binary(std::move(lhs), parseMultiplicative(), Op::Add);
+            else if (accept("-"))
+                lhs = binary(std::move(lhs), parseMultiplicative(), Op::Sub);
+            else
+                return lhs;
+        }
+    }
+
+    // multiplicative := unary (('*' | '/' | '%') unary)*
+    Fragment parseMultiplicative()
+    {
+        Fragment lhs = parseUnary();
+        while (true)
+        {
+            skipWhitespace();
+            // Do not mistake the power operator for multiplication
+            if (expr_.compare(pos_, 2, "**") != 0 && accept("*"))
+                lhs = binary(std::move(lhs), parseUnary(), Op::Mul);
+            else if (accept("/"))
+                lhs = binary(std::move(lhs), parseUnary(), Op::Div);
+            else if (accept("%"))
+                lhs = binary(std::move(lhs), parseUnary(), Op::Mod);
+            else
+                return lhs;
+        }
+    }
+
+    // unary := ('-' | '+') unary | power
+    Fragment parseUnary()
+    {
+        if (accept("-"))
+        {
+            Fragment operand = parseUnary();
+            if (operand.isConstant())
+                return constant(-operand.constant());
+            operand.code.push_back(Instruction{Op::Neg, Source::Stack, 0, 0.0});
+            return operand;
+        }
+        if (accept("+"))
+            return parseUnary();
+        return parsePower();
+    }
+
+    // power := primary ('**' unary)?
+    Fragment parsePower()
+    {
+        Fragment base = parsePrimary();
+        if (accept("**"))
+            return binary(std::move(base), parseUnary(), Op::Pow);
+        return base;
+    }
+
+    // primary := number | variable | '(' shift ')'
+    Fragment parsePrimary()
+    {
+        skipWhitespace();
+        if (pos_ >= expr_.size())
+            fail("unexpected end of expression");
+
+        char c = expr_[pos_];
+        if (c == '(')
+        {
+            ++pos_;
+            Fragment inner = parseShift();
+            if (!accept(")"))
+                fail("expected ')'");
+            return inner;
+        }
+
+        if (std::isdigit(static_cast<unsigned char>(c)) || c == '.')
+        {
+            const char * begin = expr_.c_str() + pos_;
+            char * end = nullptr;
+            double value = std::strtod(begin, &end);
+            if (end == begin)
+                fail("invalid number");
+            pos_ += static_cast<std::size_t>(end - begin);
+            return constant(value);
+        }
+
+        if (std::isalpha(static_cast<unsigned char>(c)) || c == '_')
+        {
+            std::size_t start = pos_;
+            while (pos_ < expr_.size() &&
+                   (std::isalnum(static_cast<unsigned char>(expr_[pos_])) || expr_[pos_] == '_'))
+                ++pos_;
+
+            std::string name = expr_.substr(start, pos_ - start);
+            if (name.size() != 1 || name[0] < 'a' || name[0] >= 'a' + Formula::MaxVariables)
+                fail("unknown identifier '" + name + "'");
+
+            auto slot = static_cast<uint8_t>(name[0] - 'a');
+            variables_ = std::max(variables_, slot + 1);
+
+            Fragment fragment;
+            fragment.code.push_back(Instruction{Op::Push, Source::Variable, slot, 0.0});
+            return fragment;
+        }
+
+        fail("unexpected character '" + std::string(1, c) + "'");
+    }
+};
+
+Formula Formula::compile(const std::string & expression) { return FormulaCompiler(expression).compile(); }
+
+double Formula::evaluate(const uint8_t * vars, std::size_t count) const noexcept
+{
+    std::array<double, MaxStack> stack;
+    int sp = 0;
+
+    auto operand = [&](const Instruction & instruction) -> double {
+        switch (instruction.source)
+        {
+        case Source::Constant:
+            return instruction.value;
+        case Source::Variable:
+            return instruction.slot < count ? vars[instruction.slot] : 0.0;
+        case Source::Stack:
+        default:
+            return stack[--sp];
+        }
+    };
+
+    for (const Instruction & instruction : program_)
+    {
+        switch (instruction.op)
+        {
+        case Op::Push:
+            stack[sp] = operand(instruction);
+            ++sp;
+            break;
+        case Op::Neg:
+            stack[sp - 1] = -stack[sp - 1];
+            break;
+        default:
+        {
+            double rhs = operand(instruction);
+            stack[sp - 1] = apply(instruction.op, stack[sp - 1], rhs);
+            break;
+        }
+        }
+    }
+
+    return sp == 0 ? 0.0 : stack[sp - 1];
+}
+
+} // namespace lt
@@ -0,0 +1,107 @@
+/*
+ * LibreTuner
+ * Copyright (C) 2018 Altenius
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LT_FORMULA_H
+#define LT_FORMULA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace lt
+{
+
+/* A PID formula compiled into a flat stack program. Variables `a`, `b`,
+ * `c`, ... refer to the bytes of the PID response and are bound by slot
+ * index, so evaluating a compiled formula performs no lookups and no
+ * allocations.
+ *
+ * Supported syntax: numeric literals, variables `a` through `h`,
+ * parentheses, unary `+`/`-`, `**` (power), `*`, `/`, `%` (integer
+ * remainder), `+`, `-`, `<<` and `>>` (integer shifts). The integer
+ * operators give NaN for operands that are not finite or do not fit in
+ * 64 bits, a zero divisor, and shift counts outside [0, 63]. */
+class Formula
+{
+public:
+    static constexpr int MaxVariables = 8;
+    static constexpr int MaxStack = 16;
+
+    // Constructs a formula that always evaluates to 0
+    Formula() = default;
+
+    /* Compiles `expression`. Constant subexpressions are folded and
+     * chained constant scale/offset operations are merged. Throws an
+     * exception if the expression uses unsupported syntax. */
+    static Formula compile(const std::string & expression);
+
+    /* Evaluates the formula. Variable slot `i` is bound to `vars[i]`.
+     * Slots beyond `count` evaluate to 0. */
+    double evaluate(const uint8_t * vars, std::size_t count) const noexcept;
+
+    /* Returns the number of variable slots the formula reads
+     * (the highest referenced slot + 1). */
+    inline int variables() const noexcept { return variables_; }
+
+    // Returns true if the formula does not depend on any variable
+    inline bool constant() const noexcept { return variables_ == 0; }
+
+    // Returns the number of instructions in the compiled program
+    inline std::size_t size() const noexcept { return program_.size(); }
+
+    enum class Op : uint8_t
+    {
+        Push,
+        Neg,
+        Add,
+        Sub,
+        Mul,
+        Div,
+        Mod,
+        Pow,
+        Shl,
+        Shr,
+    };
+
+    // Where the (right hand) operand of an instruction comes from
+    enum class Source : uint8_t
+    {
+        Stack,
+        Constant,
+        Variable,
+    };
+
+    struct Instruction
+    {
+        Op op;
+        Source source;
+        uint8_t slot;
+        double value;
+    };
+
+private:
+    std::vector<Instruction> program_;
+    int variables_{0};
+
+    friend class FormulaCompiler;
+};
+
+} // namespace lt
+
+#endif // LT_FORMULA_H
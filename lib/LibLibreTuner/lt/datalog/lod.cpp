@@ -0,0 +1,112 @@
+/*
+ * LibreTuner
+ * Copyright (C) 2018 Altenius
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "lod.h"
+
+#include <algorithm>
+
+#include "pidlog.h"
+
+namespace lt
+{
+
+LodBucket LodBucket::from(const PidLogEntry & entry) noexcept
+{
+    return LodBucket{entry.value, entry.value, entry.value, entry.value, entry.time, entry.time};
+}
+
+void LodBucket::add(const PidLogEntry & entry) noexcept
+{
+    last = entry.value;
+    lastTime = entry.time;
+    min = std::min(min, entry.value);
+    max = std::max(max, entry.value);
+}
+
+void LodBucket::merge(const LodBucket & next) noexcept
+{
+    last = next.last;
+    lastTime = next.lastTime;
+    min = std::min(min, next.min);
+    max = std::max(max, next.max);
+}
+
+void LodPyramid::append(const PidLogEntry & entry)
+{
+    std::size_t index = size_++;
+
+    if (levels_.empty())
+    {
+        levels_.emplace_back();
+    }
+
+    for (std::size_t l = 0; l < levels_.size(); ++l)
+    {
+        std::vector<LodBucket> & buckets = levels_[l];
+        std::size_t bucket = index >> (MinLevel + l);
+        if (bucket == buckets.size())
+        {
+            buckets.push_back(LodBucket::from(entry));
+        }
+        else
+        {
+            buckets.back().add(entry);
+        }
+    }
+
+    // Add a coarser level once the top level has more than two buckets
+    while (levels_.back().size() > 2)
+    {
+        const std::vector<LodBucket> & finer = levels_.back();
+        std::vector<LodBucket> coarser;
+        coarser.reserve(finer.size() / 2 + 1);
+        for (std::size_t i = 0; i < finer.size(); i += 2)
+        {
+            LodBucket bucket = finer[i];
+            if (i + 1 < finer.size())
+            {
+                bucket.merge(finer[i + 1]);
+            }
+            coarser.push_back(bucket);
+        }
+        levels_.emplace_back(std::move(coarser));
+    }
+}
+
+int LodPyramid::levelFor(std::size_t samples, std::size_t maxBuckets) const noexcept
+{
+    if (maxBuckets == 0 || samples <= maxBuckets * 4 || levels_.empty())
+    {
+        return 0;
+    }
+
+    int level = MinLevel;
+    while (level < maxLevel() && (samples >> level) >= maxBuckets)
+    {
+        ++level;
+    }
+    return level;
+}
+
+void LodPyramid::clear() noexcept
+{
+    levels_.clear();
+    size_ = 0;
+}
+
+} // namespace lt
@@ -0,0 +1,92 @@
+/*
+ * LibreTuner
+ * Copyright (C) 2018 Altenius
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LT_LOD_H
+#define LT_LOD_H
+
+#include <cstddef>
+#include <vector>
+
+namespace lt
+{
+
+struct PidLogEntry;
+
+// Summary of a run of consecutive samples
+struct LodBucket
+{
+    double first;
+    double last;
+    double min;
+    double max;
+    std::size_t firstTime;
+    std::size_t lastTime;
+
+    static LodBucket from(const PidLogEntry & entry) noexcept;
+
+    // Extends the bucket with a sample that follows it
+    void add(const PidLogEntry & entry) noexcept;
+
+    // Extends the bucket with a bucket that follows it
+    void merge(const LodBucket & next) noexcept;
+};
+
+/* Min/max decimation pyramid. Level `l` summarizes the samples in
+ * buckets of 2^l consecutive samples, so bucket `i` of level `l` covers
+ * samples [i << l, (i + 1) << l). Levels below MinLevel are not stored;
+ * level 0 stands for the raw samples. The pyramid is updated in
+ * O(levels) per appended sample. */
+class LodPyramid
+{
+public:
+    static constexpr int MinLevel = 4;
+
+    // Adds the next sample
+    void append(const PidLogEntry & entry);
+
+    // Returns the number of summarized samples
+    inline std::size_t size() const noexcept { return size_; }
+
+    // Returns the highest stored level, or 0 if there is none
+    inline int maxLevel() const noexcept
+    {
+        return levels_.empty() ? 0 : MinLevel + static_cast<int>(levels_.size()) - 1;
+    }
+
+    // Returns the buckets of `level`, which must be a stored level
+    inline const std::vector<LodBucket> & level(int level) const noexcept
+    {
+        return levels_[static_cast<std::size_t>(level - MinLevel)];
+    }
+
+    /* Returns the finest level that draws `samples` samples with at
+     * most `maxBuckets` buckets, or 0 if the raw samples should be drawn
+     * (at most 4 * maxBuckets samples, matching the 4 points drawn per
+     * bucket). */
+    int levelFor(std::size_t samples, std::size_t maxBuckets) const noexcept;
+
+    void clear() noexcept;
+
+private:
+    std::vector<std::vector<LodBucket>> levels_;
+    std::size_t size_{0};
+};
+
+} // namespace lt
+
+#endif // LT_LOD_H
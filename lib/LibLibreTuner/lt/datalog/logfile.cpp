@@ -0,0 +1,682 @@
+/*
+ * LibreTuner
+ * Copyright (C) 2018 Altenius
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "logfile.h"
+
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include "../support/checksumkernels.h"
+#include "../support/endianness.h"
+
+namespace lt
+{
+
+namespace
+{
+constexpr uint32_t fourcc(char a, char b, char c, char d)
+{
+    return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) | (static_cast<uint32_t>(c) << 16) |
+           (static_cast<uint32_t>(d) << 24);
+}
+
+constexpr uint32_t FileMagic = fourcc('L', 'T', 'L', 'G');
+constexpr uint32_t FooterMagic = fourcc('L', 'T', 'I', 'X');
+constexpr uint32_t RecordPid = fourcc('P', 'I', 'D', 'H');
+constexpr uint32_t RecordChunk = fourcc('C', 'H', 'N', 'K');
+constexpr uint32_t RecordIndex = fourcc('I', 'N', 'D', 'X');
+
+constexpr std::size_t HeaderSize = 16;
+constexpr std::size_t RecordHeaderSize = 16;
+constexpr std::size_t FooterSize = 16;
+constexpr std::size_t ChunkHeaderSize = 32;
+constexpr std::size_t PidHeaderSize = 24;
+constexpr std::size_t IndexEntrySize = 48;
+
+constexpr std::size_t align8(std::size_t size) { return (size + 7) & ~std::size_t(7); }
+
+// Little endian encoder
+class Encoder
+{
+public:
+    explicit Encoder(std::vector<uint8_t> & out) : out_(out) {}
+
+    template <typename T> void put(T value)
+    {
+        T le = endian::toLittle(value);
+        auto * bytes = reinterpret_cast<const uint8_t *>(&le);
+        out_.insert(out_.end(), bytes, bytes + sizeof(T));
+    }
+
+    void putDouble(double value)
+    {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        put(bits);
+    }
+
+    void putBytes(const std::string & str) { out_.insert(out_.end(), str.begin(), str.end()); }
+
+    void pad() { out_.resize(align8(out_.size()), 0); }
+
+private:
+    std::vector<uint8_t> & out_;
+};
+
+template <typename T> T get(const uint8_t * data) noexcept
+{
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return endian::fromLittle(value);
+}
+
+double getDouble(const uint8_t * data) noexcept
+{
+    auto bits = get<uint64_t>(data);
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+} // namespace
+
+DataLogWriter::DataLogWriter(const std::string & path) : path_(path)
+{
+    out_.open(path, std::ios::binary | std::ios::trunc);
+    if (!out_)
+    {
+        throw std::runtime_error("failed to open " + path + " for writing");
+    }
+
+    std::vector<uint8_t> header;
+    Encoder enc(header);
+    enc.put<uint32_t>(FileMagic);
+    enc.put<uint16_t>(logfile::Version);
+    enc.put<uint16_t>(0);
+    enc.put<uint32_t>(logfile::ChunkCapacity);
+    enc.put<uint32_t>(0);
+
+    out_.write(reinterpret_cast<const char *>(header.data()), header.size());
+    out_.flush();
+    offset_ = header.size();
+}
+
+DataLogWriter::~DataLogWriter()
+{
+    try
+    {
+        close();
+    }
+    catch (...)
+    {
+    }
+}
+
+DataLogWriter::Channel & DataLogWriter::addPid(const Pid & pid)
+{
+    auto it = channels_.find(pid.code);
+    if (it != channels_.end())
+    {
+        return it->second;
+    }
+
+    auto index = static_cast<uint32_t>(channels_.size());
+
+    std::vector<uint8_t> payload;
+    Encoder enc(payload);
+    enc.put<uint32_t>(index);
+    enc.put<uint16_t>(pid.code);
+    enc.put<uint16_t>(0);
+    enc.putDouble(pid.rate);
+    for (const std::string * str : {&pid.name, &pid.unit, &pid.formula, &pid.description})
+    {
+        enc.put<uint16_t>(static_cast<uint16_t>(std::min<std::size_t>(str->size(), 0xFFFF)));
+    }
+    for (const std::string * str : {&pid.name, &pid.unit, &pid.formula, &pid.description})
+    {
+        enc.putBytes(str->substr(0, 0xFFFF));
+    }
+    enc.pad();
+
+    writeRecord(RecordPid, payload, IndexEntry{RecordPid, index, 0, 0, 0, 0, 0});
+
+    Channel channel;
+    channel.index = index;
+    channel.pending.reserve(logfile::ChunkCapacity);
+    return channels_.emplace(pid.code, std::move(channel)).first->second;
+}
+
+void DataLogWriter::append(Channel & channel, const PidLogEntry & entry)
+{
+    if (!channel.pending.empty())
+    {
+        std::size_t base = channel.pending.front().time;
+        // Time offsets are 32-bit and relative to the first sample
+        if (entry.time < base || entry.time - base > std::numeric_limits<uint32_t>::max())
+        {
+            flush(channel);
+        }
+    }
+
+    channel.pending.push_back(entry);
+    if (channel.pending.size() == logfile::ChunkCapacity)
+    {
+        flush(channel);
+    }
+}
+
+void DataLogWriter::flush(Channel & channel)
+{
+    const std::vector<PidLogEntry> & samples = channel.pending;
+    if (samples.empty())
+    {
+        return;
+    }
+
+    std::size_t base = samples.front().time;
+    double min = samples.front().value;
+    double max = min;
+    for (const PidLogEntry & sample : samples)
+    {
+        min = std::min(min, sample.value);
+        max = std::max(max, sample.value);
+    }
+
+    std::vector<uint8_t> payload;
+    payload.reserve(ChunkHeaderSize + align8(samples.size() * 4) + samples.size() * 8);
+    Encoder enc(payload);
+    enc.put<uint32_t>(channel.index);
+    enc.put<uint32_t>(static_cast<uint32_t>(samples.size()));
+    enc.put<uint64_t>(base);
+    enc.putDouble(min);
+    enc.putDouble(max);
+    for (const PidLogEntry & sample : samples)
+    {
+        enc.put<uint32_t>(static_cast<uint32_t>(sample.time - base));
+    }
+    enc.pad();
+    for (const PidLogEntry & sample : samples)
+    {
+        enc.putDouble(sample.value);
+    }
+
+    writeRecord(RecordChunk, payload,
+                IndexEntry{RecordChunk, channel.index, 0, base, static_cast<uint32_t>(samples.size()), min, max});
+    channel.pending.clear();
+}
+
+void DataLogWriter::writeRecord(uint32_t type, const std::vector<uint8_t> & payload, IndexEntry entry)
+{
+    std::vector<uint8_t> header;
+    Encoder enc(header);
+    enc.put<uint32_t>(type);
+    enc.put<uint32_t>(static_cast<uint32_t>(payload.size()));
+    enc.put<uint32_t>(checksum::crc32(payload.data(), payload.size()));
+    enc.put<uint32_t>(0);
+
+    out_.write(reinterpret_cast<const char *>(header.data()), header.size());
+    out_.write(reinterpret_cast<const char *>(payload.data()), payload.size());
+    if (!out_)
+    {
+        throw std::runtime_error("failed to write to " + path_);
+    }
+
+    entry.offset = offset_;
+    offset_ += header.size() + payload.size();
+    if (type != RecordIndex)
+    {
+        index_.push_back(entry);
+    }
+}
+
+void DataLogWriter::write(const DataLog & log)
+{
+    auto lock = log.lock();
+    for (const auto & [code, pidLog] : log.logs())
+    {
+        Channel & channel = addPid(pidLog.pid);
+        pidLog.forEach([&](const PidLogEntry & entry) { append(channel, entry); });
+        flush(channel);
+    }
+    out_.flush();
+}
+
+void DataLogWriter::attach(DataLog & log)
+{
+    connection_ = log.onAdd([this](const PidLog & pidLog, const PidLogEntry & entry) {
+        bool notify;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (channels_.find(pidLog.pid.code) == channels_.end() &&
+                std::none_of(newPids_.begin(), newPids_.end(),
+                             [&](const Pid & pid) { return pid.code == pidLog.pid.code; }))
+            {
+                newPids_.push_back(pidLog.pid);
+            }
+            queue_.push_back(Sample{pidLog.pid.code, entry});
+            notify = queue_.size() >= logfile::ChunkCapacity;
+        }
+        if (notify)
+        {
+            cv_.notify_one();
+        }
+    });
+
+    thread_ = std::thread([this]() { run(); });
+}
+
+void DataLogWriter::run()
+{
+    std::vector<Sample> samples;
+    std::vector<Pid> pids;
+    auto lastFlush = std::chrono::steady_clock::now();
+
+    while (true)
+    {
+        bool stop;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait_for(lock, std::chrono::seconds(1),
+                         [this]() { return stop_ || queue_.size() >= logfile::ChunkCapacity; });
+            std::swap(samples, queue_);
+            std::swap(pids, newPids_);
+            stop = stop_;
+
+            // Channels are only added here, under the lock, so the
+            // callback can check for known PIDs
+            for (const Pid & pid : pids)
+            {
+                try
+                {
+                    addPid(pid);
+                }
+                catch (...)
+                {
+                    error_ = std::current_exception();
+                    return;
+                }
+            }
+        }
+
+        try
+        {
+            for (const Sample & sample : samples)
+            {
+                append(channels_.at(sample.code), sample.entry);
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            if (stop || now - lastFlush >= FlushInterval)
+            {
+                for (auto & channel : channels_)
+                {
+                    flush(channel.second);
+                }
+                lastFlush = now;
+            }
+            out_.flush();
+        }
+        catch (...)
+        {
+            error_ = std::current_exception();
+            return;
+        }
+
+        samples.clear();
+        pids.clear();
+        if (stop)
+        {
+            return;
+        }
+    }
+}
+
+void DataLogWriter::close()
+{
+    if (closed_)
+    {
+        return;
+    }
+    closed_ = true;
+
+    connection_.reset();
+    if (thread_.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_one();
+        thread_.join();
+    }
+
+    if (error_)
+    {
+        out_.close();
+        std::rethrow_exception(error_);
+    }
+
+    for (auto & channel : channels_)
+    {
+        flush(channel.second);
+    }
+
+    std::vector<uint8_t> payload;
+    payload.reserve(8 + index_.size() * IndexEntrySize);
+    Encoder enc(payload);
+    enc.put<uint32_t>(static_cast<uint32_t>(index_.size()));
+    enc.put<uint32_t>(0);
+    for (const IndexEntry & entry : index_)
+    {
+        enc.put<uint32_t>(entry.type);
+        enc.put<uint32_t>(entry.pid);
+        enc.put<uint64_t>(entry.offset);
+        enc.put<uint64_t>(entry.baseTime);
+        enc.put<uint32_t>(entry.count);
+        enc.put<uint32_t>(0);
+        enc.putDouble(entry.min);
+        enc.putDouble(entry.max);
+    }
+
+    uint64_t indexOffset = offset_;
+    writeRecord(RecordIndex, payload, IndexEntry{});
+
+    std::vector<uint8_t> footer;
+    Encoder footerEnc(footer);
+    footerEnc.put<uint64_t>(indexOffset);
+    footerEnc.put<uint32_t>(FooterMagic);
+    footerEnc.put<uint32_t>(0);
+    out_.write(reinterpret_cast<const char *>(footer.data()), footer.size());
+
+    out_.close();
+    if (!out_)
+    {
+        throw std::runtime_error("failed to write to " + path_);
+    }
+}
+
+std::size_t DataLogFile::Chunk::time(std::size_t index) const noexcept
+{
+    return baseTime + get<uint32_t>(times + index * 4);
+}
+
+double DataLogFile::Chunk::value(std::size_t index) const noexcept
+{
+    return getDouble(values + index * 8);
+}
+
+LodBucket DataLogFile::Chunk::bucket() const noexcept
+{
+    return LodBucket{value(0), value(count - 1), min, max, baseTime, time(count - 1)};
+}
+
+PidLogEntry DataLogFile::Channel::operator[](std::size_t index) const noexcept
+{
+    auto it = std::upper_bound(chunks_.begin(), chunks_.end(), index,
+                               [](std::size_t i, const Chunk & chunk) { return i < chunk.start; });
+    --it;
+    std::size_t offset = index - it->start;
+    return PidLogEntry{it->value(offset), it->time(offset)};
+}
+
+std::size_t DataLogFile::Channel::lowerBound(std::size_t time) const noexcept
+{
+    // The base time of a chunk is the time of its first sample
+    auto it = std::upper_bound(chunks_.begin(), chunks_.end(), time,
+                               [](std::size_t t, const Chunk & chunk) { return t < chunk.baseTime; });
+    if (it == chunks_.begin())
+    {
+        return 0;
+    }
+    --it;
+
+    std::size_t first = 0;
+    std::size_t count = it->count;
+    while (count > 0)
+    {
+        std::size_t step = count / 2;
+        if (it->time(first + step) < time)
+        {
+            first += step + 1;
+            count -= step + 1;
+        }
+        else
+        {
+            count = step;
+        }
+    }
+    return it->start + first;
+}
+
+DataLogFile::DataLogFile(const std::string & path) : file_(path)
+{
+    const uint8_t * data = file_.data();
+    if (file_.size() < HeaderSize || get<uint32_t>(data) != FileMagic)
+    {
+        throw std::runtime_error(path + " is not a datalog file");
+    }
+    if (get<uint16_t>(data + 4) > logfile::Version)
+    {
+        throw std::runtime_error(path + " was written by a newer version");
+    }
+
+    if (!readIndex())
+    {
+        scan();
+    }
+
+    bool first = true;
+    for (const Channel & channel : channels_)
+    {
+        for (const Chunk & chunk : channel.chunks_)
+        {
+            minValue_ = first ? chunk.min : std::min(minValue_, chunk.min);
+            maxValue_ = first ? chunk.max : std::max(maxValue_, chunk.max);
+            first = false;
+        }
+        if (!channel.chunks_.empty())
+        {
+            const Chunk & last = channel.chunks_.back();
+            maxTime_ = std::max(maxTime_, last.time(last.count - 1));
+        }
+    }
+}
+
+const DataLogFile::Channel * DataLogFile::channel(uint16_t code) const noexcept
+{
+    for (const Channel & channel : channels_)
+    {
+        if (channel.pid_.code == code)
+        {
+            return &channel;
+        }
+    }
+    return nullptr;
+}
+
+bool DataLogFile::readIndex()
+{
+    const uint8_t * data = file_.data();
+    std::size_t size = file_.size();
+    if (size < HeaderSize + RecordHeaderSize + FooterSize)
+    {
+        return false;
+    }
+
+    const uint8_t * footer = data + size - FooterSize;
+    if (get<uint32_t>(footer + 8) != FooterMagic)
+    {
+        return false;
+    }
+
+    std::size_t end = size - FooterSize;
+    auto indexOffset = get<uint64_t>(footer);
+    if (indexOffset < HeaderSize || indexOffset > end - RecordHeaderSize)
+    {
+        return false;
+    }
+
+    const uint8_t * header = data + indexOffset;
+    std::size_t length = get<uint32_t>(header + 4);
+    const uint8_t * payload = header + RecordHeaderSize;
+    if (get<uint32_t>(header) != RecordIndex || length > end - indexOffset - RecordHeaderSize || length < 8 ||
+        checksum::crc32(payload, length) != get<uint32_t>(header + 8))
+    {
+        return false;
+    }
+
+    std::size_t count = get<uint32_t>(payload);
+    if (count > (length - 8) / IndexEntrySize)
+    {
+        return false;
+    }
+
+    try
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const uint8_t * entry = payload + 8 + i * IndexEntrySize;
+            auto type = get<uint32_t>(entry);
+            auto offset = get<uint64_t>(entry + 8);
+            if (offset < HeaderSize || offset > indexOffset - RecordHeaderSize)
+            {
+                throw std::runtime_error("invalid index entry");
+            }
+
+            const uint8_t * record = data + offset;
+            std::size_t recordLength = get<uint32_t>(record + 4);
+            if (recordLength > indexOffset - offset - RecordHeaderSize || get<uint32_t>(record) != type)
+            {
+                throw std::runtime_error("invalid index entry");
+            }
+
+            if (type == RecordPid)
+            {
+                addPid(record + RecordHeaderSize, recordLength);
+            }
+            else if (type == RecordChunk)
+            {
+                addChunk(get<uint32_t>(entry + 4), record + RecordHeaderSize, recordLength,
+                         get<uint32_t>(entry + 24), get<uint64_t>(entry + 16), getDouble(entry + 32),
+                         getDouble(entry + 40));
+            }
+        }
+    }
+    catch (const std::runtime_error &)
+    {
+        channels_.clear();
+        return false;
+    }
+
+    complete_ = true;
+    return true;
+}
+
+void DataLogFile::scan()
+{
+    const uint8_t * data = file_.data();
+    std::size_t size = file_.size();
+
+    std::size_t pos = HeaderSize;
+    try
+    {
+        while (size - pos >= RecordHeaderSize)
+        {
+            const uint8_t * header = data + pos;
+            auto type = get<uint32_t>(header);
+            std::size_t length = get<uint32_t>(header + 4);
+            const uint8_t * payload = header + RecordHeaderSize;
+            if (length > size - pos - RecordHeaderSize ||
+                checksum::crc32(payload, length) != get<uint32_t>(header + 8))
+            {
+                // Incomplete record
+                break;
+            }
+
+            if (type == RecordPid)
+            {
+                addPid(payload, length);
+            }
+            else if (type == RecordChunk)
+            {
+                if (length < ChunkHeaderSize)
+                {
+                    break;
+                }
+                addChunk(get<uint32_t>(payload), payload, length, get<uint32_t>(payload + 4),
+                         get<uint64_t>(payload + 8), getDouble(payload + 16), getDouble(payload + 24));
+            }
+            else
+            {
+                break;
+            }
+
+            pos += RecordHeaderSize + length;
+        }
+    }
+    catch (const std::runtime_error &)
+    {
+        // Keep everything before the corrupt record
+    }
+}
+
+void DataLogFile::addPid(const uint8_t * payload, std::size_t length)
+{
+    if (length < PidHeaderSize || get<uint32_t>(payload) != channels_.size())
+    {
+        throw std::runtime_error("invalid PID record");
+    }
+
+    Pid pid;
+    pid.code = get<uint16_t>(payload + 4);
+    pid.rate = getDouble(payload + 8);
+
+    std::size_t pos = PidHeaderSize;
+    int field = 0;
+    for (std::string * str : {&pid.name, &pid.unit, &pid.formula, &pid.description})
+    {
+        std::size_t strLength = get<uint16_t>(payload + 16 + field * 2);
+        if (strLength > length - pos)
+        {
+            throw std::runtime_error("invalid PID record");
+        }
+        str->assign(reinterpret_cast<const char *>(payload + pos), strLength);
+        pos += strLength;
+        ++field;
+    }
+
+    channels_.emplace_back(std::move(pid));
+}
+
+void DataLogFile::addChunk(uint32_t pid, const uint8_t * payload, std::size_t length, std::size_t count,
+                           std::size_t baseTime, double min, double max)
+{
+    std::size_t valuesOffset = ChunkHeaderSize + align8(count * 4);
+    if (pid >= channels_.size() || count == 0 || count > logfile::ChunkCapacity ||
+        length < valuesOffset + count * 8)
+    {
+        throw std::runtime_error("invalid chunk record");
+    }
+
+    Channel & channel = channels_[pid];
+    channel.chunks_.push_back(
+        Chunk{baseTime, count, channel.size_, min, max, payload + ChunkHeaderSize, payload + valuesOffset});
+    channel.size_ += count;
+}
+
+} // namespace lt
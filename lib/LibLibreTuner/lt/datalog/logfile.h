@@ -0,0 +1,247 @@
+/*
+ * LibreTuner
+ * Copyright (C) 2018 Altenius
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LT_LOGFILE_H
+#define LT_LOGFILE_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../os/mappedfile.h"
+#include "datalog.h"
+
+namespace lt
+{
+
+/* Binary datalog file (.ltlog)
+ *
+ * All values are little endian. The file is a 16 byte header followed
+ * by 8-byte aligned records. Each record starts with a 16 byte header
+ * holding its type, payload length and the CRC32 of the payload.
+ *
+ *   PIDH - PID description (code, rate, name, unit, formula, description)
+ *   CHNK - up to ChunkCapacity samples of one PID: base time, count,
+ *          min/max value, a column of 32-bit time offsets and a column
+ *          of doubles
+ *   INDX - location and summary of every preceding record
+ *
+ * The file ends with a footer pointing at the INDX record. Records are
+ * only ever appended, so a file that was not closed (e.g. after a crash)
+ * is read by scanning records up to the last complete one. */
+namespace logfile
+{
+constexpr uint32_t Version = 1;
+constexpr std::size_t ChunkCapacity = 1024;
+} // namespace logfile
+
+/* Writes a binary datalog. Samples are either written from an existing
+ * DataLog with write() or streamed by a background thread from a
+ * DataLog that is being recorded with attach(). */
+class DataLogWriter
+{
+public:
+    // How often partially filled chunks are written while streaming
+    static constexpr std::chrono::seconds FlushInterval{5};
+
+    // Creates the file at `path`. Throws an exception on failure.
+    explicit DataLogWriter(const std::string & path);
+
+    // Closes the file
+    ~DataLogWriter();
+
+    DataLogWriter(const DataLogWriter &) = delete;
+    DataLogWriter & operator=(const DataLogWriter &) = delete;
+
+    // Writes every sample in `log`. Must not be called after attach().
+    void write(const DataLog & log);
+
+    /* Streams samples added to `log` to the file until close() is
+     * called. The connection is dropped on close(). */
+    void attach(DataLog & log);
+
+    /* Writes buffered samples, the index and the footer, then closes
+     * the file. Throws an exception if a write failed. */
+    void close();
+
+    inline const std::string & path() const noexcept { return path_; }
+
+private:
+    struct IndexEntry
+    {
+        uint32_t type;
+        uint32_t pid;
+        uint64_t offset;
+        uint64_t baseTime;
+        uint32_t count;
+        double min;
+        double max;
+    };
+
+    struct Channel
+    {
+        uint32_t index;
+        std::vector<PidLogEntry> pending;
+    };
+
+    struct Sample
+    {
+        uint16_t code;
+        PidLogEntry entry;
+    };
+
+    std::string path_;
+    std::ofstream out_;
+    uint64_t offset_{0};
+    bool closed_{false};
+
+    std::unordered_map<uint16_t, Channel> channels_;
+    std::vector<IndexEntry> index_;
+
+    // Streaming state
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<Sample> queue_;
+    std::vector<Pid> newPids_;
+    bool stop_{false};
+    DataLog::AddConnectionPtr connection_;
+    std::exception_ptr error_;
+
+    void run();
+
+    Channel & addPid(const Pid & pid);
+    void append(Channel & channel, const PidLogEntry & entry);
+    void flush(Channel & channel);
+    void writeRecord(uint32_t type, const std::vector<uint8_t> & payload, IndexEntry entry);
+};
+
+/* Read-only view of a binary datalog. The file is memory mapped and
+ * samples are decoded on access, so opening a file only reads its
+ * index. */
+class DataLogFile
+{
+public:
+    struct Chunk
+    {
+        std::size_t baseTime;
+        std::size_t count;
+        // Index of the first sample in the channel
+        std::size_t start;
+        double min;
+        double max;
+        const uint8_t * times;
+        const uint8_t * values;
+
+        std::size_t time(std::size_t index) const noexcept;
+        double value(std::size_t index) const noexcept;
+
+        // Returns a summary of the chunk for drawing
+        LodBucket bucket() const noexcept;
+    };
+
+    class Channel
+    {
+    public:
+        explicit Channel(Pid pid) : pid_(std::move(pid)) {}
+
+        inline const Pid & pid() const noexcept { return pid_; }
+        inline std::size_t size() const noexcept { return size_; }
+        inline bool empty() const noexcept { return size_ == 0; }
+        inline const std::vector<Chunk> & chunks() const noexcept { return chunks_; }
+
+        PidLogEntry operator[](std::size_t index) const noexcept;
+
+        /* Returns the index of the first sample with a time not less
+         * than `time`, or size() if there is none. */
+        std::size_t lowerBound(std::size_t time) const noexcept;
+
+        // Calls `func(const PidLogEntry &)` for every sample in [first, last)
+        template <typename Func>
+        void forEach(std::size_t first, std::size_t last, Func && func) const;
+
+    private:
+        Pid pid_;
+        std::vector<Chunk> chunks_;
+        std::size_t size_{0};
+
+        friend class DataLogFile;
+    };
+
+    // Opens and indexes the file at `path`. Throws an exception on failure.
+    explicit DataLogFile(const std::string & path);
+
+    inline const std::vector<Channel> & channels() const noexcept { return channels_; }
+
+    // Returns the channel of `code` or nullptr if it does not exist
+    const Channel * channel(uint16_t code) const noexcept;
+
+    /* Returns false if the file was not closed properly. Samples after
+     * the last complete record are lost in that case. */
+    inline bool complete() const noexcept { return complete_; }
+
+    // Returns the last time in milliseconds with a sample
+    inline std::size_t maxTime() const noexcept { return maxTime_; }
+
+    inline double minValue() const noexcept { return minValue_; }
+    inline double maxValue() const noexcept { return maxValue_; }
+
+private:
+    os::MappedFile file_;
+    std::vector<Channel> channels_;
+    bool complete_{false};
+    std::size_t maxTime_{0};
+    double minValue_{0};
+    double maxValue_{0};
+
+    bool readIndex();
+    void scan();
+    void addPid(const uint8_t * payload, std::size_t length);
+    void addChunk(uint32_t pid, const uint8_t * payload, std::size_t length, std::size_t count,
+                  std::size_t baseTime, double min, double max);
+};
+using DataLogFilePtr = std::shared_ptr<DataLogFile>;
+
+template <typename Func>
+void DataLogFile::Channel::forEach(std::size_t first, std::size_t last, Func && func) const
+{
+    if (first >= last || first >= size_)
+        return;
+
+    auto it = std::upper_bound(chunks_.begin(), chunks_.end(), first,
+                               [](std::size_t index, const Chunk & chunk) { return index < chunk.start; });
+    for (--it; it != chunks_.end() && it->start < last; ++it)
+    {
+        std::size_t begin = first > it->start ? first - it->start : 0;
+        std::size_t end = std::min(it->count, last - it->start);
+        for (std::size_t i = begin; i < end; ++i)
+            func(PidLogEntry{it->value(i), it->time(i)});
+    }
+}
+
+} // namespace lt
+
+#endif // LT_LOGFILE_H
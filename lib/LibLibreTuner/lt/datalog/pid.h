@@ -13,6 +13,8 @@ struct Pid
     std::string description;
     std::string formula;
     std::string unit;
+    // Target polling rate in Hz. 0 polls as fast as possible.
+    double rate{0};
 };
 } // namespace lt
 
@@ -0,0 +1,364 @@
+/*
+ * LibreTuner
+ * Copyright (C) 2018 Altenius
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pidlog.h"
+
+#include <cassert>
+#include <cstring>
+#include <limits>
+
+namespace lt
+{
+
+namespace
+{
+inline uint64_t toBits(double value) noexcept
+{
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+inline double fromBits(uint64_t bits) noexcept
+{
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+inline int leadingZeros(uint64_t x) noexcept
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return x == 0 ? 64 : __builtin_clzll(x);
+#else
+    int n = 0;
+    for (uint64_t mask = 1ull << 63; mask != 0 && (x & mask) == 0; mask >>= 1)
+        ++n;
+    return n;
+#endif
+}
+
+inline int trailingZeros(uint64_t x) noexcept
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return x == 0 ? 64 : __builtin_ctzll(x);
+#else
+    int n = 0;
+    for (uint64_t mask = 1; mask != 0 && (x & mask) == 0; mask <<= 1)
+        ++n;
+    return n;
+#endif
+}
+
+// MSB-first bit stream over 64-bit words
+class BitWriter
+{
+public:
+    explicit BitWriter(std::vector<uint64_t> & out) : out_(out) {}
+
+    void write(uint64_t value, int bits)
+    {
+        if (bits == 0)
+            return;
+        if (bits < 64)
+            value &= (1ull << bits) - 1;
+
+        int free = 64 - used_;
+        if (used_ == 0)
+            out_.push_back(0);
+
+        if (bits <= free)
+        {
+            out_.back() |= value << (free - bits);
+            used_ = (used_ + bits) % 64;
+            return;
+        }
+
+        int rest = bits - free;
+        out_.back() |= value >> rest;
+        out_.push_back(value << (64 - rest));
+        used_ = rest;
+    }
+
+private:
+    std::vector<uint64_t> & out_;
+    int used_{0};
+};
+
+class BitReader
+{
+public:
+    explicit BitReader(const uint64_t * data) : data_(data) {}
+
+    uint64_t read(int bits) noexcept
+    {
+        if (bits == 0)
+            return 0;
+
+        int available = 64 - used_;
+        uint64_t value;
+        if (bits <= available)
+        {
+            value = (*data_ << used_) >> (64 - bits);
+            used_ += bits;
+        }
+        else
+        {
+            int rest = bits - available;
+            value = ((*data_ << used_) >> (64 - available)) << rest;
+            value |= data_[1] >> (64 - rest);
+            used_ = 64 + rest;
+        }
+
+        if (used_ >= 64)
+        {
+            ++data_;
+            used_ -= 64;
+        }
+        return value;
+    }
+
+private:
+    const uint64_t * data_;
+    int used_{0};
+};
+
+/* Decodes XOR-compressed values. Each value is XORed with its
+ * predecessor and only the meaningful (non-zero) bits are stored:
+ *   '0'                     - same as the previous value
+ *   '10' <bits>             - meaningful bits fit the previous window
+ *   '11' <lz:5> <len:6> <bits> - new window */
+template <typename Output>
+void decodeValues(const std::vector<uint64_t> & bits, std::size_t count, Output && output) noexcept
+{
+    if (count == 0)
+        return;
+
+    BitReader reader(bits.data());
+    uint64_t prev = reader.read(64);
+    output(0, fromBits(prev));
+
+    int lead = 0;
+    int trail = 0;
+    for (std::size_t i = 1; i < count; ++i)
+    {
+        if (reader.read(1) != 0)
+        {
+            if (reader.read(1) != 0)
+            {
+                lead = static_cast<int>(reader.read(5));
+                int length = static_cast<int>(reader.read(6));
+                if (length == 0)
+                    length = 64;
+                trail = 64 - lead - length;
+            }
+            prev ^= reader.read(64 - lead - trail) << trail;
+        }
+        output(i, fromBits(prev));
+    }
+}
+} // namespace
+
+PidLogChunk::PidLogChunk(std::size_t baseTime, ValuePrecision precision)
+    : baseTime_(baseTime), precision_(precision)
+{
+    times_.reserve(Capacity);
+    if (precision_ == ValuePrecision::Float)
+        floats_.reserve(Capacity);
+    else
+        doubles_.reserve(Capacity);
+}
+
+double PidLogChunk::value(std::size_t index) const noexcept
+{
+    if (compressed())
+    {
+        double result = 0.0;
+        decodeValues(bits_, index + 1, [&](std::size_t, double value) { result = value; });
+        return result;
+    }
+    if (precision_ == ValuePrecision::Float)
+        return floats_[index];
+    return doubles_[index];
+}
+
+bool PidLogChunk::accepts(std::size_t time) const noexcept
+{
+    return !full() && !compressed() && time >= baseTime_ &&
+           time - baseTime_ <= std::numeric_limits<uint32_t>::max();
+}
+
+void PidLogChunk::append(const PidLogEntry & entry)
+{
+    assert(accepts(entry.time));
+    times_.push_back(static_cast<uint32_t>(entry.time - baseTime_));
+    if (precision_ == ValuePrecision::Float)
+        floats_.push_back(static_cast<float>(entry.value));
+    else
+        doubles_.push_back(entry.value);
+}
+
+void PidLogChunk::decode(double * out) const noexcept
+{
+    if (compressed())
+    {
+        decodeValues(bits_, size(), [out](std::size_t i, double value) { out[i] = value; });
+    }
+    else if (precision_ == ValuePrecision::Float)
+    {
+        std::copy(floats_.begin(), floats_.end(), out);
+    }
+    else
+    {
+        std::copy(doubles_.begin(), doubles_.end(), out);
+    }
+}
+
+void PidLogChunk::compress()
+{
+    if (compressed() || size() == 0)
+        return;
+
+    std::vector<double> values(size());
+    decode(values.data());
+
+    std::vector<uint64_t> bits;
+    BitWriter writer(bits);
+
+    uint64_t prev = toBits(values[0]);
+    writer.write(prev, 64);
+
+    // Start with an invalid window so the first change opens a new one
+    int lead = 65;
+    int trail = 0;
+    for (std::size_t i = 1; i < values.size(); ++i)
+    {
+        uint64_t current = toBits(values[i]);
+        uint64_t x = current ^ prev;
+        prev = current;
+
+        if (x == 0)
+        {
+            writer.write(0, 1);
+            continue;
+        }
+
+        int lz = std::min(leadingZeros(x), 31);
+        int tz = trailingZeros(x);
+        if (lead <= 64 && lz >= lead && tz >= trail)
+        {
+            writer.write(0b10, 2);
+            writer.write(x >> trail, 64 - lead - trail);
+            continue;
+        }
+
+        lead = lz;
+        trail = tz;
+        int length = 64 - lead - trail;
+        writer.write(0b11, 2);
+        writer.write(static_cast<uint64_t>(lead), 5);
+        // A length of 64 is stored as 0
+        writer.write(static_cast<uint64_t>(length & 63), 6);
+        writer.write(x >> trail, length);
+    }
+
+    // Noisy data can grow when compressed; keep the raw column then
+    std::size_t raw = precision_ == ValuePrecision::Float ? floats_.size() * sizeof(float)
+                                                          : doubles_.size() * sizeof(double);
+    if (bits.size() * sizeof(uint64_t) >= raw)
+        return;
+
+    bits.shrink_to_fit();
+    bits_ = std::move(bits);
+    times_.shrink_to_fit();
+    doubles_ = std::vector<double>();
+    floats_ = std::vector<float>();
+}
+
+std::size_t PidLogChunk::memoryUsage() const noexcept
+{
+    return times_.capacity() * sizeof(uint32_t) + doubles_.capacity() * sizeof(double) +
+           floats_.capacity() * sizeof(float) + bits_.capacity() * sizeof(uint64_t);
+}
+
+PidLog::PidLog(Pid pid, ValuePrecision precision) : pid(std::move(pid)), precision_(precision) {}
+
+std::size_t PidLog::chunkIndex(std::size_t index) const noexcept
+{
+    auto it = std::upper_bound(starts_.begin(), starts_.end(), index);
+    return static_cast<std::size_t>(std::distance(starts_.begin(), it)) - 1;
+}
+
+PidLogEntry PidLog::operator[](std::size_t index) const noexcept
+{
+    std::size_t c = chunkIndex(index);
+    return chunks_[c]->at(index - starts_[c]);
+}
+
+PidLogEntry PidLog::back() const noexcept
+{
+    const PidLogChunk & chunk = *chunks_.back();
+    return chunk.at(chunk.size() - 1);
+}
+
+void PidLog::append(const PidLogEntry & entry)
+{
+    if (chunks_.empty() || !chunks_.back()->accepts(entry.time))
+    {
+        if (!chunks_.empty() && compressCold_)
+            chunks_.back()->compress();
+
+        chunks_.emplace_back(std::make_unique<PidLogChunk>(entry.time, precision_));
+        starts_.push_back(size_);
+    }
+
+    chunks_.back()->append(entry);
+    // Summarize the stored value, which may have been narrowed to float
+    lod_.append(chunks_.back()->at(chunks_.back()->size() - 1));
+    ++size_;
+}
+
+std::size_t PidLog::lowerBound(std::size_t time) const noexcept
+{
+    // Find the last chunk starting at or before `time`
+    auto it = std::upper_bound(chunks_.begin(), chunks_.end(), time,
+                               [](std::size_t t, const std::unique_ptr<PidLogChunk> & chunk) {
+                                   return t < chunk->time(0);
+                               });
+    if (it == chunks_.begin())
+        return 0;
+    --it;
+
+    const PidLogChunk & chunk = **it;
+    auto offset = static_cast<uint32_t>(std::min<std::size_t>(time - chunk.baseTime(),
+                                                              std::numeric_limits<uint32_t>::max()));
+    auto pos = std::lower_bound(chunk.times().begin(), chunk.times().end(), offset);
+
+    std::size_t c = static_cast<std::size_t>(std::distance(chunks_.begin(), it));
+    return starts_[c] + static_cast<std::size_t>(std::distance(chunk.times().begin(), pos));
+}
+
+std::size_t PidLog::memoryUsage() const noexcept
+{
+    std::size_t usage = 0;
+    for (const auto & chunk : chunks_)
+        usage += chunk->memoryUsage();
+    return usage;
+}
+
+} // namespace lt
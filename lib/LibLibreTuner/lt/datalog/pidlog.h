@@ -0,0 +1,213 @@
+/*
+ * LibreTuner
+ * Copyright (C) 2018 Altenius
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LT_PIDLOG_H
+#define LT_PIDLOG_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "lod.h"
+#include "pid.h"
+
+namespace lt
+{
+
+struct PidLogEntry
+{
+    double value;
+    // Miliseconds since log start
+    std::size_t time;
+};
+
+// Storage precision of logged values
+enum class ValuePrecision
+{
+    Double,
+    Float,
+};
+
+/* A fixed-capacity block of samples in columnar layout. Timestamps are
+ * stored as 32-bit offsets from the chunk's base time. Values are stored
+ * as float or double and can be XOR-compressed (losslessly) once the
+ * chunk is full and no longer written to. */
+class PidLogChunk
+{
+public:
+    static constexpr std::size_t Capacity = 1024;
+
+    PidLogChunk(std::size_t baseTime, ValuePrecision precision);
+
+    inline std::size_t size() const noexcept { return times_.size(); }
+    inline bool full() const noexcept { return size() == Capacity; }
+    inline bool compressed() const noexcept { return !bits_.empty(); }
+    inline ValuePrecision precision() const noexcept { return precision_; }
+
+    // Returns the time of the first sample the chunk can hold
+    inline std::size_t baseTime() const noexcept { return baseTime_; }
+
+    // Returns the time of sample `index`
+    inline std::size_t time(std::size_t index) const noexcept
+    {
+        return baseTime_ + times_[index];
+    }
+
+    // Returns the time offsets from baseTime()
+    inline const std::vector<uint32_t> & times() const noexcept
+    {
+        return times_;
+    }
+
+    /* Returns the value of sample `index`. Random access into a
+     * compressed chunk decodes every preceding value; use decode()
+     * for sequential access. */
+    double value(std::size_t index) const noexcept;
+
+    inline PidLogEntry at(std::size_t index) const noexcept
+    {
+        return PidLogEntry{value(index), time(index)};
+    }
+
+    /* Returns true if a sample at `time` can be appended, i.e. the chunk
+     * is not full and the offset fits in 32 bits. */
+    bool accepts(std::size_t time) const noexcept;
+
+    // Appends a sample. The chunk must accept it and not be compressed.
+    void append(const PidLogEntry & entry);
+
+    // Decodes all values into `out`, which must hold size() values
+    void decode(double * out) const noexcept;
+
+    // Compresses the values. The chunk becomes read-only.
+    void compress();
+
+    // Returns the number of bytes used by the sample columns
+    std::size_t memoryUsage() const noexcept;
+
+private:
+    std::size_t baseTime_;
+    ValuePrecision precision_;
+
+    std::vector<uint32_t> times_;
+    std::vector<double> doubles_;
+    std::vector<float> floats_;
+
+    // XOR-compressed values
+    std::vector<uint64_t> bits_;
+};
+
+/* Samples of one PID, stored as a list of fixed-size chunks so appending
+ * never moves existing samples. */
+struct PidLog
+{
+public:
+    explicit PidLog(Pid pid, ValuePrecision precision = ValuePrecision::Double);
+
+    Pid pid;
+
+    inline std::size_t size() const noexcept { return size_; }
+    inline bool empty() const noexcept { return size_ == 0; }
+
+    // Returns the sample at `index`. See PidLogChunk::value().
+    PidLogEntry operator[](std::size_t index) const noexcept;
+
+    // Returns the last sample. The log must not be empty.
+    PidLogEntry back() const noexcept;
+
+    // Appends a sample. Samples must be appended in time order.
+    void append(const PidLogEntry & entry);
+
+    /* Returns the index of the first sample with a time not less than
+     * `time`, or size() if there is none. */
+    std::size_t lowerBound(std::size_t time) const noexcept;
+
+    /* Calls `func(const PidLogEntry &)` for every sample in
+     * [first, last). Decodes compressed chunks once. */
+    template <typename Func>
+    void forEach(std::size_t first, std::size_t last, Func && func) const;
+
+    template <typename Func> void forEach(Func && func) const
+    {
+        forEach(0, size_, std::forward<Func>(func));
+    }
+
+    /* If true, chunks are compressed once they are full. Only affects
+     * chunks that fill after the call. */
+    inline void setCompressColdChunks(bool compress) noexcept
+    {
+        compressCold_ = compress;
+    }
+
+    inline const std::vector<std::unique_ptr<PidLogChunk>> & chunks() const noexcept
+    {
+        return chunks_;
+    }
+
+    // Returns the decimation pyramid for drawing the log
+    inline const LodPyramid & lod() const noexcept { return lod_; }
+
+    // Returns the number of bytes used by all chunks
+    std::size_t memoryUsage() const noexcept;
+
+private:
+    std::vector<std::unique_ptr<PidLogChunk>> chunks_;
+    LodPyramid lod_;
+    // Index of the first sample of each chunk
+    std::vector<std::size_t> starts_;
+    std::size_t size_{0};
+    ValuePrecision precision_;
+    bool compressCold_{false};
+
+    // Returns the index of the chunk containing sample `index`
+    std::size_t chunkIndex(std::size_t index) const noexcept;
+};
+
+template <typename Func>
+void PidLog::forEach(std::size_t first, std::size_t last, Func && func) const
+{
+    if (first >= last || first >= size_)
+        return;
+
+    double decoded[PidLogChunk::Capacity];
+    for (std::size_t c = chunkIndex(first); c < chunks_.size() && starts_[c] < last; ++c)
+    {
+        const PidLogChunk & chunk = *chunks_[c];
+        std::size_t begin = first > starts_[c] ? first - starts_[c] : 0;
+        std::size_t end = std::min(chunk.size(), last - starts_[c]);
+
+        if (chunk.compressed())
+        {
+            chunk.decode(decoded);
+            for (std::size_t i = begin; i < end; ++i)
+                func(PidLogEntry{decoded[i], chunk.time(i)});
+        }
+        else
+        {
+            for (std::size_t i = begin; i < end; ++i)
+                func(chunk.at(i));
+        }
+    }
+}
+
+} // namespace lt
+
+#endif // LT_PIDLOG_H
@@ -16,14 +16,135 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
 
 #include "checksum.h"
+#include "support/checksumkernels.h"
+#include "support/endianness.h"
+#include "support/intervalset.h"
 #include "support/util.hpp"
 
 namespace lt
 {
 
+namespace
+{
+// Reads a big endian word
+template <typename T = uint32_t> inline T wordBE(const uint8_t * data) noexcept
+{
+    T word;
+    std::memcpy(&word, data, sizeof(word));
+    return endian::convert<T, Endianness::Big, endian::current>(word);
+}
+
+/* Calls `func` with the offset of every `width` byte word of the region
+ * [begin, end) that overlaps a modified range. Ranges never overlap, but
+ * two of them may touch the same word. */
+template <typename Func>
+void forEachModifiedWord(const IntervalSet & modified, int begin, int end, int width, Func && func)
+{
+    int next = begin;
+    for (const auto & [first, last] : modified)
+    {
+        if (last <= next)
+            continue;
+        if (first >= end)
+            break;
+
+        int word = std::max(next, begin + (first - begin) / width * width);
+        int stop = std::min(last, end);
+        for (; word < stop; word += width)
+            func(word);
+        next = word;
+    }
+}
+
+// Calls `func` with the parts of modified ranges within [begin, end)
+template <typename Func> void forEachModifiedRange(const IntervalSet & modified, int begin, int end, Func && func)
+{
+    for (const auto & [first, last] : modified)
+    {
+        if (last <= begin)
+            continue;
+        if (first >= end)
+            break;
+        func(std::max(first, begin), std::min(last, end));
+    }
+}
+
+/* Feeds the XOR of the `prior` contents and `data` in [first, last)
+ * through `raw`, a CRC register update function starting from 0 */
+template <typename T, typename Raw>
+T crcOfDifference(const PriorBytes & prior, const uint8_t * data, int first, int last, Raw && raw)
+{
+    uint8_t block[256];
+    T crc = 0;
+    for (int pos = first; pos < last; pos += static_cast<int>(sizeof(block)))
+    {
+        int n = std::min(last - pos, static_cast<int>(sizeof(block)));
+        prior.read(data, pos, pos + n, block);
+        for (int i = 0; i < n; ++i)
+            block[i] ^= data[pos + i];
+        crc = raw(crc, block, static_cast<std::size_t>(n));
+    }
+    return crc;
+}
+
+// Reads the prior big endian word at `offset`
+template <typename T = uint32_t> inline T priorWordBE(const PriorBytes & prior, const uint8_t * data, int offset)
+{
+    uint8_t word[sizeof(T)];
+    prior.read(data, offset, offset + static_cast<int>(sizeof(T)), word);
+    return wordBE<T>(word);
+}
+} // namespace
+
+void PriorBytes::capture(const uint8_t * data, int offset, int size)
+{
+    const int end = offset + size;
+    int pos = offset;
+    auto it = spans_.upper_bound(pos);
+    if (it != spans_.begin())
+    {
+        auto prev = std::prev(it);
+        pos = std::max(pos, prev->first + static_cast<int>(prev->second.size()));
+    }
+
+    // Keep the gaps between spans that are already kept
+    while (pos < end)
+    {
+        int gapEnd = it != spans_.end() ? std::min(end, it->first) : end;
+        if (gapEnd > pos)
+            spans_.emplace_hint(it, pos, std::vector<uint8_t>(data + pos, data + gapEnd));
+        if (it == spans_.end())
+            break;
+        pos = std::max(pos, it->first + static_cast<int>(it->second.size()));
+        ++it;
+    }
+    ranges_.insert(offset, end);
+}
+
+void PriorBytes::read(const uint8_t * data, int first, int last, uint8_t * out) const
+{
+    std::copy(data + first, data + last, out);
+
+    auto it = spans_.upper_bound(first);
+    if (it != spans_.begin())
+        --it;
+    for (; it != spans_.end() && it->first < last; ++it)
+    {
+        int begin = std::max(first, it->first);
+        int end = std::min(last, it->first + static_cast<int>(it->second.size()));
+        if (begin < end)
+            std::copy(it->second.begin() + (begin - it->first), it->second.begin() + (end - it->first),
+                      out + (begin - first));
+    }
+}
+
 void Checksum::addModifiable(int offset, int size)
 {
     modifiable_.emplace_back(offset, size);
@@ -31,6 +152,46 @@ void Checksum::addModifiable(int offset, int size)
 
 Checksum::~Checksum() = default;
 
+void Checksum::correct(uint8_t * data, int size) const
+{
+    bool ok;
+    uint32_t sum = compute(data, size, &ok);
+    if (!ok)
+        throw std::runtime_error("checksum region exceeds the rom size.");
+
+    int written;
+    patch(data, size, sum, written);
+}
+
+uint32_t Checksum::update(uint32_t /*sum*/, const uint8_t * data, int size,
+                          const PriorBytes & /*prior*/) const
+{
+    return compute(data, size, nullptr);
+}
+
+bool Checksum::verify(const uint8_t * data, int size) const
+{
+    bool ok;
+    uint32_t sum = compute(data, size, &ok);
+    return ok && sum == target_;
+}
+
+int Checksum::modifiableOffset(int width, int size) const
+{
+    // Find a usable modifiable region
+    for (const auto & it : modifiable_)
+    {
+        if (it.second >= width)
+        {
+            if (offset_ + it.first + width > size)
+                break;
+            return offset_ + it.first;
+        }
+    }
+    throw std::runtime_error("failed to find a usable modifiable region "
+                             "for checksum correction.");
+}
+
 uint32_t ChecksumBasic::compute(const uint8_t * data, int size, bool * ok) const
 {
     assert(size >= 0);
@@ -41,61 +202,215 @@ uint32_t ChecksumBasic::compute(const uint8_t * data, int size, bool * ok) const
         return 0;
     }
 
-    data += offset_;
-    size -= offset_;
-
-    uint32_t sum = 0;
+    if (ok != nullptr)
+    {
+        *ok = true;
+    }
     // Add up the big endian int32s
-    for (int i = 0; i < size_ / 4; ++i, data += 4)
+    return checksum::sum32BE(data + offset_, size_ / 4);
+}
+
+uint32_t ChecksumBasic::update(uint32_t sum, const uint8_t * data, int size,
+                               const PriorBytes & prior) const
+{
+    assert(offset_ + size_ <= size);
+    (void)size;
+
+    forEachModifiedWord(prior.ranges(), offset_, offset_ + size_ / 4 * 4, 4, [&](int word) {
+        sum += wordBE(data + word) - priorWordBE(prior, data, word);
+    });
+    return sum;
+}
+
+int ChecksumBasic::patch(uint8_t * data, int size, uint32_t sum,
+                         int & written) const
+{
+    int slot = modifiableOffset(4, size);
+    written = 0;
+    if (sum == target_)
+        return slot;
+
+    // The sum is linear in the words, so shifting one word by the
+    // difference to the target corrects it
+    uint32_t value = wordBE(data + slot) + (target_ - sum);
+    writeBE<uint32_t>(value, data + slot, data + size);
+    written = 4;
+    return slot;
+}
+
+uint32_t ChecksumSum16::compute(const uint8_t * data, int size, bool * ok) const
+{
+    assert(size >= 0);
+    if (size < offset_ + size_)
     {
-        sum += readBE<int32_t>(data, data + size);
+        if (ok != nullptr)
+            *ok = false;
+        return 0;
     }
 
     if (ok != nullptr)
-    {
         *ok = true;
-    }
-    return sum;
+    return checksum::sum16BE(data + offset_, size_ / 2);
+}
+
+uint32_t ChecksumSum16::update(uint32_t sum, const uint8_t * data, int size,
+                               const PriorBytes & prior) const
+{
+    assert(offset_ + size_ <= size);
+    (void)size;
+
+    forEachModifiedWord(prior.ranges(), offset_, offset_ + size_ / 2 * 2, 2, [&](int word) {
+        sum += wordBE<uint16_t>(data + word) - priorWordBE<uint16_t>(prior, data, word);
+    });
+    return sum & 0xFFFF;
+}
+
+int ChecksumSum16::patch(uint8_t * data, int size, uint32_t sum,
+                         int & written) const
+{
+    int slot = modifiableOffset(2, size);
+    written = 0;
+    if (sum == target_)
+        return slot;
+
+    auto value = static_cast<uint16_t>(wordBE<uint16_t>(data + slot) + (target_ - sum));
+    writeBE<uint16_t>(value, data + slot, data + size);
+    written = 2;
+    return slot;
 }
 
-void ChecksumBasic::correct(uint8_t * data, int size) const
+uint32_t ChecksumXor::compute(const uint8_t * data, int size, bool * ok) const
 {
     assert(size >= 0);
     if (size < offset_ + size_)
-        throw std::runtime_error("checksum region exceeds the rom size.");
+    {
+        if (ok != nullptr)
+            *ok = false;
+        return 0;
+    }
 
-    bool foundMod = false;
-    int modifiableOffset{0};
+    if (ok != nullptr)
+        *ok = true;
+    return checksum::xor32BE(data + offset_, size_ / 4);
+}
 
-    // Find a usable modifiable region
-    for (const auto & it : modifiable_)
+uint32_t ChecksumXor::update(uint32_t sum, const uint8_t * data, int size,
+                             const PriorBytes & prior) const
+{
+    assert(offset_ + size_ <= size);
+    (void)size;
+
+    forEachModifiedWord(prior.ranges(), offset_, offset_ + size_ / 4 * 4, 4, [&](int word) {
+        sum ^= wordBE(data + word) ^ priorWordBE(prior, data, word);
+    });
+    return sum;
+}
+
+int ChecksumXor::patch(uint8_t * data, int size, uint32_t sum,
+                       int & written) const
+{
+    int slot = modifiableOffset(4, size);
+    written = 0;
+    if (sum == target_)
+        return slot;
+
+    writeBE<uint32_t>(wordBE(data + slot) ^ sum ^ target_, data + slot, data + size);
+    written = 4;
+    return slot;
+}
+
+uint32_t ChecksumCrc32::compute(const uint8_t * data, int size, bool * ok) const
+{
+    assert(size >= 0);
+    if (size < offset_ + size_)
     {
-        if (it.second >= 4)
-        {
-            modifiableOffset = it.first;
-            foundMod = true;
-            break;
-        }
+        if (ok != nullptr)
+            *ok = false;
+        return 0;
     }
-    if (!foundMod)
-        throw std::runtime_error("failed to find a usable modifiable region "
-                                 "for checksum correction.");
 
-    // Zero the region
-    writeBE<int32_t>(0, &data[offset_ + modifiableOffset], data + size);
+    if (ok != nullptr)
+        *ok = true;
+    return checksum::crc32(data + offset_, size_);
+}
 
-    // compute should never fail after the check above
-    uint32_t oSum = compute(data, size, nullptr);
+uint32_t ChecksumCrc32::update(uint32_t sum, const uint8_t * data, int size,
+                               const PriorBytes & prior) const
+{
+    assert(offset_ + size_ <= size);
+    (void)size;
 
-    uint32_t val = target_ - oSum;
-    writeBE<int32_t>(val, &data[offset_ + modifiableOffset], data + size);
+    const int end = offset_ + size_;
+    forEachModifiedRange(prior.ranges(), offset_, end, [&](int first, int last) {
+        uint32_t diff = crcOfDifference<uint32_t>(prior, data, first, last, checksum::crc32Raw);
+        sum ^= checksum::crc32Zeros(diff, end - last);
+    });
+    return sum;
+}
+
+int ChecksumCrc32::patch(uint8_t * data, int size, uint32_t sum,
+                         int & written) const
+{
+    int slot = modifiableOffset(4, size);
+    if (slot + 4 > offset_ + size_)
+        throw std::runtime_error("the modifiable region of a CRC must lie "
+                                 "inside the checksummed region.");
+    written = 0;
+    if (sum == target_)
+        return slot;
+
+    uint32_t fix = checksum::crc32Solve(sum ^ target_, offset_ + size_ - slot);
+    for (int i = 0; i < 4; ++i)
+        data[slot + i] ^= static_cast<uint8_t>(fix >> (8 * i));
+    written = 4;
+    return slot;
+}
 
-    // Check if the correction was successful
-    if (compute(data, size, nullptr) != target_)
+uint32_t ChecksumCrc16::compute(const uint8_t * data, int size, bool * ok) const
+{
+    assert(size >= 0);
+    if (size < offset_ + size_)
     {
-        throw std::runtime_error(
-            "checksum does not equal target after correction");
+        if (ok != nullptr)
+            *ok = false;
+        return 0;
     }
+
+    if (ok != nullptr)
+        *ok = true;
+    return checksum::crc16(data + offset_, size_);
+}
+
+uint32_t ChecksumCrc16::update(uint32_t sum, const uint8_t * data, int size,
+                               const PriorBytes & prior) const
+{
+    assert(offset_ + size_ <= size);
+    (void)size;
+
+    const int end = offset_ + size_;
+    forEachModifiedRange(prior.ranges(), offset_, end, [&](int first, int last) {
+        uint16_t diff = crcOfDifference<uint16_t>(prior, data, first, last, checksum::crc16Raw);
+        sum ^= checksum::crc16Zeros(diff, end - last);
+    });
+    return sum;
+}
+
+int ChecksumCrc16::patch(uint8_t * data, int size, uint32_t sum,
+                         int & written) const
+{
+    int slot = modifiableOffset(2, size);
+    if (slot + 2 > offset_ + size_)
+        throw std::runtime_error("the modifiable region of a CRC must lie "
+                                 "inside the checksummed region.");
+    written = 0;
+    if (sum == target_)
+        return slot;
+
+    uint16_t fix = checksum::crc16Solve(static_cast<uint16_t>(sum ^ target_), offset_ + size_ - slot);
+    data[slot] ^= static_cast<uint8_t>(fix >> 8);
+    data[slot + 1] ^= static_cast<uint8_t>(fix);
+    written = 2;
+    return slot;
 }
 
 void Checksums::correct(uint8_t * data, size_t size)
@@ -106,4 +421,95 @@ void Checksums::correct(uint8_t * data, size_t size)
     }
 }
 
-} // namespace lt
\ No newline at end of file
+bool Checksums::verify(const uint8_t * data, size_t size) const
+{
+    return std::all_of(checksums_.begin(), checksums_.end(),
+                       [&](const ChecksumPtr & checksum) {
+                           return checksum->verify(data, size);
+                       });
+}
+
+ChecksumTracker::ChecksumTracker(MemoryBuffer & buffer) : buffer_(buffer)
+{
+    buffer_.addObserver(this);
+}
+
+ChecksumTracker::~ChecksumTracker() { buffer_.removeObserver(this); }
+
+void ChecksumTracker::reset(const Checksums & checksums, int offset)
+{
+    if (offset < 0 || offset > buffer_.size())
+        throw std::runtime_error("checksum offset exceeds the rom size.");
+
+    checksums_ = &checksums;
+    offset_ = offset;
+    size_ = buffer_.size() - offset;
+    prior_.clear();
+    sums_.clear();
+    for (const ChecksumPtr & checksum : checksums)
+    {
+        bool ok;
+        sums_.push_back(checksum->compute(data(), size_, &ok));
+        if (!ok)
+            throw std::runtime_error("checksum region exceeds the rom size.");
+    }
+}
+
+void ChecksumTracker::beforeWrite(const MemoryBuffer & /*buffer*/, int offset, int size)
+{
+    // Nothing to keep until the sums are first computed
+    if (checksums_ == nullptr)
+        return;
+
+    int first = std::max(offset - offset_, 0);
+    int last = std::min(offset + size - offset_, size_);
+    if (first < last)
+        prior_.capture(data(), first, last - first);
+}
+
+void ChecksumTracker::update()
+{
+    assert(checksums_ != nullptr);
+    if (buffer_.size() - offset_ != size_)
+        throw std::runtime_error("data size changed since the checksums were computed");
+    if (prior_.empty())
+        return;
+
+    std::size_t i = 0;
+    for (const ChecksumPtr & checksum : *checksums_)
+    {
+        sums_[i] = checksum->update(sums_[i], data(), size_, prior_);
+        ++i;
+    }
+    prior_.clear();
+}
+
+IntervalSet ChecksumTracker::correct()
+{
+    assert(checksums_ != nullptr);
+    update();
+
+    // A modifiable section may lie inside the region of another
+    // checksum, so each patch is folded into every sum
+    IntervalSet patched;
+    std::size_t i = 0;
+    for (const ChecksumPtr & checksum : *checksums_)
+    {
+        // Patches bypass the observers, so keep what they may overwrite
+        for (const auto & [first, length] : checksum->modifiable())
+        {
+            int begin = std::min(checksum->offset() + first, size_);
+            prior_.capture(data(), begin, std::min(length, size_ - begin));
+        }
+
+        int written;
+        int offset = checksum->patch(data(), size_, sums_[i], written);
+        update();
+        if (written > 0)
+            patched.insert(offset, offset + written);
+        ++i;
+    }
+    return patched;
+}
+
+} // namespace lt
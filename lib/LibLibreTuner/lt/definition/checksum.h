@@ -20,13 +20,46 @@
 #define LT_CHECKSUM_H
 
 #include <cstdint>
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "../buffer/memorybuffer.h"
+#include "../support/intervalset.h"
+
 namespace lt
 {
 
+/* Contents of data before some of its ranges were written. Only the
+ * written ranges are kept; all other bytes equal the current data. */
+class PriorBytes
+{
+public:
+    /* Keeps the current `size` bytes at `offset` of `data` as prior
+     * contents. Bytes that are already kept are left alone. */
+    void capture(const uint8_t * data, int offset, int size);
+
+    /* Copies the prior contents of [first, last) to `out`. Bytes that
+     * were not written are read from `data`. */
+    void read(const uint8_t * data, int first, int last, uint8_t * out) const;
+
+    // Ranges with kept bytes
+    inline const IntervalSet & ranges() const noexcept { return ranges_; }
+    inline bool empty() const noexcept { return ranges_.empty(); }
+
+    inline void clear() noexcept
+    {
+        ranges_.clear();
+        spans_.clear();
+    }
+
+private:
+    IntervalSet ranges_;
+    // Kept bytes by the offset of their first byte. Spans never overlap.
+    std::map<int, std::vector<uint8_t>> spans_;
+};
+
 class Checksum
 {
 public:
@@ -38,14 +71,37 @@ public:
     /* Adds a region modifiable for checksum computation */
     void addModifiable(int offset, int size);
 
+    inline int offset() const noexcept { return offset_; }
+    inline int size() const noexcept { return size_; }
+    inline uint32_t target() const noexcept { return target_; }
+
+    // Modifiable sections as (offset from offset(), size) pairs
+    inline const std::vector<std::pair<int, int>> & modifiable() const noexcept { return modifiable_; }
+
     /* Corrects the checksum for the data using modifiable sections. */
-    virtual void correct(uint8_t * data, int size) const = 0;
+    virtual void correct(uint8_t * data, int size) const;
 
     /* Returns the computed checksum. If length is too small,
      * returns 0 and sets ok to false.*/
     virtual uint32_t compute(const uint8_t * data, int size,
                              bool * ok = nullptr) const = 0;
 
+    /* Returns the checksum of `data` given `sum`, the checksum of its
+     * `prior` contents. The default implementation recomputes the whole
+     * checksum. */
+    virtual uint32_t update(uint32_t sum, const uint8_t * data, int size,
+                            const PriorBytes & prior) const;
+
+    /* Writes the modifiable section so that the checksum of `data`, which
+     * is currently `sum`, equals the target. Returns the offset of the
+     * written bytes in `data`; `written` is set to their number, which
+     * is 0 if the checksum already matched. */
+    virtual int patch(uint8_t * data, int size, uint32_t sum,
+                      int & written) const = 0;
+
+    // Returns true if the checksum of `data` equals the target
+    bool verify(const uint8_t * data, int size) const;
+
     virtual ~Checksum();
 
 protected:
@@ -54,6 +110,11 @@ protected:
     uint32_t target_;
 
     std::vector<std::pair<int, int>> modifiable_;
+
+    /* Returns the offset in the data of the first modifiable section of
+     * at least `width` bytes. Throws std::runtime_error if there is none
+     * or it lies outside of `size` bytes of data. */
+    int modifiableOffset(int width, int size) const;
 };
 using ChecksumPtr = std::unique_ptr<Checksum>;
 
@@ -68,7 +129,92 @@ public:
 
     uint32_t compute(const uint8_t * data, int size, bool * ok) const override;
 
-    void correct(uint8_t * data, int size) const override;
+    /* Subtracts the old and adds the new words that overlap modified
+     * ranges. O(modified bytes). */
+    uint32_t update(uint32_t sum, const uint8_t * data, int size,
+                    const PriorBytes & prior) const override;
+
+    // Adjusts the first modifiable word by the difference to the target
+    int patch(uint8_t * data, int size, uint32_t sum,
+              int & written) const override;
+};
+
+/* Sum of big endian 16-bit words, modulo 2^16 ("sum16") */
+class ChecksumSum16 : public Checksum
+{
+public:
+    ChecksumSum16(uint32_t offset, uint32_t size, uint32_t target)
+        : Checksum(offset, size, target)
+    {
+    }
+
+    uint32_t compute(const uint8_t * data, int size, bool * ok) const override;
+
+    uint32_t update(uint32_t sum, const uint8_t * data, int size,
+                    const PriorBytes & prior) const override;
+
+    // Adjusts the first modifiable 16-bit word by the difference
+    int patch(uint8_t * data, int size, uint32_t sum,
+              int & written) const override;
+};
+
+/* XOR of big endian 32-bit words ("xor") */
+class ChecksumXor : public Checksum
+{
+public:
+    ChecksumXor(uint32_t offset, uint32_t size, uint32_t target)
+        : Checksum(offset, size, target)
+    {
+    }
+
+    uint32_t compute(const uint8_t * data, int size, bool * ok) const override;
+
+    uint32_t update(uint32_t sum, const uint8_t * data, int size,
+                    const PriorBytes & prior) const override;
+
+    int patch(uint8_t * data, int size, uint32_t sum,
+              int & written) const override;
+};
+
+/* CRC-32 as used by zlib ("crc32"). The modifiable section must lie in
+ * the checksummed region; four bytes of it are solved for so the CRC
+ * equals the target. */
+class ChecksumCrc32 : public Checksum
+{
+public:
+    ChecksumCrc32(uint32_t offset, uint32_t size, uint32_t target)
+        : Checksum(offset, size, target)
+    {
+    }
+
+    uint32_t compute(const uint8_t * data, int size, bool * ok) const override;
+
+    /* The CRC of the XOR of two inputs is the XOR of their CRCs, so only
+     * the difference of the modified ranges is fed through the CRC */
+    uint32_t update(uint32_t sum, const uint8_t * data, int size,
+                    const PriorBytes & prior) const override;
+
+    int patch(uint8_t * data, int size, uint32_t sum,
+              int & written) const override;
+};
+
+/* CRC-16/CCITT-FALSE ("crc16"). Corrected like ChecksumCrc32 using two
+ * bytes of the modifiable section. */
+class ChecksumCrc16 : public Checksum
+{
+public:
+    ChecksumCrc16(uint32_t offset, uint32_t size, uint32_t target)
+        : Checksum(offset, size, target)
+    {
+    }
+
+    uint32_t compute(const uint8_t * data, int size, bool * ok) const override;
+
+    uint32_t update(uint32_t sum, const uint8_t * data, int size,
+                    const PriorBytes & prior) const override;
+
+    int patch(uint8_t * data, int size, uint32_t sum,
+              int & written) const override;
 };
 
 /**
@@ -77,20 +223,85 @@ public:
 class Checksums
 {
 public:
-    /* Adds a basic type checksum */
+    using const_iterator = std::vector<ChecksumPtr>::const_iterator;
+
+    /* Adds a checksum */
     inline void add(ChecksumPtr && checksum)
     {
         checksums_.emplace_back(std::move(checksum));
     }
 
     /* Corrects the checksums for the data using modifiable sections.
-     * Returns (false, errmsg) on failure and (true, "") on success. */
+     * Throws std::runtime_error on failure. Computes every checksum over
+     * its whole region. */
     void correct(uint8_t * data, size_t size);
 
+    /* Recomputes every checksum over its whole region. Returns false if
+     * any does not equal its target. */
+    bool verify(const uint8_t * data, size_t size) const;
+
+    inline const_iterator begin() const noexcept { return checksums_.begin(); }
+    inline const_iterator end() const noexcept { return checksums_.end(); }
+    inline std::size_t size() const noexcept { return checksums_.size(); }
+    inline bool empty() const noexcept { return checksums_.empty(); }
+
 private:
     std::vector<ChecksumPtr> checksums_;
 };
 
+/* Keeps the checksums of one ROM image up to date incrementally. The
+ * last computed value of each checksum is stored. The tracker observes
+ * writes to the buffer and keeps the bytes they replace, so later
+ * corrections only revisit the written ranges instead of whole checksum
+ * regions. Writes that bypass the observers of the buffer are not
+ * seen. */
+class ChecksumTracker : public WriteObserver
+{
+public:
+    explicit ChecksumTracker(MemoryBuffer & buffer);
+    ~ChecksumTracker() override;
+
+    ChecksumTracker(const ChecksumTracker &) = delete;
+    ChecksumTracker & operator=(const ChecksumTracker &) = delete;
+
+    // Returns true if reset() was called for `checksums`
+    inline bool tracks(const Checksums & checksums) const noexcept
+    {
+        return checksums_ == &checksums;
+    }
+
+    /* Computes every checksum over the buffer from `offset` on. Checksum
+     * offsets are relative to `offset`. */
+    void reset(const Checksums & checksums, int offset);
+
+    // Updates the checksums with the ranges written since the last update
+    void update();
+
+    /* Patches the modifiable sections of the buffer so that every
+     * checksum equals its target. Returns the written ranges relative to
+     * the offset passed to reset(). Throws std::runtime_error if a
+     * checksum has no usable section. */
+    IntervalSet correct();
+
+    // Last computed value of each checksum
+    inline const std::vector<uint32_t> & sums() const noexcept { return sums_; }
+
+    // WriteObserver
+    void beforeWrite(const MemoryBuffer & buffer, int offset, int size) override;
+
+private:
+    MemoryBuffer & buffer_;
+    const Checksums * checksums_{nullptr};
+    // Start and size of the checksummed part of the buffer
+    int offset_{0};
+    int size_{0};
+    std::vector<uint32_t> sums_;
+    // Bytes the sums were computed over, where they were written since
+    PriorBytes prior_;
+
+    inline uint8_t * data() noexcept { return buffer_.data() + offset_; }
+};
+
 } // namespace lt
 
 #endif // LT_CHECKSUM_H
@@ -0,0 +1,170 @@
+#include "definitionindex.h"
+#include "platform.h"
+
+#include <algorithm>
+#include <array>
+#include <tuple>
+
+namespace lt
+{
+
+void DefinitionIndex::build(const Model & model)
+{
+    locations_.clear();
+    for (const auto & [id, table] : model.tables)
+    {
+        if (!table.offset)
+            continue;
+        int begin = static_cast<int>(*table.offset);
+        locations_.push_back(DefinitionLocation{begin, begin + static_cast<int>(table.byteSize()),
+                                                static_cast<int>(dataTypeSize(table.storedDataType)), false, id});
+    }
+    if (PlatformPtr platform = model.platform())
+    {
+        for (const auto & [id, offset] : model.axisOffsets)
+        {
+            const AxisDefinition * axis = platform->getAxis(id);
+            if (axis == nullptr)
+                continue;
+            if (const auto * memory = std::get_if<MemoryAxisDefinition>(&axis->def))
+            {
+                int entrySize = static_cast<int>(dataTypeSize(axis->dataType));
+                int begin = static_cast<int>(offset);
+                locations_.push_back(
+                    DefinitionLocation{begin, begin + memory->size * entrySize, entrySize, true, id});
+            }
+        }
+    }
+
+    // Empty definitions cannot contain an offset
+    locations_.erase(std::remove_if(locations_.begin(), locations_.end(),
+                                    [](const DefinitionLocation & l) { return l.end <= l.begin; }),
+                     locations_.end());
+    // The maps are unordered; break ties so the order is stable
+    std::sort(locations_.begin(), locations_.end(), [](const DefinitionLocation & a, const DefinitionLocation & b) {
+        return std::tie(a.begin, a.end, a.axis, a.id) < std::tie(b.begin, b.end, b.axis, b.id);
+    });
+
+    index();
+    findOverlaps();
+}
+
+void DefinitionIndex::index()
+{
+    const auto n = static_cast<std::ptrdiff_t>(locations_.size());
+    maxEnd_.assign(locations_.size(), 0);
+    rootLevel_ = -1;
+    if (n == 0)
+        return;
+
+    /* Node i sits at the level given by its number of trailing one bits;
+     * even indices are leaves. `last` tracks the subtree maximum of the
+     * rightmost node, which stands in for missing right children. */
+    std::ptrdiff_t lastNode = 0;
+    int last = 0;
+    for (std::ptrdiff_t i = 0; i < n; i += 2)
+    {
+        lastNode = i;
+        last = maxEnd_[i] = locations_[i].end;
+    }
+
+    int level = 1;
+    for (; (std::ptrdiff_t(1) << level) <= n; ++level)
+    {
+        const std::ptrdiff_t half = std::ptrdiff_t(1) << (level - 1);
+        for (std::ptrdiff_t i = 2 * half - 1; i < n; i += 4 * half)
+        {
+            int left = maxEnd_[i - half];
+            int right = i + half < n ? maxEnd_[i + half] : last;
+            maxEnd_[i] = std::max({locations_[i].end, left, right});
+        }
+        // Move to the parent of the rightmost node
+        lastNode = ((lastNode >> level) & 1) ? lastNode - half : lastNode + half;
+        if (lastNode < n && maxEnd_[lastNode] > last)
+            last = maxEnd_[lastNode];
+    }
+    rootLevel_ = level - 1;
+}
+
+void DefinitionIndex::findOverlaps()
+{
+    overlaps_.clear();
+    // Definitions that may still reach the next begin
+    std::vector<std::size_t> active;
+    for (std::size_t i = 0; i < locations_.size(); ++i)
+    {
+        const DefinitionLocation & l = locations_[i];
+        active.erase(std::remove_if(active.begin(), active.end(),
+                                    [&](std::size_t j) { return locations_[j].end <= l.begin; }),
+                     active.end());
+        for (std::size_t j : active)
+            overlaps_.push_back(DefinitionOverlap{j, i, l.begin, std::min(l.end, locations_[j].end)});
+        active.push_back(i);
+    }
+}
+
+void DefinitionIndex::overlapping(int begin, int end, std::vector<std::size_t> & out) const
+{
+    if (rootLevel_ < 0 || begin >= end)
+        return;
+
+    struct Frame
+    {
+        int level;
+        std::ptrdiff_t node;
+        bool leftDone;
+    };
+    // Each level pushes at most two frames
+    std::array<Frame, 64> stack;
+    int top = 0;
+    stack[top++] = Frame{rootLevel_, (std::ptrdiff_t(1) << rootLevel_) - 1, false};
+
+    const auto n = static_cast<std::ptrdiff_t>(locations_.size());
+    while (top > 0)
+    {
+        Frame frame = stack[--top];
+        if (frame.level <= 3)
+        {
+            // Small subtrees are cheaper to scan in order
+            std::ptrdiff_t first = (frame.node >> frame.level) << frame.level;
+            std::ptrdiff_t last = std::min(first + (std::ptrdiff_t(1) << (frame.level + 1)) - 1, n);
+            for (std::ptrdiff_t i = first; i < last && locations_[i].begin < end; ++i)
+            {
+                if (begin < locations_[i].end)
+                    out.push_back(static_cast<std::size_t>(i));
+            }
+        }
+        else if (!frame.leftDone)
+        {
+            const std::ptrdiff_t left = frame.node - (std::ptrdiff_t(1) << (frame.level - 1));
+            stack[top++] = Frame{frame.level, frame.node, true};
+            // A left child past the end still has nodes in range below it
+            if (left >= n || maxEnd_[left] > begin)
+                stack[top++] = Frame{frame.level - 1, left, false};
+        }
+        else if (frame.node < n && locations_[frame.node].begin < end)
+        {
+            if (begin < locations_[frame.node].end)
+                out.push_back(static_cast<std::size_t>(frame.node));
+            stack[top++] = Frame{frame.level - 1, frame.node + (std::ptrdiff_t(1) << (frame.level - 1)), false};
+        }
+    }
+}
+
+std::vector<std::size_t> DefinitionIndex::at(int offset) const
+{
+    std::vector<std::size_t> found;
+    overlapping(offset, offset + 1, found);
+    return found;
+}
+
+const DefinitionLocation * DefinitionIndex::find(int offset) const
+{
+    std::vector<std::size_t> found;
+    overlapping(offset, offset + 1, found);
+    if (found.empty())
+        return nullptr;
+    return &locations_[found.front()];
+}
+
+} // namespace lt
@@ -0,0 +1,83 @@
+#ifndef LT_DEFINITIONINDEX_H
+#define LT_DEFINITIONINDEX_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace lt
+{
+
+struct Model;
+
+// Location of a table or memory axis in the ROM
+struct DefinitionLocation
+{
+    // Half-open range of byte offsets [begin, end)
+    int begin;
+    int end;
+    // Size of one stored entry in bytes
+    int entrySize;
+    // True if the definition is a memory axis
+    bool axis;
+    std::string id;
+};
+
+// Two definitions sharing the bytes [begin, end)
+struct DefinitionOverlap
+{
+    std::size_t first;
+    std::size_t second;
+    int begin;
+    int end;
+};
+
+/* Interval index from ROM offsets to the tables and memory axes of a
+ * model. Locations are kept sorted by begin in an implicit interval tree:
+ * the sorted array is read as a balanced binary tree where each node also
+ * stores the largest end in its subtree, so point and range queries take
+ * O(log n + k) for k results. */
+class DefinitionIndex
+{
+public:
+    DefinitionIndex() = default;
+    explicit DefinitionIndex(const Model & model) { build(model); }
+
+    /* Indexes the tables with an offset and the memory axes of `model`.
+     * Axes are skipped if the model's platform has expired. */
+    void build(const Model & model);
+
+    // Returns indices of the locations containing `offset`, ascending
+    std::vector<std::size_t> at(int offset) const;
+
+    /* Appends to `out` indices of the locations intersecting
+     * [begin, end), ascending. */
+    void overlapping(int begin, int end, std::vector<std::size_t> & out) const;
+
+    // Returns the first location containing `offset` or nullptr
+    const DefinitionLocation * find(int offset) const;
+
+    inline const DefinitionLocation & operator[](std::size_t index) const noexcept { return locations_[index]; }
+    inline const std::vector<DefinitionLocation> & locations() const noexcept { return locations_; }
+    inline std::size_t size() const noexcept { return locations_.size(); }
+    inline bool empty() const noexcept { return locations_.empty(); }
+
+    /* Pairs of definitions that share bytes, found when the index was
+     * built. Well-formed definitions do not overlap. */
+    inline const std::vector<DefinitionOverlap> & overlaps() const noexcept { return overlaps_; }
+
+private:
+    void index();
+    void findOverlaps();
+
+    std::vector<DefinitionLocation> locations_;
+    // Largest end in the subtree rooted at each location
+    std::vector<int> maxEnd_;
+    // Level of the root node, or -1 if empty
+    int rootLevel_{-1};
+    std::vector<DefinitionOverlap> overlaps_;
+};
+
+} // namespace lt
+
+#endif // LT_DEFINITIONINDEX_H
@@ -6,6 +6,7 @@
 #include <vector>
 
 #include "checksum.h"
+#include "definitionindex.h"
 #include "table.h"
 
 namespace lt
@@ -56,6 +57,10 @@ public:
     // TODO: inheritance-based system like tables.
     std::unordered_map<std::string, std::size_t> axisOffsets;
 
+    /* Offsets of the tables and memory axes above. Built when the model
+     * is loaded; rebuild it after changing either. */
+    DefinitionIndex index;
+
     // Identifiers are unique to each model in a platform.
     std::vector<Identifier> identifiers;
 
@@ -1,7 +1,9 @@
 #include "platform.h"
+#include "../libretuner.h"
 #include "../support/util.hpp"
 
 #include <fstream>
+#include <sstream>
 #include <nlohmann/json.hpp>
 
 namespace fs = std::filesystem;
@@ -22,6 +24,14 @@ struct adl_serializer<lt::ChecksumPtr>
         lt::ChecksumPtr sum;
         if (mode == "basic")
             sum = lt::ChecksumPtr(new lt::ChecksumBasic(offset, size, target));
+        else if (mode == "sum16")
+            sum = lt::ChecksumPtr(new lt::ChecksumSum16(offset, size, target));
+        else if (mode == "xor")
+            sum = lt::ChecksumPtr(new lt::ChecksumXor(offset, size, target));
+        else if (mode == "crc32")
+            sum = lt::ChecksumPtr(new lt::ChecksumCrc32(offset, size, target));
+        else if (mode == "crc16")
+            sum = lt::ChecksumPtr(new lt::ChecksumCrc16(offset, size, target));
         else
             throw std::runtime_error("invalid mode for checksum");
 
@@ -48,7 +58,8 @@ void to_json(json & j, const lt::Pid & pid)
              {"description", pid.description},
              {"code", pid.code},
              {"formula", pid.formula},
-             {"unit", pid.unit}};
+             {"unit", pid.unit},
+             {"rate", pid.rate}};
 }
 
 void from_json(const json & j, lt::Pid & pid)
@@ -58,6 +69,8 @@ void from_json(const json & j, lt::Pid & pid)
     j.at("code").get_to(pid.code);
     j.at("formula").get_to(pid.formula);
     j.at("unit").get_to(pid.unit);
+    if (auto it = j.find("rate"); it != j.end())
+        it->get_to(pid.rate);
 }
 
 NLOHMANN_JSON_SERIALIZE_ENUM(DataType, {
@@ -340,6 +353,16 @@ void decodeModel(const json & j,
             model.checksums.add(node.get<ChecksumPtr>());
         }
     }
+
+    model.index.build(model);
+    for (const DefinitionOverlap & overlap : model.index.overlaps())
+    {
+        std::ostringstream ss;
+        ss << "model " << model.id << ": '" << model.index[overlap.first].id << "' and '"
+           << model.index[overlap.second].id << "' overlap at 0x" << std::hex << overlap.begin << "-0x"
+           << overlap.end;
+        lt::log(ss.str());
+    }
 }
 
 PlatformPtr Platform::loadDirectory(const std::filesystem::path & base_path)
@@ -2,6 +2,7 @@
 #define LT_TABLEDEF_H
 
 #include "../support/types.h"
+#include <limits>
 #include <optional>
 #include <string>
 #include <utility>
@@ -21,6 +21,7 @@
 #include "../rom/rom.h"
 
 #include <cassert>
+#include <iterator>
 #include <utility>
 
 namespace lt
@@ -36,7 +37,7 @@ FlashMap::FlashMap(std::vector<uint8_t> && data, std::size_t offset)
 {
 }
 
-FlashMap FlashMap::fromTune(Tune & tune)
+FlashMap FlashMap::fromTune(const Tune & tune)
 {
     const lt::RomPtr & rom = tune.base();
 
@@ -48,8 +49,8 @@ FlashMap FlashMap::fromTune(Tune & tune)
 
     std::size_t offset = platform->flashOffset;
 
-    std::vector<uint8_t> data(rom->data() + offset,
-                              rom->data() + rom->size() - offset);
+    // Tables write straight into the tune data
+    std::vector<uint8_t> data(std::next(tune.cbegin(), offset), tune.cend());
 
     // Try each table
     /*for (const auto & [id, definition] : model->tables)
@@ -67,8 +68,6 @@ FlashMap FlashMap::fromTune(Tune & tune)
                   data.begin() + definition.offset.value() - offset);
     }*/
 
-    // Correct and verify checksums
-    model->checksums.correct(data.data(), data.size());
     return FlashMap(std::move(data), offset);
 }
 
@@ -37,7 +37,9 @@ public:
     FlashMap(const std::vector<uint8_t> & data, std::size_t offset);
     FlashMap(std::vector<uint8_t> && data, std::size_t offset);
 
-    static FlashMap fromTune(Tune & tune);
+    /* Copies the flashed region of `tune`. Checksums are not touched;
+     * correct them on the thread that owns the tune beforehand. */
+    static FlashMap fromTune(const Tune & tune);
 
     // The address offset the data should be flashed to
     size_t offset() const { return offset_; }
@@ -33,7 +33,7 @@ UdsPacket Uds::request(uint8_t sid, const uint8_t * data, size_t size)
             ss << "negative UDS response: 0x" << std::hex
                << static_cast<int>(code) << " (" << std::dec
                << static_cast<int>(code) << ")";
-            throw std::runtime_error(ss.str());
+            throw UdsNegativeResponse(sid, code, ss.str());
         }
 
         if (response.code != sid + 0x40)
@@ -119,8 +119,65 @@ std::vector<uint8_t> Uds::readDataByIdentifier(uint16_t id)
     req[1] = id & 0xFF;
 
     UdsPacket res = request(UDS_REQ_READBYID, req.data(), req.size());
+    if (res.data.size() < 2 || res.data[0] != req[0] || res.data[1] != req[1])
+    {
+        throw std::runtime_error("dataIdentifier mismatch");
+    }
+
+    res.data.erase(res.data.begin(), res.data.begin() + 2);
     return res.data;
 }
 
+std::vector<uint8_t> Uds::readDataByIdentifiers(const uint16_t * ids,
+                                                std::size_t count)
+{
+    std::vector<uint8_t> req(count * 2);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        req[i * 2] = ids[i] >> 8;
+        req[i * 2 + 1] = ids[i] & 0xFF;
+    }
+
+    UdsPacket res = request(UDS_REQ_READBYID, req.data(), req.size());
+    return res.data;
+}
+
+void Uds::defineDataIdentifier(uint16_t id, const DidSource * sources,
+                               std::size_t count)
+{
+    std::vector<uint8_t> req;
+    req.reserve(3 + count * 4);
+    req.push_back(UDS_DDDI_DEFINEBYID);
+    req.push_back(id >> 8);
+    req.push_back(id & 0xFF);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        req.push_back(sources[i].id >> 8);
+        req.push_back(sources[i].id & 0xFF);
+        req.push_back(sources[i].position);
+        req.push_back(sources[i].size);
+    }
+
+    UdsPacket res = request(UDS_REQ_DYNAMICDEFINE, req.data(), req.size());
+    if (res.data.empty() || res.data[0] != UDS_DDDI_DEFINEBYID)
+    {
+        throw std::runtime_error("definitionType mismatch");
+    }
+}
+
+void Uds::clearDataIdentifier(uint16_t id)
+{
+    std::array<uint8_t, 3> req;
+    req[0] = UDS_DDDI_CLEAR;
+    req[1] = id >> 8;
+    req[2] = id & 0xFF;
+
+    UdsPacket res = request(UDS_REQ_DYNAMICDEFINE, req.data(), req.size());
+    if (res.data.empty() || res.data[0] != UDS_DDDI_CLEAR)
+    {
+        throw std::runtime_error("definitionType mismatch");
+    }
+}
+
 } // namespace network
 } // namespace lt
@@ -3,6 +3,8 @@
 
 #include <cstdint>
 #include <memory>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 namespace lt
@@ -18,10 +20,21 @@ constexpr uint8_t UDS_REQ_REQUESTDOWNLOAD = 0x34;
 constexpr uint8_t UDS_REQ_REQUESTUPLOAD = 0x35;
 constexpr uint8_t UDS_REQ_TRANSFERDATA = 0x36;
 constexpr uint8_t UDS_REQ_READBYID = 0x22;
+constexpr uint8_t UDS_REQ_DYNAMICDEFINE = 0x2C;
+
+/* DynamicallyDefineDataIdentifier sub-functions */
+constexpr uint8_t UDS_DDDI_DEFINEBYID = 0x01;
+constexpr uint8_t UDS_DDDI_CLEAR = 0x03;
 
 constexpr uint8_t UDS_RES_NEGATIVE = 0x7F;
 
 /* Negative response codes */
+// serviceNotSupported
+constexpr uint8_t UDS_NRES_SNS = 0x11;
+// subFunctionNotSupported
+constexpr uint8_t UDS_NRES_SFNS = 0x12;
+// requestOutOfRange
+constexpr uint8_t UDS_NRES_ROOR = 0x31;
 // requestCorrectlyReceivedResponsePending
 constexpr uint8_t UDS_NRES_RCRRP = 0x78;
 
@@ -53,17 +66,45 @@ struct UdsPacket
     bool negative() const noexcept { return code == UDS_RES_NEGATIVE; }
     uint8_t negativeCode() const noexcept
     {
-        return data.size() > 1 ? 0 : data[1];
+        return data.size() > 1 ? data[1] : 0;
     }
 };
 
+/* Thrown when the server sends a negative response */
+class UdsNegativeResponse : public std::runtime_error
+{
+public:
+    UdsNegativeResponse(uint8_t sid, uint8_t code, const std::string & what)
+        : std::runtime_error(what), sid_(sid), code_(code)
+    {
+    }
+
+    // Returns the request SID that was rejected
+    inline uint8_t sid() const noexcept { return sid_; }
+    // Returns the negative response code
+    inline uint8_t code() const noexcept { return code_; }
+
+private:
+    uint8_t sid_;
+    uint8_t code_;
+};
+
+/* Source data record of a dynamically defined identifier. `position` is
+ * the one-based byte position in the source record. */
+struct DidSource
+{
+    uint16_t id;
+    uint8_t position;
+    uint8_t size;
+};
+
 class Uds
 {
 public:
     virtual ~Uds() = default;
 
-    /* Sends a request. May throw an exception. Throws an
-       exception if a negative response is received. (Not
+    /* Sends a request. May throw an exception. Throws
+       UdsNegativeResponse if a negative response is received. (Not
        including RCRRP). */
     UdsPacket request(uint8_t sid, const uint8_t * data, size_t size);
 
@@ -79,8 +120,25 @@ public:
     std::vector<uint8_t> requestReadMemoryAddress(uint32_t address,
                                                   uint16_t length);
 
+    /* ReadDataByIdentifier. Returns the data record without the
+     * echoed identifier. */
     std::vector<uint8_t> readDataByIdentifier(uint16_t id);
 
+    /* ReadDataByIdentifier with multiple identifiers in one request.
+     * Returns the raw response records ([id, data]...) as sent by the
+     * server. Splitting the records requires knowing the size of each. */
+    std::vector<uint8_t> readDataByIdentifiers(const uint16_t * ids,
+                                               std::size_t count);
+
+    /* DynamicallyDefineDataIdentifier (defineByIdentifier). Defines
+     * `id` as the concatenation of the source records. */
+    void defineDataIdentifier(uint16_t id, const DidSource * sources,
+                              std::size_t count);
+
+    /* DynamicallyDefineDataIdentifier (clearDynamicallyDefined
+     * DataIdentifier). */
+    void clearDataIdentifier(uint16_t id);
+
     // Sends a request but does not throw an exception on negative errors.
     // Must not handle RCRRP or other negative responses.
     virtual UdsPacket requestRaw(const UdsPacket & packet) = 0;
@@ -0,0 +1,170 @@
+#include "filewatcher.h"
+
+#include <stdexcept>
+
+#ifdef __linux__
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace lt::os
+{
+
+namespace
+{
+
+/* Returns the net effect of `prev` followed by `next` on one file. A file
+ * added by renaming it over another may have existed before, so a later
+ * removal is still reported. */
+FileWatcher::Event merge(FileWatcher::Event prev, FileWatcher::Event next) noexcept
+{
+    using Event = FileWatcher::Event;
+    if (next == Event::Removed)
+        return Event::Removed;
+    return prev == Event::Added ? Event::Added : Event::Modified;
+}
+
+// Merges changes to the same file, keeping the order of first changes
+std::vector<FileWatcher::Change> coalesce(std::vector<FileWatcher::Change> changes)
+{
+    std::vector<FileWatcher::Change> merged;
+    std::unordered_map<std::string, std::size_t> positions;
+    for (FileWatcher::Change & change : changes)
+    {
+        if (change.event == FileWatcher::Event::Rescan)
+        {
+            merged.emplace_back(std::move(change));
+            continue;
+        }
+
+        std::string key = (change.directory / change.filename).string();
+        if (auto it = positions.find(key); it != positions.end())
+        {
+            FileWatcher::Change & prev = merged[it->second];
+            prev.event = merge(prev.event, change.event);
+            continue;
+        }
+        positions.emplace(std::move(key), merged.size());
+        merged.emplace_back(std::move(change));
+    }
+    return merged;
+}
+
+} // namespace
+
+std::vector<FileWatcher::Change> FileWatcher::poll(std::chrono::milliseconds timeout)
+{
+    std::vector<Change> changes;
+    read(changes);
+#ifdef __linux__
+    if (changes.empty() && timeout.count() != 0)
+    {
+        pollfd pfd{fd_, POLLIN, 0};
+        // Negative timeouts wait indefinitely
+        if (::poll(&pfd, 1, static_cast<int>(timeout.count())) > 0)
+            read(changes);
+    }
+#else
+    (void)timeout;
+#endif
+    return coalesce(std::move(changes));
+}
+
+#ifdef __linux__
+
+FileWatcher::FileWatcher()
+{
+    fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd_ == -1)
+    {
+        throw std::runtime_error(std::string("failed to create inotify instance: ") + strerror(errno));
+    }
+}
+
+FileWatcher::~FileWatcher() { ::close(fd_); }
+
+bool FileWatcher::watch(const std::filesystem::path & dir)
+{
+    // Files are reported once written, not on every write
+    constexpr uint32_t mask =
+        IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_ONLYDIR;
+    int wd = inotify_add_watch(fd_, dir.c_str(), mask);
+    if (wd == -1)
+    {
+        throw std::runtime_error("failed to watch " + dir.string() + ": " + strerror(errno));
+    }
+    watches_[wd] = dir;
+    return true;
+}
+
+int FileWatcher::handle() const noexcept { return fd_; }
+
+bool FileWatcher::supported() noexcept { return true; }
+
+void FileWatcher::read(std::vector<Change> & changes)
+{
+    alignas(inotify_event) char buffer[16 * (sizeof(inotify_event) + NAME_MAX + 1)];
+    for (;;)
+    {
+        ssize_t length = ::read(fd_, buffer, sizeof(buffer));
+        if (length == -1 && errno == EINTR)
+            continue;
+        if (length <= 0)
+            return; // EAGAIN once drained
+
+        for (char * pos = buffer; pos < buffer + length;)
+        {
+            const auto * event = reinterpret_cast<const inotify_event *>(pos);
+            pos += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                for (const auto & [wd, dir] : watches_)
+                    changes.push_back(Change{Event::Rescan, dir, {}});
+                continue;
+            }
+
+            auto it = watches_.find(event->wd);
+            if (it == watches_.end())
+                continue;
+            if (event->mask & IN_IGNORED)
+            {
+                // The directory was removed or unmounted
+                changes.push_back(Change{Event::Rescan, it->second, {}});
+                watches_.erase(it);
+                continue;
+            }
+            if ((event->mask & IN_ISDIR) || event->len == 0)
+                continue;
+
+            Event kind = Event::Modified;
+            if (event->mask & (IN_CREATE | IN_MOVED_TO))
+                kind = Event::Added;
+            else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+                kind = Event::Removed;
+            changes.push_back(Change{kind, it->second, std::string(event->name)});
+        }
+    }
+}
+
+#else
+
+FileWatcher::FileWatcher() = default;
+
+FileWatcher::~FileWatcher() = default;
+
+bool FileWatcher::watch(const std::filesystem::path & /*dir*/) { return false; }
+
+int FileWatcher::handle() const noexcept { return -1; }
+
+bool FileWatcher::supported() noexcept { return false; }
+
+void FileWatcher::read(std::vector<Change> & /*changes*/) {}
+
+#endif
+
+} // namespace lt::os
@@ -0,0 +1,73 @@
+#ifndef LT_FILEWATCHER_H
+#define LT_FILEWATCHER_H
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lt::os
+{
+
+/* Watches directories for changes to the files directly inside them.
+ * Implemented with inotify on Linux. On other platforms nothing can be
+ * watched and supported() returns false. */
+class FileWatcher
+{
+public:
+    enum class Event
+    {
+        Added,
+        Removed,
+        Modified,
+        /* Changes were lost because too many arrived at once. The
+         * directory, if not empty, must be listed again. */
+        Rescan,
+    };
+
+    struct Change
+    {
+        Event event;
+        std::filesystem::path directory;
+        // Empty for Rescan
+        std::string filename;
+    };
+
+    // Throws an exception if the platform watcher cannot be created
+    FileWatcher();
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher &) = delete;
+    FileWatcher & operator=(const FileWatcher &) = delete;
+
+    /* Starts watching `dir`. Returns false if watching is not supported.
+     * Throws an exception if the directory cannot be watched. */
+    bool watch(const std::filesystem::path & dir);
+
+    /* Returns the changes since the last call, waiting up to `timeout`
+     * for the first one; a negative timeout waits indefinitely. Changes
+     * to the same file are merged into one. A file replaced by renaming
+     * another over it is reported as added. */
+    std::vector<Change> poll(std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+
+    /* Returns a descriptor that becomes readable when changes are
+     * pending, for use in event loops, or -1 if not supported. */
+    int handle() const noexcept;
+
+    static bool supported() noexcept;
+
+private:
+    // Reads pending events into `changes`
+    void read(std::vector<Change> & changes);
+
+#ifdef __linux__
+    int fd_{-1};
+    // Watched directories by watch descriptor
+    std::unordered_map<int, std::filesystem::path> watches_;
+#endif
+};
+
+} // namespace lt::os
+
+#endif // LT_FILEWATCHER_H
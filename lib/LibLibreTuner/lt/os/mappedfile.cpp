@@ -0,0 +1,231 @@
+#include "mappedfile.h"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace lt::os
+{
+
+MappedFile::MappedFile(MappedFile && other) noexcept { *this = std::move(other); }
+
+MappedFile & MappedFile::operator=(MappedFile && other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        std::swap(valid_, other.valid_);
+        std::swap(access_, other.access_);
+#ifdef _WIN32
+        std::swap(file_, other.file_);
+        std::swap(mapping_, other.mapping_);
+#else
+        std::swap(fd_, other.fd_);
+#endif
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+
+void MappedFile::open(const std::string & path, Access access)
+{
+    close();
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        throw std::runtime_error("failed to open " + path);
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+        CloseHandle(file);
+        throw std::runtime_error("failed to get size of " + path);
+    }
+
+    file_ = file;
+    size_ = static_cast<std::size_t>(size.QuadPart);
+    valid_ = true;
+    access_ = access;
+    if (size_ == 0)
+    {
+        // Empty files cannot be mapped
+        return;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr)
+    {
+        close();
+        throw std::runtime_error("failed to map " + path);
+    }
+    mapping_ = mapping;
+    map(path);
+}
+
+MappedFile MappedFile::remap(Access access) const
+{
+    if (!valid_)
+    {
+        throw std::runtime_error("attempt to remap an invalid mapping");
+    }
+
+    MappedFile other;
+    HANDLE process = GetCurrentProcess();
+    if (!DuplicateHandle(process, file_, process, &other.file_, 0, FALSE, DUPLICATE_SAME_ACCESS))
+    {
+        throw std::runtime_error("failed to duplicate file handle");
+    }
+    other.size_ = size_;
+    other.valid_ = true;
+    other.access_ = access;
+    if (mapping_ == nullptr)
+    {
+        return other;
+    }
+
+    if (!DuplicateHandle(process, mapping_, process, &other.mapping_, 0, FALSE, DUPLICATE_SAME_ACCESS))
+    {
+        throw std::runtime_error("failed to duplicate mapping handle");
+    }
+    other.map("file");
+    return other;
+}
+
+void MappedFile::map(const std::string & name)
+{
+    // Copy-on-write views are allowed on read-only mapping objects
+    DWORD access = access_ == Access::CopyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ;
+    data_ = static_cast<uint8_t *>(MapViewOfFile(mapping_, access, 0, 0, 0));
+    if (data_ == nullptr)
+    {
+        close();
+        throw std::runtime_error("failed to map " + name);
+    }
+}
+
+void MappedFile::close() noexcept
+{
+    if (data_ != nullptr)
+    {
+        UnmapViewOfFile(data_);
+    }
+    if (mapping_ != nullptr)
+    {
+        CloseHandle(mapping_);
+    }
+    if (file_ != nullptr)
+    {
+        CloseHandle(file_);
+    }
+    data_ = nullptr;
+    mapping_ = nullptr;
+    file_ = nullptr;
+    size_ = 0;
+    valid_ = false;
+    access_ = Access::ReadOnly;
+}
+
+#else
+
+void MappedFile::open(const std::string & path, Access access)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        throw std::runtime_error("failed to open " + path + ": " + strerror(errno));
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1)
+    {
+        int error = errno;
+        ::close(fd);
+        throw std::runtime_error("failed to stat " + path + ": " + strerror(error));
+    }
+
+    fd_ = fd;
+    size_ = static_cast<std::size_t>(st.st_size);
+    valid_ = true;
+    access_ = access;
+    map(path);
+}
+
+MappedFile MappedFile::remap(Access access) const
+{
+    if (!valid_)
+    {
+        throw std::runtime_error("attempt to remap an invalid mapping");
+    }
+
+    MappedFile other;
+    other.fd_ = dup(fd_);
+    if (other.fd_ == -1)
+    {
+        throw std::runtime_error(std::string("failed to duplicate file descriptor: ") + strerror(errno));
+    }
+    other.size_ = size_;
+    other.valid_ = true;
+    other.access_ = access;
+    other.map("file");
+    return other;
+}
+
+void MappedFile::map(const std::string & name)
+{
+    if (size_ == 0)
+    {
+        // Empty files cannot be mapped
+        return;
+    }
+
+    // Private mappings of a read-only descriptor may still be written
+    void * data = access_ == Access::CopyOnWrite
+                      ? mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd_, 0)
+                      : mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (data == MAP_FAILED)
+    {
+        int error = errno;
+        close();
+        throw std::runtime_error("failed to map " + name + ": " + strerror(error));
+    }
+    data_ = static_cast<uint8_t *>(data);
+}
+
+void MappedFile::close() noexcept
+{
+    if (data_ != nullptr)
+    {
+        munmap(data_, size_);
+    }
+    if (fd_ != -1)
+    {
+        ::close(fd_);
+    }
+    data_ = nullptr;
+    fd_ = -1;
+    size_ = 0;
+    valid_ = false;
+    access_ = Access::ReadOnly;
+}
+
+#endif
+
+} // namespace lt::os
@@ -0,0 +1,73 @@
+#ifndef LT_MAPPEDFILE_H
+#define LT_MAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace lt::os
+{
+
+// Memory mapping of a whole file
+class MappedFile
+{
+public:
+    enum class Access
+    {
+        ReadOnly,
+        /* Pages are shared with the file until written, then copied.
+         * Writes are private to the mapping and never reach the file. */
+        CopyOnWrite,
+    };
+
+    MappedFile() = default;
+    // Same as open(path, access)
+    explicit MappedFile(const std::string & path, Access access = Access::ReadOnly) { open(path, access); }
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile & operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile && other) noexcept;
+    MappedFile & operator=(MappedFile && other) noexcept;
+
+    // Maps the file at `path`. Throws an exception on failure.
+    void open(const std::string & path, Access access = Access::ReadOnly);
+
+    /* Maps the file of this mapping again. Refers to the same file even
+     * if its path has since been replaced. Throws an exception on
+     * failure or if this mapping is not valid. */
+    MappedFile remap(Access access) const;
+
+    // Unmaps the file
+    void close() noexcept;
+
+    inline bool valid() const noexcept { return valid_; }
+
+    // Returns the mapped bytes. May be nullptr if the file is empty.
+    inline const uint8_t * data() const noexcept { return data_; }
+    inline std::size_t size() const noexcept { return size_; }
+
+    inline Access access() const noexcept { return access_; }
+
+    // Returns the mapped bytes for writing, or nullptr if read-only
+    inline uint8_t * writableData() noexcept { return access_ == Access::CopyOnWrite ? data_ : nullptr; }
+
+private:
+    // Maps the opened file with `access_`
+    void map(const std::string & name);
+
+    uint8_t * data_{nullptr};
+    std::size_t size_{0};
+    bool valid_{false};
+    Access access_{Access::ReadOnly};
+#ifdef _WIN32
+    void * file_{nullptr};
+    void * mapping_{nullptr};
+#else
+    int fd_{-1};
+#endif
+};
+
+} // namespace lt::os
+
+#endif // LT_MAPPEDFILE_H
@@ -0,0 +1,263 @@
+#ifndef LT_METADATAINDEX_H
+#define LT_METADATAINDEX_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../rom/blobstore.h"
+
+namespace lt
+{
+
+/* Blob referenced by a ROM or tune file. Files whose header could not be
+ * read may reference any blob. */
+struct BlobRef
+{
+    enum class Kind : uint8_t
+    {
+        Unknown,
+        None,
+        Blob,
+    };
+
+    Kind kind{Kind::Unknown};
+    BlobId id;
+
+    template <class Archive> void serialize(Archive & archive) { archive(kind, id); }
+};
+
+/* Cache of the metadata of the files in one directory, keyed by filename
+ * and validated by modification time and size. Every query lists and
+ * stats the files, which is cheap next to decoding them; files are only
+ * read when they are new or changed. The modification time of the
+ * directory is not trusted, as it misses files rewritten in place and
+ * renames within one tick of coarse timestamps. */
+template <typename MetaData> class MetaDataIndex
+{
+public:
+    struct Entry
+    {
+        int64_t modified{0};
+        uint64_t size{0};
+        MetaData metadata;
+        BlobRef blob;
+
+        template <class Archive> void serialize(Archive & archive, uint32_t const /*version*/)
+        {
+            archive(modified, size, metadata, blob);
+        }
+    };
+
+    /* Returns the metadata of the files in `dir`, in directory order.
+     * If `requiresExtension` is true, only files ending in `extension`
+     * are listed. Files missing from the cache are read with
+     * `read(path, blob)`, which also sets the blob the file references,
+     * on up to `threads` threads (0 for one per core). */
+    template <typename Read>
+    std::vector<MetaData> query(const std::filesystem::path & dir, bool requiresExtension,
+                                const std::string & extension, Read && read, unsigned threads = 0);
+
+    /* Applies a change to `filename` in `dir` reported by a file watcher,
+     * reading its metadata with `read` if the file exists and changed. */
+    template <typename Read>
+    void update(const std::filesystem::path & dir, const std::string & filename, Read && read);
+
+    inline bool contains(const std::string & filename) const { return entries_.count(filename) != 0; }
+
+    /* Adds the blobs referenced by the indexed files to `blobs`. Returns
+     * false if a file may reference a blob that is not known. */
+    bool collectBlobs(std::vector<BlobId> & blobs) const;
+
+    // Returns the cached metadata of `filename` in `dir`, if it is indexed
+    std::optional<MetaData> find(const std::filesystem::path & dir, const std::string & filename) const;
+
+    // Returns true if the cache changed since it was loaded or saved
+    inline bool changed() const noexcept { return changed_; }
+    inline void setChanged(bool changed) noexcept { changed_ = changed; }
+
+    inline std::size_t size() const noexcept { return entries_.size(); }
+
+    template <class Archive> void serialize(Archive & archive, uint32_t const /*version*/)
+    {
+        archive(order_, entries_);
+    }
+
+private:
+    static int64_t timestamp(std::filesystem::file_time_type time) noexcept
+    {
+        return static_cast<int64_t>(time.time_since_epoch().count());
+    }
+
+    std::vector<MetaData> collect(const std::filesystem::path & dir) const;
+
+    // Filenames in directory order
+    std::vector<std::string> order_;
+    std::unordered_map<std::string, Entry> entries_;
+    bool changed_{false};
+};
+
+template <typename MetaData>
+template <typename Read>
+std::vector<MetaData> MetaDataIndex<MetaData>::query(const std::filesystem::path & dir, bool requiresExtension,
+                                                     const std::string & extension, Read && read, unsigned threads)
+{
+    namespace fs = std::filesystem;
+
+    std::vector<std::string> order;
+    std::unordered_map<std::string, Entry> entries;
+    // Filenames that must be read
+    std::vector<std::string> stale;
+    for (const auto & file : fs::directory_iterator(dir))
+    {
+        if (!file.is_regular_file() || (requiresExtension && file.path().extension() != extension))
+            continue;
+
+        std::string filename = file.path().filename().string();
+        Entry entry;
+        entry.modified = timestamp(file.last_write_time());
+        entry.size = static_cast<uint64_t>(file.file_size());
+        if (auto it = entries_.find(filename);
+            it != entries_.end() && it->second.modified == entry.modified && it->second.size == entry.size)
+        {
+            entry.metadata = std::move(it->second.metadata);
+            entry.blob = it->second.blob;
+        }
+        else
+            stale.push_back(filename);
+
+        order.push_back(filename);
+        entries.emplace(filename, std::move(entry));
+    }
+
+    if (!stale.empty())
+    {
+        unsigned count = threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+        count = static_cast<unsigned>(std::min<std::size_t>(count, stale.size()));
+
+        // Entries are only modified, never inserted, so threads may
+        // write distinct entries concurrently
+        std::atomic<std::size_t> next{0};
+        std::vector<std::exception_ptr> errors(count);
+        auto work = [&](unsigned worker) {
+            try
+            {
+                for (std::size_t i = next++; i < stale.size(); i = next++)
+                {
+                    Entry & entry = entries.at(stale[i]);
+                    entry.metadata = read(dir / stale[i], entry.blob);
+                }
+            }
+            catch (...)
+            {
+                errors[worker] = std::current_exception();
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (unsigned worker = 1; worker < count; ++worker)
+            workers.emplace_back(work, worker);
+        work(0);
+        for (std::thread & worker : workers)
+            worker.join();
+
+        for (const std::exception_ptr & error : errors)
+        {
+            if (error)
+                std::rethrow_exception(error);
+        }
+    }
+
+    changed_ = changed_ || !stale.empty() || order != order_;
+    order_ = std::move(order);
+    entries_ = std::move(entries);
+    return collect(dir);
+}
+
+template <typename MetaData>
+template <typename Read>
+void MetaDataIndex<MetaData>::update(const std::filesystem::path & dir, const std::string & filename, Read && read)
+{
+    namespace fs = std::filesystem;
+
+    std::error_code ec;
+    const fs::path path = dir / filename;
+    const bool exists = fs::is_regular_file(path, ec);
+    auto it = entries_.find(filename);
+    if (!exists)
+    {
+        if (it != entries_.end())
+        {
+            entries_.erase(it);
+            order_.erase(std::find(order_.begin(), order_.end(), filename));
+            changed_ = true;
+        }
+    }
+    else
+    {
+        Entry entry;
+        entry.modified = timestamp(fs::last_write_time(path, ec));
+        entry.size = static_cast<uint64_t>(fs::file_size(path, ec));
+        if (ec)
+            return; // Removed meanwhile, which is reported next
+        if (it == entries_.end() || it->second.modified != entry.modified || it->second.size != entry.size)
+        {
+            entry.metadata = read(path, entry.blob);
+            if (it == entries_.end())
+                order_.push_back(filename);
+            entries_[filename] = std::move(entry);
+            changed_ = true;
+        }
+    }
+}
+
+template <typename MetaData> bool MetaDataIndex<MetaData>::collectBlobs(std::vector<BlobId> & blobs) const
+{
+    for (const auto & [filename, entry] : entries_)
+    {
+        if (entry.blob.kind == BlobRef::Kind::Unknown)
+            return false;
+        if (entry.blob.kind == BlobRef::Kind::Blob)
+            blobs.push_back(entry.blob.id);
+    }
+    return true;
+}
+
+template <typename MetaData>
+std::optional<MetaData> MetaDataIndex<MetaData>::find(const std::filesystem::path & dir,
+                                                      const std::string & filename) const
+{
+    auto it = entries_.find(filename);
+    if (it == entries_.end())
+        return std::nullopt;
+    MetaData md = it->second.metadata;
+    md.path = dir / filename;
+    return md;
+}
+
+template <typename MetaData>
+std::vector<MetaData> MetaDataIndex<MetaData>::collect(const std::filesystem::path & dir) const
+{
+    std::vector<MetaData> metadata;
+    metadata.reserve(order_.size());
+    for (const std::string & filename : order_)
+    {
+        MetaData md = entries_.at(filename).metadata;
+        // Paths are not cached so the project may move
+        md.path = dir / filename;
+        metadata.emplace_back(std::move(md));
+    }
+    return metadata;
+}
+
+} // namespace lt
+
+#endif // LT_METADATAINDEX_H
@@ -1,13 +1,18 @@
 #include <utility>
 
 #include "project.h"
+#include "../os/mappedfile.h"
+#include "../rom/deltafile.h"
+#include "../rom/imagefile.h"
 
 #include <cassert>
 #include <fstream>
+#include <sstream>
 
 #include <cereal/archives/binary.hpp>
 #include <cereal/types/string.hpp>
 #include <cereal/types/vector.hpp>
+#include <cereal/types/unordered_map.hpp>
 #include <nlohmann/json.hpp>
 
 namespace fs = std::filesystem;
@@ -16,25 +21,79 @@ using json = nlohmann::json;
 namespace lt
 {
 
+namespace
+{
+
+template <typename MetaData> void decodeMetaData(const uint8_t * data, uint64_t size, MetaData & meta)
+{
+    std::istringstream stream(std::string(reinterpret_cast<const char *>(data), static_cast<std::size_t>(size)));
+    cereal::BinaryInputArchive archive(stream);
+    archive(meta);
+}
+
+// Contents of a ROM or tune file
+struct Image
+{
+    /* The mapped file or blob holding the data, or nullptr for the older
+     * layout. The data starts at `offset`. */
+    std::shared_ptr<const os::MappedFile> file;
+    std::size_t offset{0};
+    std::size_t size{0};
+    // The image of files in the older layout
+    MemoryBuffer data;
+};
+
+/* Reads the metadata of a ROM or tune file. Image files are mapped, along
+ * with the blob in `blobs` holding their data; older files are read into
+ * memory. */
+template <typename MetaData> Image readImage(const fs::path & path, MetaData & meta, BlobStore & blobs)
+{
+    Image image;
+    auto file = std::make_shared<os::MappedFile>(path.string());
+    std::optional<ImageHeader> header = readImageHeader(file->data(), file->size());
+    if (!header)
+    {
+        file.reset();
+        std::ifstream stream(path, std::ios::binary | std::ios::in);
+        if (!stream.is_open())
+            throw std::runtime_error("failed to open '" + path.string() + "'");
+        cereal::BinaryInputArchive archive(stream);
+        archive(meta, image.data);
+        return image;
+    }
+
+    decodeMetaData(file->data() + header->metadataOffset(), header->metadataSize, meta);
+    image.size = static_cast<std::size_t>(header->dataSize);
+    if (header->blob)
+    {
+        image.file = blobs.map(*header->blob, image.size);
+    }
+    else
+    {
+        image.file = std::move(file);
+        image.offset = static_cast<std::size_t>(header->dataOffset);
+    }
+    return image;
+}
+
+} // namespace
+
 RomPtr Project::getRom(const std::string & filename)
 {
     // Search the cache
     if (auto it = cache_.find(filename); it != cache_.end())
     {
-        // Check if the pointer has expired
-        if (auto rom = it->second.lock())
+        // Check if the pointer has expired. A changed file is read again.
+        if (auto rom = it->second.lock(); rom && rom->fileState() != FileState::Changed)
             return rom;
     }
 
-    std::ifstream file(romsDir_ / filename, std::ios::binary | std::ios::in);
-    if (!file.is_open())
+    const fs::path path = romsDir_ / filename;
+    if (!fs::is_regular_file(path))
         return RomPtr();
 
-    // Deserialize ROM with cereal
-    cereal::BinaryInputArchive archive(file);
     Rom::MetaData meta;
-    MemoryBuffer data;
-    archive(meta, data);
+    Image image = readImage(path, meta, *blobs_);
 
     // Find the model
     ModelPtr model =
@@ -46,9 +105,14 @@ RomPtr Project::getRom(const std::string & filename)
     auto rom = std::make_shared<Rom>(model);
     rom->setPath(romsDir_ / filename);
     rom->setName(meta.name);
-    rom->setData(std::move(data));
+    rom->setBlobStore(blobs_);
+    // ROMs are never modified, so the data can stay in the mapping
+    if (image.file)
+        rom->setImage(std::move(image.file), image.offset, static_cast<int>(image.size));
+    else
+        rom->setData(std::move(image.data));
     // Insert into cache
-    cache_.emplace(filename, rom);
+    cache_.insert_or_assign(filename, rom);
     return rom;
 }
 
@@ -57,19 +121,46 @@ TunePtr Project::loadTune(const std::string & filename)
     // Search the cache
     if (auto it = tuneCache_.find(filename); it != tuneCache_.end())
     {
-        // Check if the pointer has expired
-        if (auto tune = it->second.lock())
+        // Check if the pointer has expired. A changed file or base is read again.
+        if (auto tune = it->second.lock();
+            tune && tune->fileState() != FileState::Changed && tune->base()->fileState() != FileState::Changed)
             return tune;
     }
 
-    std::ifstream file(tunesDir_ / filename, std::ios::binary | std::ios::in);
-    if (!file.is_open())
+    const fs::path path = tunesDir_ / filename;
+    if (!fs::is_regular_file(path))
         return TunePtr();
 
-    cereal::BinaryInputArchive archive(file);
+    os::MappedFile file(path.string());
+    if (std::optional<DeltaHeader> header = readDeltaHeader(file.data(), file.size()))
+    {
+        Tune::MetaData meta;
+        decodeMetaData(file.data() + header->metadataOffset(), header->metadataSize, meta);
+        RomPtr rom = getRom(meta.base);
+        if (!rom)
+            throw std::runtime_error("unable to find ROM with id '" + meta.base + "'");
+
+        // The deltas are applied over a copy-on-write mapping of the base
+        auto tune = std::make_shared<Tune>(rom);
+        // Setting the path resets the state of the file, so set it first
+        tune->setPath(path);
+        tune->loadDeltas(file.data(), file.size(), *header);
+        return openTune(tune, meta);
+    }
+    file.close();
+
+    // Tunes saved before the delta format hold the whole image. It is
+    // copied out, as the first save replaces the file, which fails on
+    // Windows while it is mapped.
     Tune::MetaData meta;
-    MemoryBuffer data;
-    archive(meta, data);
+    Image image = readImage(path, meta, *blobs_);
+    MemoryBuffer data = std::move(image.data);
+    if (image.file && image.size != 0)
+    {
+        const uint8_t * bytes = image.file->data() + image.offset;
+        data = MemoryBuffer(bytes, bytes + image.size);
+        image.file.reset();
+    }
 
     RomPtr rom = getRom(meta.base);
     if (!rom)
@@ -77,9 +168,15 @@ TunePtr Project::loadTune(const std::string & filename)
                                  meta.base + "'");
 
     auto tune = std::make_shared<Tune>(rom, std::move(data));
-    tune->setPath(tunesDir_ / filename);
+    tune->setPath(path);
+    return openTune(tune, meta);
+}
+
+TunePtr Project::openTune(const TunePtr & tune, const Tune::MetaData & meta)
+{
     tune->setName(meta.name);
-    tuneCache_.emplace(filename, tune);
+    tune->loadJournal();
+    tuneCache_.insert_or_assign(tune->path().filename().string(), tune);
     return tune;
 }
 
@@ -89,55 +186,258 @@ const fs::path & Project::romsDirectory() const noexcept { return romsDir_; }
 
 Project::Project(const fs::path& base, const Platforms & platforms)
     : path_(base), tunesDir_(base / "tunes"), romsDir_(base / "roms"),
-      platforms_(std::move(platforms))
+      platforms_(std::move(platforms)), blobs_(std::make_shared<BlobStore>(base / "blobs"))
 {
 }
 
-template <typename MetaData>
-std::vector<MetaData> getMetaData(fs::path & dir, bool requiresExtension,
-                                  const std::string & extension)
+/* Reads the metadata of a ROM or tune file and the blob it references.
+ * Unreadable files give empty metadata so they still show up. */
+template <typename MetaData> MetaData readMetaData(const fs::path & path, BlobRef & blob)
 {
-    std::vector<MetaData> metadata;
-    for (const auto & entry : fs::directory_iterator(dir))
-    {
-        if (!entry.is_regular_file() ||
-            (requiresExtension && entry.path().extension() != extension))
-            continue;
-
-        std::ifstream file(entry.path(), std::ios::binary | std::ios::in);
-        if (!file.is_open())
-            continue; // TODO: Log this
+    MetaData md;
+    blob = BlobRef{};
+    std::ifstream file(path, std::ios::binary | std::ios::in);
+    if (!file.is_open())
+        return md; // TODO: Log this
 
+    try
+    {
+        // Only the header and metadata are read
+        const auto size = static_cast<std::size_t>(fs::file_size(path));
+        std::optional<ImageHeader> header = readImageHeader(file, size);
+        if (!header)
+            readDeltaHeader(file, size);
+        if (header && header->blob)
+            blob = BlobRef{BlobRef::Kind::Blob, *header->blob};
+        else
+            blob.kind = BlobRef::Kind::None;
         cereal::BinaryInputArchive ar(file);
-        MetaData md;
-        try
-        {
-            ar(md);
-        }
-        catch (const std::runtime_error & err)
-        {
-            // TODO: Log exception
-        }
-        md.path = entry.path();
-        metadata.emplace_back(std::move(md));
+        ar(md);
     }
-    return metadata;
+    catch (const std::runtime_error & err)
+    {
+        // TODO: Log exception
+    }
+    return md;
 }
 
 std::vector<Rom::MetaData> Project::queryRoms()
 {
     if (!fs::exists(romsDir_))
         return std::vector<Rom::MetaData>();
-    return getMetaData<Rom::MetaData>(romsDir_, enforceExtensions_,
-                                      Rom::extension);
+    loadIndex();
+    auto roms = romIndex_.query(romsDir_, enforceExtensions_, Rom::extension, readMetaData<Rom::MetaData>);
+    // Once per session, for blobs left by other sessions
+    if (!blobsSwept_)
+        sweepBlobs();
+    saveIndex();
+    return roms;
 }
 
 std::vector<Tune::MetaData> Project::queryTunes()
 {
     if (!fs::exists(tunesDir_))
         return std::vector<Tune::MetaData>();
-    return getMetaData<Tune::MetaData>(tunesDir_, enforceExtensions_,
-                                       Tune::extension);
+    loadIndex();
+    auto tunes = tuneIndex_.query(tunesDir_, enforceExtensions_, Tune::extension, readMetaData<Tune::MetaData>);
+    if (!blobsSwept_)
+        sweepBlobs();
+    saveIndex();
+    return tunes;
+}
+
+std::optional<Rom::MetaData> Project::romMetaData(const std::string & filename) const
+{
+    return romIndex_.find(romsDir_, filename);
+}
+
+std::optional<Tune::MetaData> Project::tuneMetaData(const std::string & filename) const
+{
+    return tuneIndex_.find(tunesDir_, filename);
+}
+
+void Project::loadIndex()
+{
+    if (indexLoaded_)
+        return;
+    indexLoaded_ = true;
+
+    std::ifstream file(path_ / index_filename, std::ios::binary | std::ios::in);
+    if (!file.is_open())
+        return;
+    try
+    {
+        cereal::BinaryInputArchive archive(file);
+        uint32_t version = 0;
+        archive(version);
+        if (version == indexVersion)
+            archive(romIndex_, tuneIndex_);
+    }
+    catch (const std::runtime_error &)
+    {
+        // Rebuilt by the next queries
+        romIndex_ = MetaDataIndex<Rom::MetaData>();
+        tuneIndex_ = MetaDataIndex<Tune::MetaData>();
+    }
+    romIndex_.setChanged(false);
+    tuneIndex_.setChanged(false);
+}
+
+void Project::saveIndex()
+{
+    if (!romIndex_.changed() && !tuneIndex_.changed())
+        return;
+
+    fs::path path = path_ / index_filename;
+    fs::path temporary = path;
+    temporary += ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::out | std::ios::trunc);
+        if (!file.is_open())
+            return; // The index is only a cache
+        cereal::BinaryOutputArchive archive(file);
+        archive(indexVersion, romIndex_, tuneIndex_);
+    }
+    std::error_code ec;
+    fs::rename(temporary, path, ec);
+    if (ec)
+    {
+        fs::remove(temporary, ec);
+        return;
+    }
+    romIndex_.setChanged(false);
+    tuneIndex_.setChanged(false);
+}
+
+namespace
+{
+
+/* Sets the state of the open ROM or tune `entry` after a change to its
+ * file. Returns true if it no longer matches the file. */
+template <typename Entry> bool updateFileState(Entry & entry, bool removed)
+{
+    if (removed)
+        entry.setFileState(FileState::Removed);
+    else
+        entry.setFileState(entry.matchesFile() ? FileState::Current : FileState::Changed);
+    return entry.fileState() != FileState::Current;
+}
+
+/* Updates the entry of `filename`, if any, after a change to its file.
+ * Entries still in use stay cached, even once removed. Returns true if
+ * the entry is open and no longer matches its file. */
+template <typename Cache> bool updateCached(Cache & cache, const std::string & filename, bool removed)
+{
+    auto it = cache.find(filename);
+    if (it == cache.end())
+        return false;
+    auto entry = it->second.lock();
+    if (!entry)
+    {
+        cache.erase(it);
+        return false;
+    }
+    return updateFileState(*entry, removed);
+}
+
+/* Drops all entries that are no longer in use and checks the others
+ * against their files in `directory`. Calls `stale(filename, removed)`
+ * for each that newly stopped matching. */
+template <typename Cache, typename Stale>
+void recheckCached(Cache & cache, const fs::path & directory, Stale && stale)
+{
+    for (auto it = cache.begin(); it != cache.end();)
+    {
+        auto entry = it->second.lock();
+        if (!entry)
+        {
+            it = cache.erase(it);
+            continue;
+        }
+        const FileState before = entry->fileState();
+        std::error_code ec;
+        const bool removed = !fs::exists(directory / it->first, ec);
+        if (updateFileState(*entry, removed) && entry->fileState() != before)
+            stale(it->first, removed);
+        ++it;
+    }
+}
+
+} // namespace
+
+bool Project::watch()
+{
+    if (watcher_)
+        return true;
+
+    auto watcher = std::make_unique<os::FileWatcher>();
+    if (!watcher->watch(romsDir_) || !watcher->watch(tunesDir_) || !watcher->watch(logsDirectory()))
+        return false;
+    watcher_ = std::move(watcher);
+    return true;
+}
+
+int Project::watchHandle() const noexcept { return watcher_ ? watcher_->handle() : -1; }
+
+std::vector<Project::Change> Project::pollChanges(std::chrono::milliseconds timeout)
+{
+    std::vector<Change> changes;
+    if (!watcher_)
+        return changes;
+
+    loadIndex();
+    for (os::FileWatcher::Change & fileChange : watcher_->poll(timeout))
+    {
+        Change change{Change::Directory::Logs, fileChange.event, std::move(fileChange.filename)};
+        const bool roms = fileChange.directory == romsDir_;
+        if (!roms && fileChange.directory != tunesDir_)
+        {
+            changes.emplace_back(std::move(change));
+            continue;
+        }
+        change.directory = roms ? Change::Directory::Roms : Change::Directory::Tunes;
+
+        if (change.event == os::FileWatcher::Event::Rescan)
+        {
+            const Change::Directory directory = change.directory;
+            changes.emplace_back(std::move(change));
+            auto stale = [&](const std::string & filename, bool removed) {
+                using Event = os::FileWatcher::Event;
+                changes.push_back(Change{directory, removed ? Event::Removed : Event::Modified, filename, true});
+            };
+            // The index is checked against the files by the next query
+            if (roms)
+                recheckCached(cache_, romsDir_, stale);
+            else
+                recheckCached(tuneCache_, tunesDir_, stale);
+            continue;
+        }
+
+        // Also skips the temporary files of saves
+        if (enforceExtensions_ &&
+            fs::path(change.filename).extension() != (roms ? Rom::extension : Tune::extension))
+            continue;
+
+        const bool removed = change.event == os::FileWatcher::Event::Removed;
+        bool known;
+        if (roms)
+        {
+            known = romIndex_.contains(change.filename);
+            romIndex_.update(romsDir_, change.filename, readMetaData<Rom::MetaData>);
+            change.stale = updateCached(cache_, change.filename, removed);
+        }
+        else
+        {
+            known = tuneIndex_.contains(change.filename);
+            tuneIndex_.update(tunesDir_, change.filename, readMetaData<Tune::MetaData>);
+            change.stale = updateCached(tuneCache_, change.filename, removed);
+        }
+        if (known && change.event == os::FileWatcher::Event::Added)
+            change.event = os::FileWatcher::Event::Modified;
+        changes.emplace_back(std::move(change));
+    }
+    saveIndex();
+    return changes;
 }
 
 TunePtr Project::createTune(RomPtr base, const std::string & name)
@@ -156,6 +456,7 @@ void Project::makeDirectories()
     fs::create_directories(romsDirectory());
     fs::create_directories(tunesDirectory());
     fs::create_directories(logsDirectory());
+    fs::create_directories(blobs_->directory());
 }
 
 std::filesystem::path Project::logsDirectory() const noexcept
@@ -222,6 +523,7 @@ RomPtr Project::createRom(const std::string & name, lt::ModelPtr model)
     auto rom = std::make_shared<lt::Rom>(model);
     rom->setName(name);
     rom->setPath(generateRomPath(name));
+    rom->setBlobStore(blobs_);
 
     cache_.emplace(rom->path().string(), rom);
     return rom;
@@ -261,13 +563,47 @@ RomPtr Project::importRom(const std::string & name,
 bool Project::deleteRom(const std::string & filename)
 {
     cache_.erase(filename);
-    return fs::remove(romsDir_ / filename);
+    if (!fs::remove(romsDir_ / filename))
+        return false;
+    sweepBlobs();
+    saveIndex();
+    return true;
+}
+
+void Project::sweepBlobs()
+{
+    blobsSwept_ = true;
+    loadIndex();
+    try
+    {
+        // Brings the index up to date, reading only new and changed files
+        if (fs::exists(romsDir_))
+            romIndex_.query(romsDir_, enforceExtensions_, Rom::extension, readMetaData<Rom::MetaData>);
+        if (fs::exists(tunesDir_))
+            tuneIndex_.query(tunesDir_, enforceExtensions_, Tune::extension, readMetaData<Tune::MetaData>);
+    }
+    catch (const fs::filesystem_error &)
+    {
+        return;
+    }
+
+    std::vector<BlobId> referenced;
+    if (romIndex_.collectBlobs(referenced) && tuneIndex_.collectBlobs(referenced))
+        blobs_->sweep(referenced);
 }
 
 bool Project::deleteTune(const std::string & filename)
 {
     tuneCache_.erase(filename);
-    return fs::remove(tunesDir_ / filename);
+    fs::path path = tunesDir_ / filename;
+    std::error_code ec;
+    fs::remove(fs::path(path).replace_extension(Tune::journalExtension), ec);
+    if (!fs::remove(path))
+        return false;
+    // Tunes saved before the delta format may reference a blob
+    sweepBlobs();
+    saveIndex();
+    return true;
 }
 
 } // namespace lt
@@ -1,8 +1,13 @@
 #ifndef LIBRETUNER_PROJECT_H
 #define LIBRETUNER_PROJECT_H
 
+#include "../os/filewatcher.h"
 #include "../rom/rom.h"
+#include "metadataindex.h"
+#include <chrono>
 #include <filesystem>
+#include <memory>
+#include <optional>
 #include <string>
 
 namespace lt
@@ -17,7 +22,8 @@ public:
     /* Loads a ROM by filename. If the ROM is cached, it will be returned.
      * Otherwise, the directory is searched and if the ROM cannot
      * be found, RomPtr() is returned. If the ROM was found but deserialization
-     * fails, throws an exception. */
+     * fails, throws an exception. The image is mapped read-only rather
+     * than read, unless the file predates the layout of imagefile.h. */
     RomPtr getRom(const std::string & filename);
 
     /* Creates a new blank ROM from `name`. Sets path. */
@@ -45,15 +51,23 @@ public:
     TunePtr loadTune(const std::string & filename);
 
     /* Searches all ROM files and extracts their metadata. Silently ignores
-     * invalid ROMs. This is an expensive operation that should not
-     * be called often. */
+     * invalid ROMs. Metadata is cached in the project's index file;
+     * only files that are new or changed since the last query are read,
+     * in parallel. */
     std::vector<Rom::MetaData> queryRoms();
 
     /* Searches all tune files and extracts their metadata. Silently ignores
-     * invalid tunes. This is an expensive operation that should not
-     * be called often. */
+     * invalid tunes. Metadata is cached in the project's index file;
+     * only files that are new or changed since the last query are read,
+     * in parallel. */
     std::vector<Tune::MetaData> queryTunes();
 
+    /* Returns the indexed metadata of a ROM or tune file as of the last
+     * query or pollChanges(), or nothing if the file is not indexed. The
+     * file is not read. */
+    std::optional<Rom::MetaData> romMetaData(const std::string & filename) const;
+    std::optional<Tune::MetaData> tuneMetaData(const std::string & filename) const;
+
     const std::filesystem::path & tunesDirectory() const noexcept;
     const std::filesystem::path & romsDirectory() const noexcept;
 
@@ -80,7 +94,55 @@ public:
 
     std::filesystem::path logsDirectory() const noexcept;
 
+    /* Store of the ROM images of the project. Identical images are kept
+     * once; contains(data, size) tells whether an image was seen before.
+     * Blobs no ROM or tune file references are removed after the first
+     * query of a session and whenever a ROM or tune is deleted. */
+    inline BlobStore & blobs() noexcept { return *blobs_; }
+
+    // Change to a project file made outside of the project
+    struct Change
+    {
+        enum class Directory
+        {
+            Roms,
+            Tunes,
+            Logs,
+        };
+
+        Directory directory;
+        os::FileWatcher::Event event;
+        // Empty if the directory must be listed again
+        std::string filename;
+        /* Set if the ROM or tune of the file is open and no longer matches
+         * it; see Rom::fileState() and Tune::fileState() */
+        bool stale{false};
+    };
+
+    /* Starts watching the ROM, tune and log directories, which must exist.
+     * Returns false if watching is not supported on this platform. Throws
+     * an exception if a directory cannot be watched. */
+    bool watch();
+
+    /* Returns a descriptor that becomes readable when changes are pending,
+     * or -1 if the project is not watched. */
+    int watchHandle() const noexcept;
+
+    /* Applies the changes since the last call to the metadata index and
+     * the ROM and tune caches and returns them, waiting up to `timeout`
+     * for the first one. Only the changed files are read again. Files
+     * added over a known one are reported as modified.
+     *
+     * Open ROMs and tunes are checked against their changed files, so
+     * saving them is not reported as stale. One changed by another
+     * program is marked FileState::Changed and loaded again by the next
+     * getRom() or loadTune(); one removed is marked FileState::Removed
+     * and stays cached while open. */
+    std::vector<Change> pollChanges(std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+
     static constexpr auto config_filename = "config.json";
+    // Cache of ROM and tune metadata
+    static constexpr auto index_filename = "index.bin";
 
 private:
     // Project directory
@@ -93,6 +155,18 @@ private:
     std::unordered_map<std::string, WeakRomPtr> cache_;
     std::unordered_map<std::string, WeakTunePtr> tuneCache_;
     const Platforms & platforms_;
+    BlobStorePtr blobs_;
+
+    // Version 2 dropped the directory modification times and version 3
+    // added the blobs referenced by the files
+    static constexpr uint32_t indexVersion = 3;
+    MetaDataIndex<Rom::MetaData> romIndex_;
+    MetaDataIndex<Tune::MetaData> tuneIndex_;
+    bool indexLoaded_{false};
+    // Set once the blobs were swept this session
+    bool blobsSwept_{false};
+
+    std::unique_ptr<os::FileWatcher> watcher_;
 
     /* If true, tunes and ROMs must have the proper extension
      * to be loaded. */
@@ -102,6 +176,19 @@ private:
 
     // Logs
 
+    // Finishes loading `tune`, whose path is set, and caches it
+    TunePtr openTune(const TunePtr & tune, const Tune::MetaData & meta);
+
+    // Loads the metadata index on first use
+    void loadIndex();
+    /* Removes the blobs that no ROM or tune file references. The blobs of
+     * the files are kept in the index, so only files that are new or
+     * changed since they were indexed are read. Does nothing if a file or
+     * directory cannot be read. */
+    void sweepBlobs();
+    // Saves the metadata index if it changed. Failures are ignored.
+    void saveIndex();
+
     // Generates the next available id based on the name
     std::filesystem::path generateRomPath(std::string name);
     std::filesystem::path generateTunePath(std::string name);
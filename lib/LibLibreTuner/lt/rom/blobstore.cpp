@@ -0,0 +1,195 @@
+#include "blobstore.h"
+
+#include "../support/checksumkernels.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+#include <unordered_set>
+
+namespace lt
+{
+
+namespace
+{
+
+// Seed of the upper half of an id
+constexpr uint64_t HighSeed = 0x9E3779B97F4A7C15ull;
+
+/* Files younger than this are never swept. put() and writing the file that
+ * references the blob take far less. */
+constexpr auto SweepGrace = std::chrono::minutes(5);
+
+bool equals(const os::MappedFile & file, const uint8_t * data, std::size_t size) noexcept
+{
+    return file.size() == size && (size == 0 || std::memcmp(file.data(), data, size) == 0);
+}
+
+// Returns true if `name` is the name of a blob, as written by BlobId::hex()
+bool isBlobName(const std::string & name) noexcept
+{
+    return name.size() == 32 && std::all_of(name.begin(), name.end(), [](char c) {
+               return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+           });
+}
+
+// Renews the modification time of a reused blob. Failures are ignored.
+void touch(const std::filesystem::path & blob) noexcept
+{
+    std::error_code ec;
+    std::filesystem::last_write_time(blob, std::filesystem::file_time_type::clock::now(), ec);
+}
+
+} // namespace
+
+BlobId BlobId::of(const uint8_t * data, std::size_t size) noexcept
+{
+    BlobId id;
+    id.low = checksum::xxh64(data, size);
+    id.high = checksum::xxh64(data, size, HighSeed);
+    return id;
+}
+
+std::string BlobId::hex() const
+{
+    char digits[33];
+    std::snprintf(digits, sizeof(digits), "%016llx%016llx", static_cast<unsigned long long>(high),
+                  static_cast<unsigned long long>(low));
+    return digits;
+}
+
+std::filesystem::path BlobStore::path(const BlobId & id) const { return directory_ / id.hex(); }
+
+BlobStore::Match BlobStore::match(const BlobId & id, const uint8_t * data, std::size_t size) const
+{
+    if (auto it = mapped_.find(id); it != mapped_.end())
+    {
+        if (auto file = it->second.lock(); file && equals(*file, data, size))
+            return Match::Equal;
+    }
+
+    const std::filesystem::path blob = path(id);
+    std::error_code ec;
+    if (!std::filesystem::exists(blob, ec))
+        return ec ? Match::Other : Match::Missing;
+    try
+    {
+        os::MappedFile file(blob.string());
+        if (equals(file, data, size))
+            return Match::Equal;
+        return idOf(file.data(), file.size()) == id ? Match::Other : Match::Damaged;
+    }
+    catch (const std::runtime_error &)
+    {
+        // Unreadable blobs are not known to be damaged and are left alone
+        return Match::Other;
+    }
+}
+
+bool BlobStore::contains(const uint8_t * data, std::size_t size) const
+{
+    return match(idOf(data, size), data, size) == Match::Equal;
+}
+
+std::optional<BlobId> BlobStore::put(const uint8_t * data, std::size_t size)
+{
+    const BlobId id = idOf(data, size);
+    const std::filesystem::path blob = path(id);
+
+    switch (match(id, data, size))
+    {
+    case Match::Equal:
+        touch(blob);
+        return id;
+    case Match::Other:
+        /* Files referencing the blob must keep their image, so an id
+         * collision is never resolved by replacing it. */
+        return std::nullopt;
+    case Match::Missing:
+    case Match::Damaged:
+        break;
+    }
+
+    // A damaged blob is replaced; its mappings stay valid
+    std::error_code ec;
+    std::filesystem::create_directories(directory_, ec);
+    std::filesystem::path temporary = blob;
+    temporary += ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::out | std::ios::trunc);
+        if (!file.is_open())
+            throw std::runtime_error("failed to open '" + temporary.string() + "' for writing");
+        if (!file.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(size)).flush())
+            throw std::runtime_error("failed to write '" + temporary.string() + "'");
+    }
+
+    std::filesystem::rename(temporary, blob, ec);
+    if (ec)
+    {
+        std::filesystem::remove(temporary, ec);
+        throw std::runtime_error("failed to replace '" + blob.string() + "'");
+    }
+    mapped_.erase(id);
+    return id;
+}
+
+std::shared_ptr<const os::MappedFile> BlobStore::map(const BlobId & id, std::size_t size)
+{
+    auto & entry = mapped_[id];
+    std::shared_ptr<const os::MappedFile> file = entry.lock();
+    if (!file)
+    {
+        file = std::make_shared<const os::MappedFile>(path(id).string());
+        if (file->size() == size && idOf(file->data(), file->size()) != id)
+            throw std::runtime_error("blob " + id.hex() + " is damaged");
+        entry = file;
+    }
+    if (file->size() != size)
+        throw std::runtime_error("blob " + id.hex() + " does not match the size of its reference");
+    return file;
+}
+
+std::size_t BlobStore::sweep(const std::vector<BlobId> & referenced)
+{
+    std::unordered_set<std::string> keep;
+    for (const BlobId & id : referenced)
+        keep.insert(id.hex());
+    for (auto it = mapped_.begin(); it != mapped_.end();)
+    {
+        if (it->second.expired())
+        {
+            it = mapped_.erase(it);
+            continue;
+        }
+        keep.insert(it->first.hex());
+        ++it;
+    }
+
+    const auto cutoff = std::filesystem::file_time_type::clock::now() - SweepGrace;
+    std::size_t removed = 0;
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(directory_, ec), end; !ec && it != end; it.increment(ec))
+    {
+        const std::filesystem::path & path = it->path();
+        const std::string name = path.filename().string();
+        const bool temporary = path.extension() == ".tmp" && isBlobName(path.stem().string());
+        if (!temporary && (!isBlobName(name) || keep.count(name) != 0))
+            continue;
+
+        // Also kept if the time cannot be read
+        std::error_code fileEc;
+        const auto modified = it->last_write_time(fileEc);
+        if (fileEc || modified > cutoff)
+            continue;
+
+        if (std::filesystem::remove(path, fileEc) && !temporary)
+            ++removed;
+    }
+    return removed;
+}
+
+} // namespace lt
@@ -0,0 +1,116 @@
+#ifndef LT_BLOBSTORE_H
+#define LT_BLOBSTORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../os/mappedfile.h"
+
+namespace lt
+{
+
+/* 128-bit hash naming the contents of a blob, made of two XXH64 hashes
+ * with different seeds. It is fast but not collision resistant, so the
+ * store compares bytes before taking an id to stand for some data. */
+struct BlobId
+{
+    uint64_t low{0};
+    uint64_t high{0};
+
+    // Hashes `size` bytes of `data`
+    static BlobId of(const uint8_t * data, std::size_t size) noexcept;
+
+    template <class Archive> void serialize(Archive & archive) { archive(low, high); }
+
+    // Returns the id as 32 hex digits
+    std::string hex() const;
+
+    inline bool operator==(const BlobId & other) const noexcept { return low == other.low && high == other.high; }
+    inline bool operator!=(const BlobId & other) const noexcept { return !(*this == other); }
+
+    struct Hash
+    {
+        inline std::size_t operator()(const BlobId & id) const noexcept { return static_cast<std::size_t>(id.low); }
+    };
+};
+
+/* Content-addressed store of ROM images. Each distinct image is stored
+ * once, in a file named by its id, and mapped once while in use. Files
+ * that reference a blob only hold its id. */
+class BlobStore
+{
+public:
+    using HashFunction = BlobId (*)(const uint8_t * data, std::size_t size) noexcept;
+
+    /* Stores blobs in `directory`, named by `hash`. Tests pass a weaker
+     * hash to produce collisions. */
+    explicit BlobStore(std::filesystem::path directory, HashFunction hash = &BlobId::of)
+        : directory_(std::move(directory)), hash_(hash)
+    {
+    }
+
+    inline const std::filesystem::path & directory() const noexcept { return directory_; }
+
+    // Returns the id of `size` bytes of `data` in this store
+    inline BlobId idOf(const uint8_t * data, std::size_t size) const noexcept { return hash_(data, size); }
+
+    // Returns the path of the blob `id`, which may not exist
+    std::filesystem::path path(const BlobId & id) const;
+
+    /* Returns true if a blob holding exactly `size` bytes of `data` is
+     * stored. The blob with the same id is compared byte for byte. */
+    bool contains(const uint8_t * data, std::size_t size) const;
+
+    /* Stores `size` bytes of `data` and returns their id. Nothing is
+     * written if an identical blob is stored, but its modification time
+     * is renewed so sweep() spares it until the caller has written the
+     * file referencing it. A stored blob is only replaced if it is
+     * damaged, i.e. its bytes no longer hash to its id. Returns
+     * std::nullopt if an intact blob with the same id holds other bytes,
+     * in which case the caller must store the data itself. Throws
+     * std::runtime_error if the blob cannot be written. */
+    std::optional<BlobId> put(const uint8_t * data, std::size_t size);
+
+    /* Maps the blob `id` read-only, sharing the mapping with all other
+     * users. A blob is hashed again when it is first mapped. Throws
+     * std::runtime_error if the blob is missing, does not hold `size`
+     * bytes or does not match `id`. */
+    std::shared_ptr<const os::MappedFile> map(const BlobId & id, std::size_t size);
+
+    /* Removes every stored blob that is neither in `referenced` nor
+     * mapped, along with temporary files of interrupted writes. Blobs
+     * and temporary files modified within the last few minutes are kept,
+     * as another instance may be saving a file that references them.
+     * Returns the number of blobs removed. */
+    std::size_t sweep(const std::vector<BlobId> & referenced);
+
+private:
+    enum class Match
+    {
+        Missing,
+        // Holds the data
+        Equal,
+        // Holds other bytes of the same id, or cannot be read
+        Other,
+        // Holds bytes that do not hash to its id
+        Damaged,
+    };
+
+    // Compares the blob `id` with `size` bytes of `data`
+    Match match(const BlobId & id, const uint8_t * data, std::size_t size) const;
+
+    std::filesystem::path directory_;
+    HashFunction hash_;
+    std::unordered_map<BlobId, std::weak_ptr<const os::MappedFile>, BlobId::Hash> mapped_;
+};
+using BlobStorePtr = std::shared_ptr<BlobStore>;
+
+} // namespace lt
+
+#endif // LT_BLOBSTORE_H
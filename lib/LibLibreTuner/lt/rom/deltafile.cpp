@@ -0,0 +1,254 @@
+#include "deltafile.h"
+
+#include "../support/checksumkernels.h"
+#include "../support/endianness.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+
+namespace lt
+{
+
+namespace
+{
+
+constexpr char Magic[4] = {'L', 'T', 'D', 'T'};
+
+template <typename T> T loadLE(const uint8_t * data) noexcept
+{
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return endian::fromLittle(value);
+}
+
+template <typename T> void appendLE(std::string & out, T value)
+{
+    value = endian::toLittle(value);
+    out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+// Encodes one record with `ranges` of `data`
+std::string encodeRecord(const uint8_t * data, const std::vector<ByteRange> & ranges)
+{
+    std::size_t size = sizeof(uint32_t) + sizeof(uint64_t);
+    for (const ByteRange & range : ranges)
+        size += 2 * sizeof(uint32_t) + static_cast<std::size_t>(range.size());
+
+    std::string record;
+    record.reserve(size);
+    appendLE<uint32_t>(record, static_cast<uint32_t>(ranges.size()));
+    for (const ByteRange & range : ranges)
+    {
+        appendLE<uint32_t>(record, static_cast<uint32_t>(range.begin));
+        appendLE<uint32_t>(record, static_cast<uint32_t>(range.size()));
+        record.append(reinterpret_cast<const char *>(data + range.begin), static_cast<std::size_t>(range.size()));
+    }
+    appendLE<uint64_t>(record, checksum::xxh64(reinterpret_cast<const uint8_t *>(record.data()), record.size()));
+    return record;
+}
+
+/* Returns the size of the valid record at `data`, or 0 if it is
+ * truncated, corrupt, or exceeds a base of `baseSize` bytes */
+std::size_t validateRecord(const uint8_t * data, std::size_t available, uint64_t baseSize)
+{
+    if (available < sizeof(uint32_t))
+        return 0;
+    const uint32_t spans = loadLE<uint32_t>(data);
+    std::size_t pos = sizeof(uint32_t);
+    for (uint32_t i = 0; i < spans; ++i)
+    {
+        if (available - pos < 2 * sizeof(uint32_t))
+            return 0;
+        const uint64_t offset = loadLE<uint32_t>(data + pos);
+        const uint64_t size = loadLE<uint32_t>(data + pos + 4);
+        pos += 2 * sizeof(uint32_t);
+        if (offset + size > baseSize || available - pos < size)
+            return 0;
+        pos += static_cast<std::size_t>(size);
+    }
+    if (available - pos < sizeof(uint64_t) || loadLE<uint64_t>(data + pos) != checksum::xxh64(data, pos))
+        return 0;
+    return pos + sizeof(uint64_t);
+}
+
+} // namespace
+
+std::optional<DeltaHeader> readDeltaHeader(const uint8_t * data, std::size_t fileSize)
+{
+    if (fileSize < sizeof(Magic) || std::memcmp(data, Magic, sizeof(Magic)) != 0)
+        return std::nullopt;
+    if (fileSize < DeltaHeader::size)
+        throw std::runtime_error("delta header is truncated");
+
+    if (loadLE<uint32_t>(data + 4) > DeltaHeader::version)
+        throw std::runtime_error("delta file was written by a newer version");
+
+    DeltaHeader header;
+    header.metadataSize = loadLE<uint64_t>(data + 8);
+    header.baseHash = loadLE<uint64_t>(data + 16);
+    header.baseSize = loadLE<uint64_t>(data + 24);
+    if (header.metadataSize > fileSize - DeltaHeader::size)
+        throw std::runtime_error("delta header does not match the file size");
+    return header;
+}
+
+std::optional<DeltaHeader> readDeltaHeader(std::istream & stream, std::size_t fileSize)
+{
+    std::array<uint8_t, DeltaHeader::size> bytes{};
+    std::size_t available = std::min(fileSize, bytes.size());
+    if (!stream.read(reinterpret_cast<char *>(bytes.data()), static_cast<std::streamsize>(available)))
+        throw std::runtime_error("failed to read delta header");
+
+    std::optional<DeltaHeader> header = readDeltaHeader(bytes.data(), fileSize);
+    if (!header)
+        stream.seekg(0);
+    return header;
+}
+
+DeltaLog applyDeltas(const uint8_t * file, std::size_t fileSize, const DeltaHeader & header, uint8_t * data)
+{
+    DeltaLog log;
+    log.end = static_cast<std::size_t>(header.recordsOffset());
+    while (log.end < fileSize)
+    {
+        const uint8_t * record = file + log.end;
+        std::size_t size = validateRecord(record, fileSize - log.end, header.baseSize);
+        if (size == 0)
+            break;
+
+        // Validated above, so the spans can be applied without checks
+        const uint32_t spans = loadLE<uint32_t>(record);
+        std::size_t pos = sizeof(uint32_t);
+        for (uint32_t i = 0; i < spans; ++i)
+        {
+            const uint32_t offset = loadLE<uint32_t>(record + pos);
+            const uint32_t length = loadLE<uint32_t>(record + pos + 4);
+            pos += 2 * sizeof(uint32_t);
+            std::memcpy(data + offset, record + pos, length);
+            pos += length;
+            log.bytes += length;
+        }
+        log.end += size;
+        ++log.records;
+        log.tail = loadLE<uint64_t>(record + size - sizeof(uint64_t));
+    }
+    return log;
+}
+
+DeltaFile encodeDeltaFile(const std::string & metadata, const DeltaHeader & header, const uint8_t * data,
+                          const std::vector<ByteRange> & ranges)
+{
+    DeltaFile file;
+    std::string & contents = file.contents;
+    contents.append(Magic, sizeof(Magic));
+    appendLE<uint32_t>(contents, DeltaHeader::version);
+    appendLE<uint64_t>(contents, metadata.size());
+    appendLE<uint64_t>(contents, header.baseHash);
+    appendLE<uint64_t>(contents, header.baseSize);
+    contents += metadata;
+    contents += encodeRecord(data, ranges);
+
+    file.log.end = contents.size();
+    file.log.records = 1;
+    file.log.tail = loadLE<uint64_t>(reinterpret_cast<const uint8_t *>(contents.data()) + contents.size() -
+                                     sizeof(uint64_t));
+    for (const ByteRange & range : ranges)
+        file.log.bytes += static_cast<std::size_t>(range.size());
+    return file;
+}
+
+void writeDeltaFile(const std::filesystem::path & path, const DeltaFile & file)
+{
+    std::filesystem::path temporary = path;
+    temporary += ".tmp";
+    {
+        std::ofstream stream(temporary, std::ios::binary | std::ios::out | std::ios::trunc);
+        if (!stream.is_open())
+            throw std::runtime_error("failed to open '" + temporary.string() + "' for writing");
+        if (!stream.write(file.contents.data(), static_cast<std::streamsize>(file.contents.size())).flush())
+            throw std::runtime_error("failed to write '" + temporary.string() + "'");
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(temporary, path, ec);
+    if (ec)
+    {
+        std::filesystem::remove(temporary, ec);
+        throw std::runtime_error("failed to replace '" + path.string() + "'");
+    }
+}
+
+std::uintmax_t verifyDeltaFile(const std::filesystem::path & path, const DeltaHeader & header, const DeltaLog & log)
+{
+    std::error_code ec;
+    const std::uintmax_t fileSize = std::filesystem::file_size(path, ec);
+    if (ec || fileSize < log.end || log.end < header.recordsOffset())
+        return 0;
+
+    std::ifstream file(path, std::ios::binary | std::ios::in);
+    if (!file.is_open())
+        return 0;
+    std::optional<DeltaHeader> current;
+    try
+    {
+        current = readDeltaHeader(file, static_cast<std::size_t>(fileSize));
+    }
+    catch (const std::runtime_error &)
+    {
+        return 0;
+    }
+    if (!current || current->metadataSize != header.metadataSize || current->baseHash != header.baseHash ||
+        current->baseSize != header.baseSize)
+        return 0;
+
+    if (log.records != 0)
+    {
+        std::array<uint8_t, sizeof(uint64_t)> tail{};
+        file.seekg(static_cast<std::streamoff>(log.end - tail.size()));
+        if (!file.read(reinterpret_cast<char *>(tail.data()), static_cast<std::streamsize>(tail.size())) ||
+            loadLE<uint64_t>(tail.data()) != log.tail)
+            return 0;
+    }
+    return fileSize;
+}
+
+bool appendDeltas(const std::filesystem::path & path, const DeltaHeader & header, DeltaLog & log,
+                  const uint8_t * data, const std::vector<ByteRange> & ranges)
+{
+    // Check that the file is still the one `log` describes
+    const std::uintmax_t fileSize = verifyDeltaFile(path, header, log);
+    if (fileSize == 0)
+        return false;
+
+    const std::string record = encodeRecord(data, ranges);
+
+    // Drop the remains of an interrupted save
+    if (fileSize != log.end)
+    {
+        std::error_code ec;
+        std::filesystem::resize_file(path, log.end, ec);
+        if (ec)
+            throw std::runtime_error("failed to truncate '" + path.string() + "'");
+    }
+
+    // Opening for input as well keeps the existing contents
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    if (!file.is_open())
+        throw std::runtime_error("failed to open '" + path.string() + "' for writing");
+    file.seekp(static_cast<std::streamoff>(log.end));
+    if (!file.write(record.data(), static_cast<std::streamsize>(record.size())).flush())
+        throw std::runtime_error("failed to append to '" + path.string() + "'");
+
+    log.end += record.size();
+    ++log.records;
+    log.tail = loadLE<uint64_t>(reinterpret_cast<const uint8_t *>(record.data()) + record.size() - sizeof(uint64_t));
+    for (const ByteRange & range : ranges)
+        log.bytes += static_cast<std::size_t>(range.size());
+    return true;
+}
+
+} // namespace lt
@@ -0,0 +1,108 @@
+#ifndef LT_DELTAFILE_H
+#define LT_DELTAFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "diff.h"
+
+namespace lt
+{
+
+/* Tune files store only the bytes that differ from the base ROM:
+ *
+ *   0  magic "LTDT"
+ *   4  uint32 version
+ *   8  uint64 metadata size
+ *  16  uint64 XXH64 of the base ROM data
+ *  24  uint64 base ROM size
+ *  32  metadata
+ *      records
+ *
+ * Every save appends one record:
+ *
+ *      uint32 span count
+ *      spans: uint32 offset, uint32 size, `size` bytes
+ *      uint64 XXH64 of the record up to here
+ *
+ * Records apply in order over the base ROM. A record that does not match
+ * its hash, as left by an interrupted save, ends the file. Integers are
+ * little endian. */
+struct DeltaHeader
+{
+    static constexpr uint32_t version = 1;
+    static constexpr std::size_t size = 32;
+
+    uint64_t metadataSize{0};
+    uint64_t baseHash{0};
+    uint64_t baseSize{0};
+
+    inline uint64_t metadataOffset() const noexcept { return size; }
+    // Offset of the first record
+    inline uint64_t recordsOffset() const noexcept { return size + metadataSize; }
+};
+
+/* Parses the header at the start of a file of `fileSize` bytes. `data`
+ * must hold the first min(fileSize, DeltaHeader::size) bytes. Returns
+ * std::nullopt if the file does not start with the magic. Throws
+ * std::runtime_error if the header is corrupt or from a newer version. */
+std::optional<DeltaHeader> readDeltaHeader(const uint8_t * data, std::size_t fileSize);
+
+/* Same as above for a stream at the start of the file. Leaves the stream
+ * at the metadata, or back at the start if there is no header. */
+std::optional<DeltaHeader> readDeltaHeader(std::istream & stream, std::size_t fileSize);
+
+struct DeltaLog
+{
+    // Size of the valid part of the file; the next record goes here
+    std::size_t end{0};
+    std::size_t records{0};
+    // Bytes of span data in all records
+    std::size_t bytes{0};
+    // Hash ending the last record, if any
+    uint64_t tail{0};
+};
+
+/* Applies the records of the delta file `file` to `data`, which holds
+ * `header.baseSize` bytes of the base ROM. Stops at the first record that
+ * is truncated or does not match its hash. */
+DeltaLog applyDeltas(const uint8_t * file, std::size_t fileSize, const DeltaHeader & header, uint8_t * data);
+
+// Delta file with a single record
+struct DeltaFile
+{
+    std::string contents;
+    // Log of the file once written
+    DeltaLog log;
+};
+
+// Encodes a delta file holding one record with `ranges` of `data`
+DeltaFile encodeDeltaFile(const std::string & metadata, const DeltaHeader & header, const uint8_t * data,
+                          const std::vector<ByteRange> & ranges);
+
+/* Writes `file` under a temporary name and renames it over `path`, so
+ * readers never see a partial file. */
+void writeDeltaFile(const std::filesystem::path & path, const DeltaFile & file);
+
+/* Returns the size of the delta file at `path` if it starts with
+ * `header` and its records end where `log` does, as checked by the hash
+ * ending the last record. Anything may follow the records. Returns 0 if
+ * the file cannot be read or does not match, as when it was replaced by
+ * another program. */
+std::uintmax_t verifyDeltaFile(const std::filesystem::path & path, const DeltaHeader & header, const DeltaLog & log);
+
+/* Appends a record with `ranges` of `data` to the delta file at `path`,
+ * first dropping anything after `log.end`, and updates `log`. Returns
+ * false without writing if verifyDeltaFile() fails; the file must then
+ * be rewritten in full. */
+bool appendDeltas(const std::filesystem::path & path, const DeltaHeader & header, DeltaLog & log,
+                  const uint8_t * data, const std::vector<ByteRange> & ranges);
+
+} // namespace lt
+
+#endif // LT_DELTAFILE_H
@@ -0,0 +1,200 @@
+#include "diff.h"
+#include "rom.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace lt
+{
+
+namespace
+{
+
+constexpr std::size_t Block = 64;
+
+#if defined(_MSC_VER)
+inline int countTrailingZeros(uint64_t v) noexcept
+{
+    unsigned long index;
+    _BitScanForward64(&index, v);
+    return static_cast<int>(index);
+}
+#else
+inline int countTrailingZeros(uint64_t v) noexcept { return __builtin_ctzll(v); }
+#endif
+
+// Returns a mask with bit i set if a[i] != b[i] for 64 bytes
+inline uint64_t differingBytes(const uint8_t * a, const uint8_t * b) noexcept
+{
+#if defined(__AVX2__)
+    uint64_t equal = 0;
+    for (int i = 0; i < 2; ++i)
+    {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i * 32));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i * 32));
+        equal |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y))))
+                 << (i * 32);
+    }
+    return ~equal;
+#elif defined(__SSE2__)
+    uint64_t equal = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i * 16));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i * 16));
+        equal |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, y))) << (i * 16);
+    }
+    return ~equal;
+#else
+    uint64_t mask = 0;
+    for (int i = 0; i < 8; ++i)
+    {
+        uint64_t x, y;
+        std::memcpy(&x, a + i * 8, 8);
+        std::memcpy(&y, b + i * 8, 8);
+        uint64_t d = x ^ y;
+        if (d == 0)
+            continue;
+        // Sets the high bit of every nonzero byte, then gathers them
+        const uint64_t low7 = 0x7F7F7F7F7F7F7F7Full;
+        uint64_t high = (((d & low7) + low7) | d) & ~low7;
+        uint8_t bytes = 0;
+        for (int k = 0; k < 8; ++k)
+        {
+            uint8_t byte;
+            std::memcpy(&byte, reinterpret_cast<const uint8_t *>(&high) + k, 1);
+            bytes |= static_cast<uint8_t>((byte >> 7) << k);
+        }
+        mask |= static_cast<uint64_t>(bytes) << (i * 8);
+    }
+    return mask;
+#endif
+}
+
+} // namespace
+
+std::vector<ByteRange> diffBytes(const uint8_t * a, const uint8_t * b, std::size_t size)
+{
+    std::vector<ByteRange> ranges;
+    bool open = false;
+    int start = 0;
+
+    std::size_t base = 0;
+    for (; base + Block <= size; base += Block)
+    {
+        uint64_t mask = differingBytes(a + base, b + base);
+        // Most blocks are unchanged
+        if (mask == (open ? ~uint64_t(0) : 0))
+            continue;
+
+        int i = 0;
+        while (i < static_cast<int>(Block))
+        {
+            // Find the next change of state within the block
+            uint64_t rest = (open ? ~mask : mask) >> i;
+            if (rest == 0)
+                break;
+            i += countTrailingZeros(rest);
+            if (open)
+                ranges.push_back(ByteRange{start, static_cast<int>(base) + i});
+            else
+                start = static_cast<int>(base) + i;
+            open = !open;
+        }
+    }
+
+    for (; base < size; ++base)
+    {
+        bool differs = a[base] != b[base];
+        if (differs == open)
+            continue;
+        if (open)
+            ranges.push_back(ByteRange{start, static_cast<int>(base)});
+        else
+            start = static_cast<int>(base);
+        open = differs;
+    }
+    if (open)
+        ranges.push_back(ByteRange{start, static_cast<int>(size)});
+    return ranges;
+}
+
+TuneDiff attributeDiff(const Model & model, std::vector<ByteRange> ranges)
+{
+    TuneDiff diff;
+    diff.ranges = std::move(ranges);
+
+    const DefinitionIndex & index = model.index;
+    // Index into diff.definitions per location, and the last entry counted
+    std::vector<int> slot(index.size(), -1);
+    std::vector<int> lastEntry(index.size(), -1);
+
+    std::vector<std::size_t> found;
+    std::vector<ByteRange> covered;
+    for (const ByteRange & range : diff.ranges)
+    {
+        diff.changedBytes += range.size();
+        covered.clear();
+        found.clear();
+
+        index.overlapping(range.begin, range.end, found);
+        for (std::size_t i : found)
+        {
+            const DefinitionLocation & l = index[i];
+            int first = std::max(range.begin, l.begin);
+            int last = std::min(range.end, l.end);
+            covered.push_back(ByteRange{first, last});
+
+            if (slot[i] < 0)
+            {
+                slot[i] = static_cast<int>(diff.definitions.size());
+                diff.definitions.push_back(DefinitionDiff{l.id, l.axis, l.begin, l.end - l.begin, 0, 0});
+            }
+            DefinitionDiff & def = diff.definitions[slot[i]];
+            def.changedBytes += last - first;
+
+            // Ranges are ascending, so an entry can only be shared with
+            // an earlier range
+            int firstEntry = std::max((first - l.begin) / l.entrySize, lastEntry[i] + 1);
+            int finalEntry = (last - 1 - l.begin) / l.entrySize;
+            if (finalEntry >= firstEntry)
+                def.changedEntries += finalEntry - firstEntry + 1;
+            lastEntry[i] = std::max(lastEntry[i], finalEntry);
+        }
+
+        // Bytes of the range covered by no definition; `covered` is
+        // ascending because the index reports locations in order
+        int uncovered = range.size();
+        int coveredTo = range.begin;
+        for (const ByteRange & c : covered)
+        {
+            if (c.end <= coveredTo)
+                continue;
+            uncovered -= c.end - std::max(c.begin, coveredTo);
+            coveredTo = c.end;
+        }
+        diff.unattributedBytes += static_cast<std::size_t>(uncovered);
+    }
+
+    std::sort(diff.definitions.begin(), diff.definitions.end(),
+              [](const DefinitionDiff & a, const DefinitionDiff & b) { return a.offset < b.offset; });
+    return diff;
+}
+
+TuneDiff diffTune(const Tune & tune)
+{
+    const RomPtr & rom = tune.base();
+    if (!rom->model())
+        throw std::runtime_error("the base ROM does not have a model");
+    if (static_cast<std::size_t>(rom->size()) != tune.size())
+        throw std::runtime_error("the tune and base ROM sizes do not match");
+
+    return attributeDiff(*rom->model(), diffBytes(rom->data(), tune.data(), tune.size()));
+}
+
+} // namespace lt
@@ -0,0 +1,66 @@
+#ifndef LT_DIFF_H
+#define LT_DIFF_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace lt
+{
+
+class Tune;
+struct Model;
+
+// Half-open range of byte offsets [begin, end)
+struct ByteRange
+{
+    int begin;
+    int end;
+
+    inline int size() const noexcept { return end - begin; }
+};
+
+/* Returns the ranges where `a` and `b` differ, in ascending order.
+ * Compares 64 bytes per step with AVX2 or SSE2 when the build enables
+ * them and eight bytes per step otherwise. */
+std::vector<ByteRange> diffBytes(const uint8_t * a, const uint8_t * b, std::size_t size);
+
+// Changes within one table or axis definition
+struct DefinitionDiff
+{
+    std::string id;
+    // True if the definition is a memory axis
+    bool axis{false};
+    // Location of the definition
+    int offset{0};
+    int size{0};
+    // Number of bytes and of entries with at least one changed byte
+    int changedBytes{0};
+    int changedEntries{0};
+};
+
+struct TuneDiff
+{
+    // Changed byte ranges in ascending order
+    std::vector<ByteRange> ranges;
+    // Definitions with changes, ordered by offset
+    std::vector<DefinitionDiff> definitions;
+    std::size_t changedBytes{0};
+    // Changed bytes outside of every definition
+    std::size_t unattributedBytes{0};
+};
+
+/* Attributes changed ranges to the tables and memory axes of `model`
+ * using its definition index. A byte covered by several definitions
+ * counts for each of them. */
+TuneDiff attributeDiff(const Model & model, std::vector<ByteRange> ranges);
+
+/* Compares the tune data with its base ROM and attributes the changes to
+ * the tables and axes of the ROM's model. Throws std::runtime_error if
+ * the sizes differ or the ROM has no model. */
+TuneDiff diffTune(const Tune & tune);
+
+} // namespace lt
+
+#endif // LT_DIFF_H
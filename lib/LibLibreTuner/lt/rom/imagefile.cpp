@@ -0,0 +1,147 @@
+#include "imagefile.h"
+
+#include "../support/endianness.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+
+namespace lt
+{
+
+namespace
+{
+
+constexpr char Magic[4] = {'L', 'T', 'I', 'M'};
+
+template <typename T> T loadLE(const uint8_t * data) noexcept
+{
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return endian::fromLittle(value);
+}
+
+template <typename T> void storeLE(uint8_t * data, T value) noexcept
+{
+    value = endian::toLittle(value);
+    std::memcpy(data, &value, sizeof(T));
+}
+
+} // namespace
+
+std::optional<ImageHeader> readImageHeader(const uint8_t * data, std::size_t fileSize)
+{
+    if (fileSize < sizeof(Magic) || std::memcmp(data, Magic, sizeof(Magic)) != 0)
+        return std::nullopt;
+    if (fileSize < 32)
+        throw std::runtime_error("image header is truncated");
+
+    ImageHeader header;
+    header.fileVersion = loadLE<uint32_t>(data + 4);
+    if (header.fileVersion > ImageHeader::version)
+        throw std::runtime_error("image was written by a newer version");
+    if (fileSize < header.metadataOffset())
+        throw std::runtime_error("image header is truncated");
+
+    header.metadataSize = loadLE<uint64_t>(data + 8);
+    header.dataOffset = loadLE<uint64_t>(data + 16);
+    header.dataSize = loadLE<uint64_t>(data + 24);
+    if (header.fileVersion >= 2 && header.dataOffset == 0)
+        header.blob = BlobId{loadLE<uint64_t>(data + 32), loadLE<uint64_t>(data + 40)};
+
+    // Compare against the remaining size so corrupt values cannot overflow
+    const uint64_t metadataOffset = header.metadataOffset();
+    if (header.metadataSize > fileSize - metadataOffset)
+        throw std::runtime_error("image header does not match the file size");
+    if (!header.blob && (header.dataOffset < metadataOffset + header.metadataSize ||
+                         header.dataOffset > fileSize || header.dataSize > fileSize - header.dataOffset))
+        throw std::runtime_error("image header does not match the file size");
+    return header;
+}
+
+std::optional<ImageHeader> readImageHeader(std::istream & stream, std::size_t fileSize)
+{
+    std::array<uint8_t, ImageHeader::size> bytes{};
+    std::size_t available = std::min(fileSize, bytes.size());
+    if (!stream.read(reinterpret_cast<char *>(bytes.data()), static_cast<std::streamsize>(available)))
+        throw std::runtime_error("failed to read image header");
+
+    std::optional<ImageHeader> header = readImageHeader(bytes.data(), fileSize);
+    stream.seekg(header ? static_cast<std::streamoff>(header->metadataOffset()) : 0);
+    return header;
+}
+
+namespace
+{
+
+// Encodes the header and `metadata`, padded to `header.dataOffset`
+std::string encodeHeader(const ImageHeader & header, const std::string & metadata)
+{
+    std::string prefix(std::max<std::size_t>(header.dataOffset, ImageHeader::size + metadata.size()), '\0');
+    auto * bytes = reinterpret_cast<uint8_t *>(prefix.data());
+    std::memcpy(bytes, Magic, sizeof(Magic));
+    storeLE<uint32_t>(bytes + 4, ImageHeader::version);
+    storeLE<uint64_t>(bytes + 8, header.metadataSize);
+    storeLE<uint64_t>(bytes + 16, header.dataOffset);
+    storeLE<uint64_t>(bytes + 24, header.dataSize);
+    if (header.blob)
+    {
+        storeLE<uint64_t>(bytes + 32, header.blob->low);
+        storeLE<uint64_t>(bytes + 40, header.blob->high);
+    }
+    std::memcpy(bytes + ImageHeader::size, metadata.data(), metadata.size());
+    return prefix;
+}
+
+// Writes `prefix` and `size` bytes of `data` over `path`
+void writeFile(const std::filesystem::path & path, const std::string & prefix, const uint8_t * data,
+               std::size_t size)
+{
+    std::filesystem::path temporary = path;
+    temporary += ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::out | std::ios::trunc);
+        if (!file.is_open())
+            throw std::runtime_error("failed to open '" + temporary.string() + "' for writing");
+        file.write(prefix.data(), static_cast<std::streamsize>(prefix.size()));
+        file.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(size));
+        if (!file.flush())
+            throw std::runtime_error("failed to write '" + temporary.string() + "'");
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(temporary, path, ec);
+    if (ec)
+    {
+        std::filesystem::remove(temporary, ec);
+        throw std::runtime_error("failed to replace '" + path.string() + "'");
+    }
+}
+
+} // namespace
+
+void writeImageFile(const std::filesystem::path & path, const std::string & metadata, const uint8_t * data,
+                    std::size_t size)
+{
+    ImageHeader header;
+    header.metadataSize = metadata.size();
+    header.dataOffset = (ImageHeader::size + metadata.size() + ImageHeader::alignment - 1) /
+                        ImageHeader::alignment * ImageHeader::alignment;
+    header.dataSize = size;
+    writeFile(path, encodeHeader(header, metadata), data, size);
+}
+
+void writeImageFile(const std::filesystem::path & path, const std::string & metadata, const BlobId & blob,
+                    std::size_t size)
+{
+    ImageHeader header;
+    header.metadataSize = metadata.size();
+    header.dataSize = size;
+    header.blob = blob;
+    writeFile(path, encodeHeader(header, metadata), nullptr, 0);
+}
+
+} // namespace lt
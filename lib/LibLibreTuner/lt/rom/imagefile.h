@@ -0,0 +1,75 @@
+#ifndef LT_IMAGEFILE_H
+#define LT_IMAGEFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <optional>
+#include <string>
+
+#include "blobstore.h"
+
+namespace lt
+{
+
+/* ROM and tune files start with this header followed by the cereal
+ * encoded metadata. The raw image starts at the next multiple of
+ * `alignment`, so it can be mapped and used without copying, or is kept
+ * in a BlobStore and referenced by id. Files written before this layout
+ * start directly with the metadata and store the image as a cereal byte
+ * vector.
+ *
+ *   0  magic "LTIM"
+ *   4  uint32 version
+ *   8  uint64 metadata size
+ *  16  uint64 data offset, 0 if the data is in a blob
+ *  24  uint64 data size
+ *  32  uint64 low half of the blob id, 0 if the data is in the file
+ *  40  uint64 high half of the blob id
+ *  48  metadata
+ *
+ * Version 1 files end the header at 32. Integers are little endian. */
+struct ImageHeader
+{
+    static constexpr uint32_t version = 2;
+    // Size of the current header; older headers are shorter
+    static constexpr std::size_t size = 48;
+    // Page size on every supported platform
+    static constexpr std::size_t alignment = 4096;
+
+    // Version of the file
+    uint32_t fileVersion{version};
+    uint64_t metadataSize{0};
+    uint64_t dataOffset{0};
+    uint64_t dataSize{0};
+    // Set if the data is in a blob
+    std::optional<BlobId> blob;
+
+    inline uint64_t metadataOffset() const noexcept { return fileVersion < 2 ? 32 : size; }
+};
+
+/* Parses the header at the start of a file of `fileSize` bytes. `data`
+ * must hold the first min(fileSize, ImageHeader::size) bytes. Returns
+ * std::nullopt if the file does not start with the magic. Throws
+ * std::runtime_error if the header is corrupt or from a newer version. */
+std::optional<ImageHeader> readImageHeader(const uint8_t * data, std::size_t fileSize);
+
+/* Same as above for a stream at the start of the file. Leaves the stream
+ * at the metadata, or back at the start if there is no header. */
+std::optional<ImageHeader> readImageHeader(std::istream & stream, std::size_t fileSize);
+
+/* Writes the header, `metadata`, padding and `size` bytes of `data` to
+ * `path`. The file is written under a temporary name and renamed over
+ * `path`, so existing mappings of the old file stay valid. */
+void writeImageFile(const std::filesystem::path & path, const std::string & metadata, const uint8_t * data,
+                    std::size_t size);
+
+/* Same as above for an image of `size` bytes stored in the blob `blob`.
+ * Only the header and `metadata` are written. */
+void writeImageFile(const std::filesystem::path & path, const std::string & metadata, const BlobId & blob,
+                    std::size_t size);
+
+} // namespace lt
+
+#endif // LT_IMAGEFILE_H
@@ -0,0 +1,172 @@
+#ifndef LT_KERNELS_H
+#define LT_KERNELS_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#include "../support/byteswap.h"
+#include "../support/endianness.h"
+
+namespace lt
+{
+
+/* Conversion between stored and presented values:
+ * presented = stored * gain + offset. Table scale and unit conversion are
+ * folded into one transform when the table is built. */
+struct Affine
+{
+    double gain{1.0};
+    double offset{0.0};
+
+    inline double apply(double stored) const noexcept { return stored * gain + offset; }
+    inline double invert(double presented) const noexcept { return (presented - offset) / gain; }
+
+    // Returns the transform of applying `this`, then `next`
+    inline Affine then(const Affine & next) const noexcept
+    {
+        return Affine{gain * next.gain, offset * next.gain + next.offset};
+    }
+};
+
+/* Whole-range operations on stored table data, instantiated per stored
+ * type `T` and endianness. Presented values are converted with an Affine
+ * transform. Data is processed in blocks: one memcpy and byte swap per
+ * block and a tight conversion loop the compiler can vectorize. Pointers
+ * need no alignment. */
+namespace kernels
+{
+
+// Values converted per block; small enough to stay in L1
+constexpr std::size_t Block = 256;
+
+/* Converts `value` to the stored type `T`. Integers are rounded to the
+ * nearest value and saturate at the limits of `T`; NaN becomes 0. Finite
+ * values beyond the range of a floating-point `T` saturate as well. */
+template <typename T> inline T toStored(double value) noexcept
+{
+    constexpr T lowest = std::numeric_limits<T>::lowest();
+    constexpr T highest = std::numeric_limits<T>::max();
+    if constexpr (std::is_integral_v<T>)
+    {
+        double rounded = std::nearbyint(value);
+        if (std::isnan(rounded))
+            return T{0};
+        if (rounded <= static_cast<double>(lowest))
+            return lowest;
+        // The maximum of 64-bit types rounds up to the next power of two
+        if (rounded >= static_cast<double>(highest))
+            return highest;
+        return static_cast<T>(rounded);
+    }
+    else
+    {
+        if (std::isfinite(value))
+        {
+            if (value < static_cast<double>(lowest))
+                return lowest;
+            if (value > static_cast<double>(highest))
+                return highest;
+        }
+        return static_cast<T>(value);
+    }
+}
+
+template <typename T, Endianness endianness> inline void load(const uint8_t * src, std::size_t count, T * block) noexcept
+{
+    std::memcpy(block, src, count * sizeof(T));
+    if constexpr (endianness != endian::current)
+        endian::swapRange<sizeof(T)>(reinterpret_cast<uint8_t *>(block), count);
+}
+
+template <typename T, Endianness endianness> inline void store(T * block, std::size_t count, uint8_t * dst) noexcept
+{
+    if constexpr (endianness != endian::current)
+        endian::swapRange<sizeof(T)>(reinterpret_cast<uint8_t *>(block), count);
+    std::memcpy(dst, block, count * sizeof(T));
+}
+
+// Converts `count` stored values at `src` to presented values
+template <typename T, Endianness endianness, typename P>
+void decode(const uint8_t * src, std::size_t count, P * out, const Affine & transform) noexcept
+{
+    T block[Block];
+    for (std::size_t done = 0; done < count; done += Block)
+    {
+        std::size_t n = count - done < Block ? count - done : Block;
+        load<T, endianness>(src + done * sizeof(T), n, block);
+        for (std::size_t i = 0; i < n; ++i)
+            out[done + i] = static_cast<P>(static_cast<double>(block[i]) * transform.gain + transform.offset);
+    }
+}
+
+// Converts `count` presented values to stored values at `dst` with toStored()
+template <typename T, Endianness endianness, typename P>
+void encode(const P * in, std::size_t count, uint8_t * dst, const Affine & transform) noexcept
+{
+    T block[Block];
+    for (std::size_t done = 0; done < count; done += Block)
+    {
+        std::size_t n = count - done < Block ? count - done : Block;
+        for (std::size_t i = 0; i < n; ++i)
+            block[i] = toStored<T>(transform.invert(static_cast<double>(in[done + i])));
+        store<T, endianness>(block, n, dst + done * sizeof(T));
+    }
+}
+
+// Sets `count` stored values to the presented value `value` with toStored()
+template <typename T, Endianness endianness, typename P>
+void fill(uint8_t * dst, std::size_t count, P value, const Affine & transform) noexcept
+{
+    T stored = toStored<T>(transform.invert(static_cast<double>(value)));
+    if constexpr (endianness != endian::current)
+        endian::swapRange<sizeof(T)>(reinterpret_cast<uint8_t *>(&stored), 1);
+    for (std::size_t i = 0; i < count; ++i)
+        std::memcpy(dst + i * sizeof(T), &stored, sizeof(T));
+}
+
+/* Applies `presented = presented * factor + delta` to `count` stored
+ * values, rounding like a per-cell get() and set() would. */
+template <typename T, Endianness endianness>
+void scaleOffset(uint8_t * data, std::size_t count, double factor, double delta, const Affine & transform) noexcept
+{
+    T block[Block];
+    for (std::size_t done = 0; done < count; done += Block)
+    {
+        std::size_t n = count - done < Block ? count - done : Block;
+        uint8_t * p = data + done * sizeof(T);
+        load<T, endianness>(p, n, block);
+        for (std::size_t i = 0; i < n; ++i)
+            block[i] = toStored<T>(transform.invert(transform.apply(static_cast<double>(block[i])) * factor + delta));
+        store<T, endianness>(block, n, p);
+    }
+}
+
+/* Compares `count` stored values. Sets mask[i] to 1 if the values
+ * differ and 0 otherwise if `mask` is not null. Returns the number of
+ * differing values. Endianness does not matter for equality. */
+template <typename T>
+std::size_t compare(const uint8_t * a, const uint8_t * b, std::size_t count, uint8_t * mask) noexcept
+{
+    using U = typename endian::detail::UnsignedOf<sizeof(T)>::type;
+    std::size_t differing = 0;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        U x, y;
+        std::memcpy(&x, a + i * sizeof(T), sizeof(T));
+        std::memcpy(&y, b + i * sizeof(T), sizeof(T));
+        uint8_t diff = x != y;
+        differing += diff;
+        if (mask != nullptr)
+            mask[i] = diff;
+    }
+    return differing;
+}
+
+} // namespace kernels
+} // namespace lt
+
+#endif // LT_KERNELS_H
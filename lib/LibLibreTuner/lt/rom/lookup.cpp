@@ -0,0 +1,143 @@
+/*
+ * LibreTuner
+ * Copyright (C) 2018 Altenius
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "lookup.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace lt
+{
+
+AxisBreakpoints::AxisBreakpoints(const Axis * axis, int size)
+{
+    points_.resize(static_cast<std::size_t>(size));
+    for (int i = 0; i < size; ++i)
+        points_[i] = axis != nullptr ? axis->index(i) : static_cast<double>(i);
+
+    reversed_ = size > 1 && points_.front() > points_.back();
+    if (reversed_)
+        std::reverse(points_.begin(), points_.end());
+}
+
+AxisBreakpoints::Segment AxisBreakpoints::find(double value, int & hint) const noexcept
+{
+    int count = size();
+    // NaN fails every comparison below, which would invert the bracket
+    if (count < 2 || std::isnan(value))
+        return Segment{0, 0};
+
+    int lower;
+    double weight;
+    if (value <= points_.front())
+    {
+        lower = 0;
+        weight = 0;
+    }
+    else if (value >= points_.back())
+    {
+        lower = count - 2;
+        weight = 1;
+    }
+    else
+    {
+        // Hunt for a bracket points_[lo] <= value < points_[hi] with
+        // growing steps, then binary search it
+        int lo = std::clamp(hint, 0, count - 2);
+        int hi;
+        if (points_[lo] <= value)
+        {
+            hi = lo + 1;
+            for (int step = 1; points_[hi] <= value; step *= 2)
+            {
+                lo = hi;
+                hi = std::min(hi + step, count - 1);
+            }
+        }
+        else
+        {
+            hi = lo;
+            for (int step = 1; points_[lo] > value; step *= 2)
+            {
+                hi = lo;
+                lo = std::max(lo - step, 0);
+            }
+        }
+
+        auto it = std::upper_bound(points_.begin() + lo + 1, points_.begin() + hi, value);
+        lower = static_cast<int>(it - points_.begin()) - 1;
+        double width = points_[lower + 1] - points_[lower];
+        weight = width > 0 ? (value - points_[lower]) / width : 0;
+    }
+
+    hint = lower;
+    if (reversed_)
+        return Segment{count - 2 - lower, 1.0 - weight};
+    return Segment{lower, weight};
+}
+
+TableLookup::TableLookup(const Table & table) : table_(table)
+{
+    reload();
+}
+
+void TableLookup::reload()
+{
+    width_ = table_.width();
+    values_ = table_.getAll();
+
+    x_ = AxisBreakpoints(table_.xAxis().get(), table_.width());
+    y_ = AxisBreakpoints(table_.yAxis().get(), table_.height());
+    xHint_ = 0;
+    yHint_ = 0;
+}
+
+double TableLookup::lookup(double x, double y) noexcept
+{
+    AxisBreakpoints::Segment column = x_.find(x, xHint_);
+    AxisBreakpoints::Segment row = y_.find(y, yHint_);
+
+    const double * top = &values_[row.lower * width_ + column.lower];
+    double result = top[0];
+    if (x_.size() > 1)
+        result += (top[1] - top[0]) * column.weight;
+    if (y_.size() > 1)
+    {
+        const double * bottom = top + width_;
+        double lower = bottom[0];
+        if (x_.size() > 1)
+            lower += (bottom[1] - bottom[0]) * column.weight;
+        result += (lower - result) * row.weight;
+    }
+    return result;
+}
+
+void TableLookup::lookup(const double * xs, const double * ys, double * out, std::size_t count) noexcept
+{
+    if (ys == nullptr)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+            out[i] = lookup(xs[i]);
+        return;
+    }
+
+    for (std::size_t i = 0; i < count; ++i)
+        out[i] = lookup(xs[i], ys[i]);
+}
+
+} // namespace lt
@@ -0,0 +1,110 @@
+/*
+ * LibreTuner
+ * Copyright (C) 2018 Altenius
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LT_LOOKUP_H
+#define LT_LOOKUP_H
+
+#include <cstddef>
+#include <vector>
+
+#include "table.h"
+
+namespace lt
+{
+
+/* Contiguous copy of an axis' breakpoints for fast searching. Axes may
+ * be ascending or descending. */
+class AxisBreakpoints
+{
+public:
+    // Position of a value between two breakpoints
+    struct Segment
+    {
+        // Index of the lower breakpoint
+        int lower;
+        // Weight of breakpoint `lower + 1`, in [0, 1]
+        double weight;
+
+        // Returns the index of the nearest breakpoint
+        inline int nearest() const noexcept { return weight < 0.5 ? lower : lower + 1; }
+    };
+
+    AxisBreakpoints() = default;
+
+    /* Copies the first `size` breakpoints of `axis`. If `axis` is null,
+     * the breakpoints are the indices 0 to `size - 1`. */
+    AxisBreakpoints(const Axis * axis, int size);
+
+    inline int size() const noexcept { return static_cast<int>(points_.size()); }
+
+    // Returns true if `value` is between the first and last breakpoint. NaN is never contained.
+    inline bool contains(double value) const noexcept
+    {
+        return points_.size() < 2 ? value == value : (value >= points_.front() && value <= points_.back());
+    }
+
+    /* Finds the breakpoints surrounding `value`, clamping to the edges.
+     * NaN gives the first segment with a weight of 0.
+     * `hint` remembers the position of the previous search and is
+     * updated; nearby values are found by hunting outwards from it
+     * before falling back to a binary search. Start with a hint of 0. */
+    Segment find(double value, int & hint) const noexcept;
+
+private:
+    // Sorted ascending
+    std::vector<double> points_;
+    bool reversed_{false};
+};
+
+/* Evaluates a table at physical axis values with bilinear interpolation,
+ * clamping to the edges of the axes like the ECU does. The table values
+ * and breakpoints are copied on construction; call reload() after the
+ * table changes. Remembers the last cell for temporal locality, so each
+ * thread should use its own lookup. */
+class TableLookup
+{
+public:
+    explicit TableLookup(const Table & table);
+
+    // Copies the table values and breakpoints again
+    void reload();
+
+    // Returns the interpolated value at (`x`, `y`). `y` is ignored for
+    // one-dimensional tables.
+    double lookup(double x, double y = 0) noexcept;
+
+    inline double operator()(double x, double y = 0) noexcept { return lookup(x, y); }
+
+    /* Evaluates `count` points into `out`. `ys` may be null for
+     * one-dimensional tables. */
+    void lookup(const double * xs, const double * ys, double * out, std::size_t count) noexcept;
+
+    inline const AxisBreakpoints & xBreakpoints() const noexcept { return x_; }
+    inline const AxisBreakpoints & yBreakpoints() const noexcept { return y_; }
+
+private:
+    const Table & table_;
+    std::vector<double> values_;
+    int width_{0};
+    AxisBreakpoints x_, y_;
+    int xHint_{0}, yHint_{0};
+};
+
+} // namespace lt
+
+#endif // LT_LOOKUP_H
@@ -17,16 +17,23 @@
  */
 
 #include "rom.h"
+#include "diff.h"
+#include "imagefile.h"
 #include "table.h"
 
 #include "definition/platform.h"
+#include "support/checksumkernels.h"
 
 #include <cereal/archives/binary.hpp>
 #include <cereal/types/string.hpp>
 #include <cereal/types/vector.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cstring>
 #include <fstream>
+#include <sstream>
 
 namespace fs = std::filesystem;
 
@@ -41,25 +48,42 @@ EntriesPtr<double> createEntries(Endianness endianness, DataType dataType, const
     case Endianness::Big:
         return create_entries<double, Endianness::Big>(dataType, view);
     case Endianness::Little:
-        return create_entries<double, Endianness::Big>(dataType, view);
+        return create_entries<double, Endianness::Little>(dataType, view);
     default:
         return EntriesPtr<double>();
     }
 }
 } // namespace detail
 
-bool Tune::dirty() const noexcept
+namespace
 {
-    for (const auto & [id, table] : tables_)
+
+template <typename MetaData> std::string encodeMetaData(const MetaData & metadata)
+{
+    std::ostringstream stream;
     {
-        if (table->dirty())
-            return true;
+        cereal::BinaryOutputArchive archive(stream);
+        archive(metadata);
     }
-    return false;
+    return stream.str();
 }
 
+// Returns a writable buffer of the ROM data sharing its unmodified pages
+MemoryBuffer copyOnWrite(const Rom & rom)
+{
+    if (!rom.image() || rom.size() == 0)
+        return MemoryBuffer(rom.cbegin(), rom.cend());
+
+    auto file = std::make_shared<os::MappedFile>(rom.image()->remap(os::MappedFile::Access::CopyOnWrite));
+    uint8_t * data = file->writableData() + rom.imageOffset();
+    return MemoryBuffer(std::move(file), data, rom.size(), true);
+}
+
+} // namespace
+
 void Tune::clearDirty() noexcept
 {
+    data_.clearDirty();
     for (const auto & [id, table] : tables_)
     {
         if (table->dirty())
@@ -67,6 +91,30 @@ void Tune::clearDirty() noexcept
     }
 }
 
+void Tune::correctChecksums(bool verify)
+{
+    const ModelPtr & model = base_->model();
+    PlatformPtr platform = model->platform();
+    if (!platform)
+        throw std::runtime_error("model does not have a valid platform. (did "
+                                 "the reference expire?)");
+
+    // Checksum offsets are relative to the flashed region
+    const int offset = static_cast<int>(platform->flashOffset);
+    if (offset > data_.size())
+        throw std::runtime_error("flash offset exceeds the tune size");
+    const Checksums & checksums = model->checksums;
+    if (!checksums_.tracks(checksums))
+        checksums_.reset(checksums, offset);
+
+    // Patched sections must be saved and flashed like any other edit
+    for (const auto & [first, last] : checksums_.correct())
+        data_.markDirty(first + offset, last - first);
+
+    if (verify && !checksums.verify(data_.data() + offset, data_.size() - offset))
+        throw std::runtime_error("checksum does not equal target after correction");
+}
+
 Table * Tune::getTable(const std::string & id, bool create)
 {
     if (auto it = tables_.find(id); it != tables_.end())
@@ -174,20 +222,184 @@ Tune::MetaData Tune::metadata() const noexcept
     return md;
 }
 
-void Tune::save() const
+void Tune::save()
+{
+    if (path_.empty())
+        throw std::runtime_error("attempt to save ROM without a path");
+
+    waitForCompaction();
+    // The header only changes when the file is rewritten
+    if (log_.end == 0 || fileState_ != FileState::Current || !std::filesystem::exists(path_) ||
+        encodeMetaData(metadata()) != savedMetaData_)
+        compact();
+    else if (data_.isDirty())
+    {
+        std::vector<ByteRange> ranges;
+        for (const auto & [first, last] : data_.dirty())
+            ranges.push_back(ByteRange{first, last});
+        // A file changed by another program is replaced with this tune
+        if (!appendDeltas(path_, fileHeader(), log_, data_.data(), ranges))
+            compact();
+        // Rewriting costs about as much as the deltas themselves
+        else if (log_.end > 2 * compactedSize_ + compactionSlack)
+            compact(true);
+    }
+
+    std::filesystem::path journal = journalPath();
+    if (!journal_.canUndo() && !journal_.canRedo())
+    {
+        // Do not leave history of an older save behind
+        std::error_code ec;
+        std::filesystem::remove(journal, ec);
+        return;
+    }
+
+    // Replace the history in one step so a failed save keeps the old one
+    std::filesystem::path temporary = journal;
+    temporary += ".tmp";
+    {
+        std::ofstream journalFile(temporary, std::ios::binary | std::ios::out | std::ios::trunc);
+        if (!journalFile.is_open())
+            throw std::runtime_error("failed to open journal file '" + temporary.string() + "' for writing");
+
+        {
+            cereal::BinaryOutputArchive journalArchive(journalFile);
+            journalArchive(journal_);
+        }
+        if (!journalFile.flush())
+            throw std::runtime_error("failed to write journal file '" + temporary.string() + "'");
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(temporary, journal, ec);
+    if (ec)
+    {
+        std::filesystem::remove(temporary, ec);
+        throw std::runtime_error("failed to replace journal file '" + journal.string() + "'");
+    }
+}
+
+void Tune::compact(bool background)
 {
     if (path_.empty())
         throw std::runtime_error("attempt to save ROM without a path");
+    waitForCompaction();
 
-    std::ofstream file(path_, std::ios::binary | std::ios::out);
+    // Encoding copies the changed bytes, so edits may continue meanwhile
+    savedMetaData_ = encodeMetaData(metadata());
+    DeltaFile file =
+        encodeDeltaFile(savedMetaData_, fileHeader(), data_.data(), diffBytes(base_->data(), data_.data(), size()));
+    if (!background)
+    {
+        writeDeltaFile(path_, file);
+        log_ = file.log;
+        compactedSize_ = log_.end;
+        fileState_ = FileState::Current;
+        return;
+    }
+
+    compaction_ = std::async(std::launch::async, [path = path_, file = std::move(file)]() {
+        writeDeltaFile(path, file);
+        return file.log;
+    });
+}
+
+void Tune::waitForCompaction()
+{
+    if (!compaction_.valid())
+        return;
+    try
+    {
+        log_ = compaction_.get();
+        compactedSize_ = log_.end;
+    }
+    catch (...)
+    {
+        // The old file is intact; rewrite it on the next save
+        log_ = DeltaLog();
+        throw;
+    }
+}
+
+bool Tune::matchesFile()
+{
+    if (compaction_.valid())
+    {
+        // The file is being replaced by this tune
+        if (compaction_.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            return true;
+        try
+        {
+            waitForCompaction();
+        }
+        catch (const std::exception &)
+        {
+            // The old file is intact and rewritten by the next save
+            return true;
+        }
+    }
+    return log_.end != 0 && verifyDeltaFile(path_, fileHeader(), log_) == log_.end;
+}
+
+DeltaHeader Tune::fileHeader() const
+{
+    DeltaHeader header;
+    header.metadataSize = savedMetaData_.size();
+    header.baseHash = base_->hash();
+    header.baseSize = static_cast<uint64_t>(base_->size());
+    return header;
+}
+
+void Tune::setPath(std::filesystem::path path)
+{
+    // A pending compaction writes the old path
+    if (compaction_.valid())
+        compaction_.wait();
+    compaction_ = std::future<DeltaLog>();
+
+    path_ = std::move(path);
+    log_ = DeltaLog();
+    compactedSize_ = 0;
+}
+
+void Tune::loadDeltas(const uint8_t * file, std::size_t size, const DeltaHeader & header)
+{
+    if (header.baseSize != static_cast<uint64_t>(base_->size()) || header.baseHash != base_->hash())
+        throw std::runtime_error("the tune was saved against different base ROM data");
+
+    savedMetaData_.assign(reinterpret_cast<const char *>(file + header.metadataOffset()),
+                          static_cast<std::size_t>(header.metadataSize));
+    log_ = applyDeltas(file, size, header, data_.data());
+    compactedSize_ = log_.end;
+}
+
+std::filesystem::path Tune::journalPath() const
+{
+    std::filesystem::path path = path_;
+    return path.replace_extension(journalExtension);
+}
+
+bool Tune::loadJournal()
+{
+    std::ifstream file(journalPath(), std::ios::binary | std::ios::in);
     if (!file.is_open())
-        throw std::runtime_error("failed to open tune file '" + path_.string() + "' for writing");
+        return false;
 
-    cereal::BinaryOutputArchive archive(file);
-    archive(metadata(), data_);
+    try
+    {
+        cereal::BinaryInputArchive archive(file);
+        archive(journal_);
+    }
+    catch (const cereal::Exception &)
+    {
+        // Truncated or corrupt history; start without one
+        journal_.clear();
+        return false;
+    }
+    return journal_.canUndo() || journal_.canRedo();
 }
 
-Tune::Tune(RomPtr rom) : Tune(rom, MemoryBuffer(rom->cbegin(), rom->cend())) {}
+Tune::Tune(RomPtr rom) : Tune(rom, copyOnWrite(*rom)) {}
 
 Tune::Tune(RomPtr rom, MemoryBuffer && data) : base_(std::move(rom)), data_(std::move(data))
 {
@@ -198,6 +410,24 @@ Tune::Tune(RomPtr rom, MemoryBuffer && data) : base_(std::move(rom)), data_(std:
                                  " vs " + std::to_string(size()) + "). The tune or base ROM is corrupt.");
 }
 
+uint64_t Rom::hash() const
+{
+    if (!hash_)
+        hash_ = checksum::xxh64(data_.data(), static_cast<std::size_t>(data_.size()));
+    return *hash_;
+}
+
+void Rom::setImage(std::shared_ptr<const os::MappedFile> image, std::size_t offset, int size)
+{
+    if (offset + static_cast<std::size_t>(size) > image->size())
+        throw std::runtime_error("ROM data exceeds the mapped file");
+
+    data_ = MemoryBuffer(image, image->data() + offset, size);
+    image_ = std::move(image);
+    imageOffset_ = offset;
+    hash_.reset();
+}
+
 Rom::MetaData Rom::metadata() const noexcept
 {
     MetaData md;
@@ -217,16 +447,47 @@ void Rom::save() const
     if (path_.empty())
         throw std::runtime_error("attempt to save ROM without a path");
 
-    std::ofstream file(path_, std::ios::binary | std::ios::out);
-    if (!file.is_open())
-        throw std::runtime_error("failed to open ROM file '" + path_.string() + "' for writing");
+    const auto size = static_cast<std::size_t>(data_.size());
+    // The store declines data whose id is taken by another blob
+    std::optional<BlobId> blob;
+    if (blobs_)
+        blob = blobs_->put(data_.data(), size);
+    if (blob)
+        writeImageFile(path_, encodeMetaData(metadata()), *blob, size);
+    else
+        writeImageFile(path_, encodeMetaData(metadata()), data_.data(), size);
+}
 
-    cereal::BinaryOutputArchive archive(file);
-    archive(metadata(), data_);
+bool Rom::matchesFile() const
+{
+    try
+    {
+        os::MappedFile file(path_.string());
+        std::optional<ImageHeader> header = readImageHeader(file.data(), file.size());
+        const auto size = static_cast<std::size_t>(data_.size());
+        if (!header || header->dataSize != size)
+            return false;
+
+        const std::string encoded = encodeMetaData(metadata());
+        if (header->metadataSize != encoded.size() ||
+            std::memcmp(file.data() + header->metadataOffset(), encoded.data(), encoded.size()) != 0)
+            return false;
+
+        // The id alone does not rule out a collision
+        if (header->blob)
+            return blobs_ && *header->blob == blobs_->idOf(data_.data(), size) && blobs_->contains(data_.data(), size);
+        return size == 0 || std::memcmp(file.data() + header->dataOffset, data_.data(), size) == 0;
+    }
+    catch (const std::runtime_error &)
+    {
+        // Missing or unreadable
+        return false;
+    }
 }
 
 } // namespace lt
 
 // Declare cereal versions out of scope
 CEREAL_CLASS_VERSION(lt::Rom::MetaData, 1)
-CEREAL_CLASS_VERSION(lt::Tune::MetaData, 1)
\ No newline at end of file
+CEREAL_CLASS_VERSION(lt::Tune::MetaData, 1)
+CEREAL_CLASS_VERSION(lt::EditJournal, 1)
\ No newline at end of file
@@ -20,19 +20,36 @@
 #define ROM_H
 
 #include <filesystem>
+#include <future>
 #include <memory>
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
 #include "../definition/model.h"
 #include "../definition/platform.h"
+#include "../buffer/journal.h"
 #include "../buffer/memorybuffer.h"
+#include "../os/mappedfile.h"
+#include "blobstore.h"
+#include "deltafile.h"
 #include "table.h"
 
 namespace lt
 {
 
+// State of a loaded ROM or tune relative to its file
+enum class FileState
+{
+    // The file holds what was loaded or last saved
+    Current,
+    // The file was changed by another program
+    Changed,
+    // The file was removed
+    Removed,
+};
+
 class Rom
 {
 public:
@@ -59,19 +76,35 @@ public:
     inline const uint8_t * data() const noexcept { return data_.data(); }
     inline int size() const noexcept { return static_cast<int>(data_.size()); }
 
-    std::vector<uint8_t>::iterator begin() noexcept { return data_.begin(); }
-    std::vector<uint8_t>::iterator end() noexcept { return data_.end(); }
-    std::vector<uint8_t>::const_iterator cbegin() const noexcept
-    {
-        return data_.cbegin();
-    }
-    std::vector<uint8_t>::const_iterator cend() const noexcept
+    MemoryBuffer::const_iterator cbegin() const noexcept { return data_.cbegin(); }
+    MemoryBuffer::const_iterator cend() const noexcept { return data_.cend(); }
+
+    // Sets the ROM data
+    void setData(MemoryBuffer && data)
     {
-        return data_.cend();
+        data_ = std::move(data);
+        image_.reset();
+        imageOffset_ = 0;
+        hash_.reset();
     }
 
-    // Sets the ROM data
-    void setData(MemoryBuffer && data) { data_ = std::move(data); }
+    /* Sets the ROM data to `size` bytes at `offset` of the mapped file
+     * `image` without copying them. The data is read-only. */
+    void setImage(std::shared_ptr<const os::MappedFile> image, std::size_t offset, int size);
+
+    /* Mapped file holding the data, or nullptr if the data is in memory.
+     * The data starts at imageOffset(). */
+    inline const std::shared_ptr<const os::MappedFile> & image() const noexcept { return image_; }
+    inline std::size_t imageOffset() const noexcept { return imageOffset_; }
+
+    // XXH64 of the data, identifying the ROM in tune files
+    uint64_t hash() const;
+
+    /* Sets the store that save() puts the data in. Without one, the data
+     * is saved in the ROM file. */
+    inline void setBlobStore(BlobStorePtr blobs) noexcept { blobs_ = std::move(blobs); }
+    inline const BlobStorePtr & blobStore() const noexcept { return blobs_; }
+
     View view(int offset, int size) { return data_.view(offset, size); }
     View view() { return data_.view(); }
 
@@ -94,9 +127,20 @@ public:
     // Constructs ROM metadata
     MetaData metadata() const noexcept;
 
-    // Saves rom to `path_`
+    /* Saves rom to `path_` in the layout of imagefile.h. If a blob store
+     * is set, the file references the data in the store, unless the store
+     * holds other data under the same id. */
     void save() const;
 
+    /* State of the file as last checked by the project. A changed ROM
+     * must be loaded again to see the new file. */
+    inline FileState fileState() const noexcept { return fileState_; }
+    inline void setFileState(FileState state) noexcept { fileState_ = state; }
+
+    /* Returns true if the file at `path_` holds the metadata and data of
+     * this ROM. Reads the file. */
+    bool matchesFile() const;
+
 private:
     std::string name_;
     ModelPtr model_;
@@ -104,6 +148,12 @@ private:
     std::filesystem::path path_;
 
     MemoryBuffer data_;
+    std::shared_ptr<const os::MappedFile> image_;
+    std::size_t imageOffset_{0};
+    // Computed on first use
+    mutable std::optional<uint64_t> hash_;
+    BlobStorePtr blobs_;
+    FileState fileState_{FileState::Current};
 };
 using RomPtr = std::shared_ptr<Rom>;
 using WeakRomPtr = std::weak_ptr<Rom>;
@@ -117,7 +167,14 @@ public:
     using const_iterator = MemoryBuffer::const_iterator;
 
     static constexpr auto extension = ".ltt";
-
+    // Extension of the edit history saved next to the tune
+    static constexpr auto journalExtension = ".ltj";
+    // Bytes the appended records may exceed twice the compacted file by
+    static constexpr std::size_t compactionSlack = 64 * 1024;
+
+    /* Creates a tune with the data of `rom`. If the ROM data is a mapped
+     * file, the tune maps it copy-on-write: pages are shared with the ROM
+     * until they are written. */
     explicit Tune(RomPtr rom);
     explicit Tune(RomPtr rom, MemoryBuffer && data);
 
@@ -125,15 +182,20 @@ public:
     inline const RomPtr & base() const noexcept { return base_; }
     inline const std::filesystem::path & path() const noexcept { return path_; }
 
-    // Returns true if any table is dirty
-    bool dirty() const noexcept;
+    // Returns true if the data was modified since the last save
+    inline bool dirty() const noexcept { return data_.isDirty(); }
 
-    // Clears dirty bit of all tables
+    // Clears the modified ranges and the dirty bit of all tables
     void clearDirty() noexcept;
 
+    // Byte ranges of the data modified since the last save
+    inline const IntervalSet & modified() const noexcept { return data_.dirty(); }
+
     void setName(const std::string & name) { name_ = name; }
     void setBase(const RomPtr & rom) { base_ = rom; }
-    void setPath(std::filesystem::path path) { path_ = std::move(path); }
+    /* Sets the path of the tune file. The next save rewrites the file
+     * at the new path. */
+    void setPath(std::filesystem::path path);
 
     // Gets table by id. Returns nullptr if the table does not exist
     // If `create` is true and the table has not been initialized, creates
@@ -167,14 +229,62 @@ public:
     /* Constructs tune metadata */
     MetaData metadata() const noexcept;
 
-    // Saves tune to `path_`
-    void save() const;
+    /* Patches the modifiable sections of the tune data so that every
+     * checksum of the model matches. Only ranges modified since the last
+     * correction are summed again. If `verify` is true, every checksum
+     * is recomputed over its whole region afterwards. Throws
+     * std::runtime_error if a checksum cannot be corrected. */
+    void correctChecksums(bool verify = false);
+
+    /* Saves tune to `path_` and the edit history to `journalPath()`.
+     * The tune file stores only the bytes that differ from the base ROM
+     * (see deltafile.h). Ranges modified since the save baseline was
+     * last cleared are appended to the file; the first save after
+     * loading rewrites it. Once the appended records outgrow the last
+     * rewrite, the file is compacted on a worker thread. */
+    void save();
+
+    /* Rewrites the tune file with a single record of the bytes that
+     * differ from the base ROM. If `background` is true, only the file
+     * is written on a worker thread; call waitForCompaction() to get
+     * its errors. */
+    void compact(bool background = false);
+
+    /* Waits for a compaction started in the background. Rethrows its
+     * exception if it failed. */
+    void waitForCompaction();
+
+    /* Applies the records of the delta file `file` of `size` bytes onto
+     * the data, which must still equal the base ROM. Following saves
+     * append to the file. Throws std::runtime_error if the file was
+     * saved against different base data. */
+    void loadDeltas(const uint8_t * file, std::size_t size, const DeltaHeader & header);
+
+    /* State of the file as last checked by the project. The next save
+     * rewrites a file that is not current. */
+    inline FileState fileState() const noexcept { return fileState_; }
+    inline void setFileState(FileState state) noexcept { fileState_ = state; }
+
+    /* Returns true if the file at `path_` is the one this tune last
+     * loaded or wrote. Waits for a finished compaction. */
+    bool matchesFile();
+
+    // Undo/redo history of the tune data
+    inline EditJournal & journal() noexcept { return journal_; }
+
+    // Returns the path of the edit history file
+    std::filesystem::path journalPath() const;
+
+    /* Loads the edit history saved with the tune. Returns false if there
+     * is none or it does not match the tune data. */
+    bool loadJournal();
 
     inline iterator begin() { return data_.begin(); }
     inline const_iterator cbegin() const { return data_.cbegin(); };
     inline iterator end() { return data_.end(); }
-    inline const_iterator cend() { return data_.cend(); }
+    inline const_iterator cend() const { return data_.cend(); }
     inline std::vector<uint8_t>::size_type size() const { return data_.size(); }
+    inline const uint8_t * data() const noexcept { return data_.data(); }
 
 private:
     std::string name_;
@@ -183,10 +293,25 @@ private:
     TableMap tables_;
 
     MemoryBuffer data_;
+    // Both must be declared after `data_`
+    EditJournal journal_{data_};
+    ChecksumTracker checksums_{data_};
 
     std::unordered_map<std::string, AxisPtr> axes_;
 
     std::filesystem::path path_;
+
+    // State of the tune file; an end of 0 means the file must be rewritten
+    DeltaLog log_;
+    // File size after the last rewrite
+    std::size_t compactedSize_{0};
+    // Encoded metadata in the header of the file
+    std::string savedMetaData_;
+    std::future<DeltaLog> compaction_;
+    FileState fileState_{FileState::Current};
+
+    // Header of the tune file as last written
+    DeltaHeader fileHeader() const;
 };
 using TunePtr = std::shared_ptr<Tune>;
 using WeakTunePtr = std::weak_ptr<Tune>;
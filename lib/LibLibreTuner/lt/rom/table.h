@@ -1,13 +1,18 @@
 #ifndef LIBRETUNER_TABLE_H
 #define LIBRETUNER_TABLE_H
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <limits>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "../buffer/view.h"
 #include "../support/types.h"
 #include "../support/util.hpp"
+#include "kernels.h"
 #include "unit.h"
 
 namespace lt
@@ -22,6 +27,64 @@ public:
     virtual void set(int index, PresentedType value) = 0;
     virtual int size() const noexcept = 0;
 
+    /* Whole-range operations on entries [first, first + count). Values
+     * are converted to and from presented values with `transform`.
+     * EntriesImpl runs each call as a single typed kernel; the defaults
+     * here go through get() and set(). */
+
+    // Reads entries into `out`
+    virtual void decodeRange(int first, int count, PresentedType * out, const Affine & transform = Affine{}) const
+    {
+        for (int i = 0; i < count; ++i)
+            out[i] = static_cast<PresentedType>(transform.apply(get(first + i)));
+    }
+
+    // Writes entries from `in`
+    virtual void encodeRange(int first, int count, const PresentedType * in, const Affine & transform = Affine{})
+    {
+        for (int i = 0; i < count; ++i)
+            set(first + i, static_cast<PresentedType>(transform.invert(in[i])));
+    }
+
+    // Sets entries to `value`
+    virtual void fillRange(int first, int count, PresentedType value, const Affine & transform = Affine{})
+    {
+        for (int i = 0; i < count; ++i)
+            set(first + i, static_cast<PresentedType>(transform.invert(value)));
+    }
+
+    // Sets entries to `value * factor + delta`
+    virtual void scaleOffsetRange(int first, int count, double factor, double delta,
+                                  const Affine & transform = Affine{})
+    {
+        for (int i = 0; i < count; ++i)
+            set(first + i, static_cast<PresentedType>(
+                               transform.invert(transform.apply(get(first + i)) * factor + delta)));
+    }
+
+    // Copies entries from the same range of `source`
+    virtual void copyRange(const Entries & source, int first, int count)
+    {
+        for (int i = 0; i < count; ++i)
+            set(first + i, source.get(first + i));
+    }
+
+    /* Compares entries with the same range of `other`. If `mask` is not
+     * null, sets mask[i] to 1 where entry `first + i` differs and 0
+     * otherwise. Returns the number of differing entries. */
+    virtual std::size_t compareRange(const Entries & other, int first, int count, uint8_t * mask = nullptr) const
+    {
+        std::size_t differing = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            bool diff = get(first + i) != other.get(first + i);
+            differing += diff;
+            if (mask != nullptr)
+                mask[i] = diff;
+        }
+        return differing;
+    }
+
     virtual ~Entries() = default;
 };
 
@@ -31,17 +94,86 @@ template <typename T> using EntriesPtr = std::unique_ptr<Entries<T>>;
 template <typename PresentedType, typename T, Endianness endianness> struct EntriesImpl : public Entries<PresentedType>
 {
 public:
+    using Base = Entries<PresentedType>;
+
     EntriesImpl(View view) : view_(std::move(view)) {}
 
     PresentedType get(int index) const override
     {
         return static_cast<PresentedType>(view_.get<T, endianness>(index * sizeof(T)));
     }
-    void set(int index, PresentedType value) { view_.set<T, endianness>(static_cast<T>(value), index * sizeof(T)); }
+    // Rounds and saturates like the range kernels
+    void set(int index, PresentedType value)
+    {
+        view_.set<T, endianness>(kernels::toStored<T>(static_cast<double>(value)), index * sizeof(T));
+    }
     int size() const noexcept { return view_.size() / sizeof(T); }
 
+    void decodeRange(int first, int count, PresentedType * out, const Affine & transform = Affine{}) const override
+    {
+        checkRange(first, count);
+        kernels::decode<T, endianness>(bytes(first), static_cast<std::size_t>(count), out, transform);
+    }
+
+    void encodeRange(int first, int count, const PresentedType * in, const Affine & transform = Affine{}) override
+    {
+        checkRange(first, count);
+        kernels::encode<T, endianness>(in, static_cast<std::size_t>(count), writeBytes(first, count), transform);
+    }
+
+    void fillRange(int first, int count, PresentedType value, const Affine & transform = Affine{}) override
+    {
+        checkRange(first, count);
+        kernels::fill<T, endianness>(writeBytes(first, count), static_cast<std::size_t>(count), value, transform);
+    }
+
+    void scaleOffsetRange(int first, int count, double factor, double delta,
+                          const Affine & transform = Affine{}) override
+    {
+        checkRange(first, count);
+        kernels::scaleOffset<T, endianness>(writeBytes(first, count), static_cast<std::size_t>(count), factor, delta,
+                                            transform);
+    }
+
+    void copyRange(const Base & source, int first, int count) override
+    {
+        auto * same = dynamic_cast<const EntriesImpl *>(&source);
+        if (same == nullptr)
+        {
+            Base::copyRange(source, first, count);
+            return;
+        }
+        checkRange(first, count);
+        same->checkRange(first, count);
+        std::memmove(writeBytes(first, count), same->bytes(first), static_cast<std::size_t>(count) * sizeof(T));
+    }
+
+    std::size_t compareRange(const Base & other, int first, int count, uint8_t * mask = nullptr) const override
+    {
+        auto * same = dynamic_cast<const EntriesImpl *>(&other);
+        if (same == nullptr)
+            return Base::compareRange(other, first, count, mask);
+        checkRange(first, count);
+        same->checkRange(first, count);
+        return kernels::compare<T>(bytes(first), same->bytes(first), static_cast<std::size_t>(count), mask);
+    }
+
 private:
     View view_;
+
+    inline void checkRange(int first, int count) const
+    {
+        if (first < 0 || count < 0 || first + count > size())
+            throw std::runtime_error("entries range out of bounds");
+    }
+
+    inline const uint8_t * bytes(int index) const noexcept { return view_.bytes() + index * sizeof(T); }
+
+    // Returns a pointer for writing `count` entries at `index`
+    inline uint8_t * writeBytes(int index, int count)
+    {
+        return view_.writeBytes(index * static_cast<int>(sizeof(T)), count * static_cast<int>(sizeof(T)));
+    }
 };
 
 template <typename PresentedType, Endianness endianness>
@@ -169,6 +301,47 @@ template <typename T> struct Bounds
     bool within(T t) const noexcept { return t >= minimum && t <= maximum; }
 };
 
+// Rectangular block of cells
+struct CellRange
+{
+    int row;
+    int column;
+    int rows;
+    int columns;
+
+    inline int size() const noexcept { return rows * columns; }
+};
+
+// Operations BasicTable::edit() applies to a range of cells
+enum class RangeOperation
+{
+    // Sets cells to the argument
+    Set,
+    // Adds the argument to cells
+    Add,
+    // Multiplies cells by the argument
+    Multiply,
+    // Changes cells by the argument in percent
+    Percent,
+    // Interpolates cells between the corners of the range
+    Interpolate,
+    // Averages each cell with its neighbors in the range
+    Smooth,
+};
+
+/* Record of an edit to a range of cells. Holds the stored (not
+ * presented) values before and after the edit in row-major order. Undo
+ * goes through the tune's EditJournal. */
+template <typename PresentedType> struct TableEdit
+{
+    CellRange range;
+    std::vector<PresentedType> before;
+    std::vector<PresentedType> after;
+
+    // Returns true if the edit changed any cell
+    inline bool changed() const noexcept { return before != after; }
+};
+
 template <typename PresentedType> class BasicTable
 {
 public:
@@ -192,10 +365,7 @@ public:
      * exception if the point is out-of-bounds. Handles scale and unit conversion. */
     PresentedType get(int row, int column) const
     {
-        PresentedType entry = static_cast<PresentedType>(entries_->get(index(row, column)) * scale_);
-        if (!unit_)
-            return entry;
-        return unit_->convert(entry);
+        return static_cast<PresentedType>(transform_.apply(entries_->get(index(row, column))));
     }
 
     /* Returns the entry at position (`row`, `column`) of base entries. Throws an
@@ -204,10 +374,108 @@ public:
     {
         if (!baseEntries_)
             return PresentedType{};
-        PresentedType entry = static_cast<PresentedType>(baseEntries_->get(index(row, column)) * scale_);
-        if (!unit_)
-            return entry;
-        return unit_->convert(entry);
+        return static_cast<PresentedType>(transform_.apply(baseEntries_->get(index(row, column))));
+    }
+
+    /* Reads all entries in row-major order into `out`, which must hold
+     * width() * height() values. Handles scale and unit conversion. */
+    void getAll(PresentedType * out) const { entries_->decodeRange(0, size(), out, transform_); }
+
+    std::vector<PresentedType> getAll() const
+    {
+        std::vector<PresentedType> values(static_cast<std::size_t>(size()));
+        getAll(values.data());
+        return values;
+    }
+
+    /* Reads all base entries in row-major order into `out`. Returns false
+     * if there are no base entries. */
+    bool getAllBase(PresentedType * out) const
+    {
+        if (!baseEntries_)
+            return false;
+        baseEntries_->decodeRange(0, size(), out, transform_);
+        return true;
+    }
+
+    /* Sets all entries from the row-major values in `values`, which must
+     * hold width() * height() values. Handles scale and unit conversion. */
+    void setAll(const PresentedType * values)
+    {
+        entries_->encodeRange(0, size(), values, transform_);
+        dirty_ = true;
+    }
+
+    // Sets every entry to `value`
+    void fill(PresentedType value)
+    {
+        entries_->fillRange(0, size(), value, transform_);
+        dirty_ = true;
+    }
+
+    // Adds `delta` to every entry
+    void add(double delta)
+    {
+        entries_->scaleOffsetRange(0, size(), 1.0, delta, transform_);
+        dirty_ = true;
+    }
+
+    // Multiplies every entry by `factor`
+    void multiply(double factor)
+    {
+        entries_->scaleOffsetRange(0, size(), factor, 0.0, transform_);
+        dirty_ = true;
+    }
+
+    /* Resets all entries to the base entries if they exist. Returns true
+     * if the table was reset. */
+    bool resetAll()
+    {
+        if (!baseEntries_)
+            return false;
+        entries_->copyRange(*baseEntries_, 0, size());
+        dirty_ = true;
+        return true;
+    }
+
+    /* Returns the number of entries that differ from the base entries,
+     * or 0 if there are none. If `mask` is not null, it must hold
+     * width() * height() bytes and is set to 1 for each differing entry. */
+    std::size_t compareBase(uint8_t * mask = nullptr) const
+    {
+        if (!baseEntries_)
+            return 0;
+        return entries_->compareRange(*baseEntries_, 0, size(), mask);
+    }
+
+    /* Applies `operation` with `argument` to the cells in `range` in one
+     * pass over the decoded values and clamps the results to the table
+     * bounds. Returns the record of the edit. Throws an exception if the range
+     * is out-of-bounds. */
+    TableEdit<PresentedType> edit(const CellRange & range, RangeOperation operation, double argument = 0.0)
+    {
+        checkRange(range);
+
+        TableEdit<PresentedType> record{range, std::vector<PresentedType>(range.size()), {}};
+        readRange(range, record.before.data(), Affine{});
+
+        std::vector<PresentedType> values(record.before.size());
+        for (std::size_t i = 0; i < values.size(); ++i)
+            values[i] = static_cast<PresentedType>(transform_.apply(record.before[i]));
+
+        applyOperation(range, operation, argument, values);
+
+        if (bounds_.minimum <= bounds_.maximum)
+        {
+            for (PresentedType & value : values)
+                value = std::clamp(value, bounds_.minimum, bounds_.maximum);
+        }
+
+        writeRange(range, values.data(), transform_);
+        record.after.resize(record.before.size());
+        readRange(range, record.after.data(), Affine{});
+        dirty_ = true;
+        return record;
     }
 
     /* Resets cell to base cell if one exists. Returns true if cell was reset. */
@@ -225,10 +493,7 @@ public:
      * an exception if the point is out-of-bounds. Handles scale and unit conversion. */
     void set(int row, int column, PresentedType value)
     {
-        double entry = value / scale_;
-        if (unit_)
-            entry = unit_->convert(entry);
-        entries_->set(index(row, column), static_cast<PresentedType>(entry));
+        entries_->set(index(row, column), static_cast<PresentedType>(transform_.invert(value)));
         dirty_ = true;
     }
 
@@ -242,6 +507,11 @@ public:
     inline PresentedType minimum() const noexcept { return bounds_.minimum; }
     inline PresentedType maximum() const noexcept { return bounds_.maximum; }
     inline UnitGroup * unit() const noexcept { return unit_.get(); }
+    inline int size() const noexcept { return width_ * height_; }
+
+    /* Returns the conversion from stored to presented values: the table
+     * scale followed by the unit conversion. */
+    inline const Affine & transform() const noexcept { return transform_; }
 
     /* Returns true if the dirty bit is set. Thit bit is set
      * every time set() is called. */
@@ -272,6 +542,112 @@ private:
     double scale_;
     bool dirty_{false};
     std::unique_ptr<UnitGroup> unit_;
+    Affine transform_;
+
+    inline void checkRange(const CellRange & range) const
+    {
+        if (range.row < 0 || range.column < 0 || range.rows < 0 || range.columns < 0 ||
+            range.row + range.rows > height_ || range.column + range.columns > width_)
+            throw std::runtime_error("cell range (" + std::to_string(range.row) + ", " +
+                                     std::to_string(range.column) + ") + (" + std::to_string(range.rows) + ", " +
+                                     std::to_string(range.columns) + ") out of bounds.");
+    }
+
+    // Reads the cells of `range` row by row
+    void readRange(const CellRange & range, PresentedType * out, const Affine & transform) const
+    {
+        for (int row = 0; row < range.rows; ++row)
+            entries_->decodeRange((range.row + row) * width_ + range.column, range.columns,
+                                  out + row * range.columns, transform);
+    }
+
+    void writeRange(const CellRange & range, const PresentedType * in, const Affine & transform)
+    {
+        for (int row = 0; row < range.rows; ++row)
+            entries_->encodeRange((range.row + row) * width_ + range.column, range.columns,
+                                  in + row * range.columns, transform);
+    }
+
+    // Returns the position of `index` on `axis` relative to `first` and `last`
+    static double position(const AxisTypePtr & axis, int index, int first, int last) noexcept
+    {
+        if (first == last)
+            return 0.0;
+        if (axis)
+        {
+            double from = axis->index(first), to = axis->index(last);
+            if (from != to)
+                return (axis->index(index) - from) / (to - from);
+        }
+        return static_cast<double>(index - first) / (last - first);
+    }
+
+    // Applies `operation` to the presented values of `range`
+    void applyOperation(const CellRange & range, RangeOperation operation, double argument,
+                        std::vector<PresentedType> & values) const
+    {
+        switch (operation)
+        {
+        case RangeOperation::Set:
+            std::fill(values.begin(), values.end(), static_cast<PresentedType>(argument));
+            break;
+        case RangeOperation::Add:
+            for (PresentedType & value : values)
+                value = static_cast<PresentedType>(value + argument);
+            break;
+        case RangeOperation::Percent:
+            argument = 1.0 + argument / 100.0;
+            [[fallthrough]];
+        case RangeOperation::Multiply:
+            for (PresentedType & value : values)
+                value = static_cast<PresentedType>(value * argument);
+            break;
+        case RangeOperation::Interpolate:
+        {
+            if (values.empty())
+                break;
+            int last = range.size() - 1;
+            double topLeft = values[0], topRight = values[range.columns - 1];
+            double bottomLeft = values[last - (range.columns - 1)], bottomRight = values[last];
+            int lastRow = range.row + range.rows - 1, lastColumn = range.column + range.columns - 1;
+            for (int row = 0; row < range.rows; ++row)
+            {
+                double y = position(yAxis_, range.row + row, range.row, lastRow);
+                double left = topLeft + (bottomLeft - topLeft) * y;
+                double right = topRight + (bottomRight - topRight) * y;
+                for (int column = 0; column < range.columns; ++column)
+                {
+                    double x = position(xAxis_, range.column + column, range.column, lastColumn);
+                    values[row * range.columns + column] = static_cast<PresentedType>(left + (right - left) * x);
+                }
+            }
+            break;
+        }
+        case RangeOperation::Smooth:
+        {
+            // 3x3 mean, limited to cells inside the range
+            std::vector<PresentedType> source(values);
+            for (int row = 0; row < range.rows; ++row)
+            {
+                for (int column = 0; column < range.columns; ++column)
+                {
+                    double sum = 0;
+                    int count = 0;
+                    for (int r = std::max(row - 1, 0); r <= std::min(row + 1, range.rows - 1); ++r)
+                    {
+                        for (int c = std::max(column - 1, 0); c <= std::min(column + 1, range.columns - 1); ++c)
+                        {
+                            sum += source[r * range.columns + c];
+                            ++count;
+                        }
+                    }
+                    values[row * range.columns + column] = static_cast<PresentedType>(sum / count);
+                }
+            }
+            break;
+        }
+        }
+    }
 
     BasicTable(std::string name, std::string description, Bounds<PresentedType> bounds,
                EntriesPtr<PresentedType> && entries, EntriesPtr<PresentedType> && baseEntries, int width, int height,
@@ -281,6 +657,14 @@ private:
           xAxis_(std::move(xAxis)), yAxis_(std::move(yAxis)), scale_(scale), unit_(std::move(unit))
     {
         assert(entries_);
+
+        // Unit conversions are affine, so two samples determine them
+        transform_ = Affine{scale_, 0.0};
+        if (unit_)
+        {
+            double offset = unit_->convert(0.0);
+            transform_ = transform_.then(Affine{unit_->convert(1.0) - offset, offset});
+        }
     }
 
 public:
@@ -373,7 +757,8 @@ public:
         AxisTypePtr yAxis_;
         std::string name_;
         std::string description_;
-        Bounds<PresentedType> bounds_;
+        Bounds<PresentedType> bounds_{std::numeric_limits<PresentedType>::lowest(),
+                                      std::numeric_limits<PresentedType>::max()};
         EntriesPtr<PresentedType> entries_;
         EntriesPtr<PresentedType> baseEntries_;
         std::unique_ptr<UnitGroup> unit_;
@@ -0,0 +1,84 @@
+#ifndef LT_BYTESWAP_H
+#define LT_BYTESWAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "endianness.h"
+
+#if defined(_MSC_VER)
+#include <stdlib.h>
+#endif
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+namespace lt
+{
+namespace endian
+{
+
+namespace detail
+{
+template <std::size_t Size> struct UnsignedOf;
+template <> struct UnsignedOf<1> { using type = uint8_t; };
+template <> struct UnsignedOf<2> { using type = uint16_t; };
+template <> struct UnsignedOf<4> { using type = uint32_t; };
+template <> struct UnsignedOf<8> { using type = uint64_t; };
+
+inline uint8_t bswap(uint8_t v) noexcept { return v; }
+#if defined(_MSC_VER)
+inline uint16_t bswap(uint16_t v) noexcept { return _byteswap_ushort(v); }
+inline uint32_t bswap(uint32_t v) noexcept { return _byteswap_ulong(v); }
+inline uint64_t bswap(uint64_t v) noexcept { return _byteswap_uint64(v); }
+#else
+inline uint16_t bswap(uint16_t v) noexcept { return __builtin_bswap16(v); }
+inline uint32_t bswap(uint32_t v) noexcept { return __builtin_bswap32(v); }
+inline uint64_t bswap(uint64_t v) noexcept { return __builtin_bswap64(v); }
+#endif
+
+#if defined(__SSSE3__)
+// Shuffle masks reversing every 2, 4 or 8 byte lane of a 128-bit vector
+template <std::size_t Size> inline __m128i swapMask() noexcept
+{
+    alignas(16) uint8_t mask[16];
+    for (std::size_t i = 0; i < 16; ++i)
+        mask[i] = static_cast<uint8_t>((i / Size) * Size + (Size - 1 - i % Size));
+    return _mm_load_si128(reinterpret_cast<const __m128i *>(mask));
+}
+#endif
+} // namespace detail
+
+/* Reverses the bytes of `count` elements of `Size` bytes in place. Uses
+ * SSSE3 shuffles when available; the scalar loop is usually vectorized
+ * by the compiler otherwise. */
+template <std::size_t Size> void swapRange(uint8_t * data, std::size_t count) noexcept
+{
+    using U = typename detail::UnsignedOf<Size>::type;
+    if constexpr (Size == 1)
+        return;
+
+    std::size_t i = 0;
+#if defined(__SSSE3__)
+    const __m128i mask = detail::swapMask<Size>();
+    constexpr std::size_t perVector = 16 / Size;
+    for (; i + perVector <= count; i += perVector)
+    {
+        auto * p = reinterpret_cast<__m128i *>(data + i * Size);
+        _mm_storeu_si128(p, _mm_shuffle_epi8(_mm_loadu_si128(p), mask));
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        U v;
+        std::memcpy(&v, data + i * Size, Size);
+        v = detail::bswap(v);
+        std::memcpy(data + i * Size, &v, Size);
+    }
+}
+
+} // namespace endian
+} // namespace lt
+
+#endif // LT_BYTESWAP_H
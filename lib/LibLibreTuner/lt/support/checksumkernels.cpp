@@ -0,0 +1,419 @@
+#include "checksumkernels.h"
+
+#include <array>
+#include <cstring>
+
+#include "endianness.h"
+
+/* GCC and Clang build the AVX2 kernel for any x86 target and only call
+ * it if the CPU supports it. Other compilers need AVX2 enabled. */
+#if defined(__AVX2__)
+#define LT_AVX2_KERNELS
+#define LT_TARGET_AVX2
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define LT_AVX2_KERNELS
+#define LT_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#if defined(LT_AVX2_KERNELS) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace lt
+{
+namespace checksum
+{
+
+namespace
+{
+
+template <typename T> inline T loadBE(const uint8_t * data) noexcept
+{
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return endian::convert<T, Endianness::Big, endian::current>(value);
+}
+
+#if defined(LT_AVX2_KERNELS)
+LT_TARGET_AVX2 inline uint32_t horizontalSum32(__m256i v) noexcept
+{
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(sum));
+}
+
+// Sums the leading multiple of 16 words; returns how many were summed
+LT_TARGET_AVX2 uint32_t sum32BEAVX2(const uint8_t * data, std::size_t words, std::size_t & summed) noexcept
+{
+    const __m256i mask = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6, 5,
+                                          4, 11, 10, 9, 8, 15, 14, 13, 12);
+    // Two accumulators hide the latency of the adds
+    __m256i a = _mm256_setzero_si256();
+    __m256i b = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + 16 <= words; i += 16)
+    {
+        auto * p = reinterpret_cast<const __m256i *>(data + i * 4);
+        a = _mm256_add_epi32(a, _mm256_shuffle_epi8(_mm256_loadu_si256(p), mask));
+        b = _mm256_add_epi32(b, _mm256_shuffle_epi8(_mm256_loadu_si256(p + 1), mask));
+    }
+    summed = i;
+    return horizontalSum32(_mm256_add_epi32(a, b));
+}
+#endif
+
+#if defined(__SSE2__)
+// Reverses the bytes of every 32-bit lane
+inline __m128i swap32(__m128i v) noexcept
+{
+    v = _mm_or_si128(_mm_slli_epi32(v, 16), _mm_srli_epi32(v, 16));
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+inline uint32_t horizontalSum32(__m128i sum) noexcept
+{
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(sum));
+}
+
+// Sums the leading multiple of 8 words; returns how many were summed
+uint32_t sum32BESSE2(const uint8_t * data, std::size_t words, std::size_t & summed) noexcept
+{
+    __m128i a = _mm_setzero_si128();
+    __m128i b = _mm_setzero_si128();
+    std::size_t i = 0;
+    for (; i + 8 <= words; i += 8)
+    {
+        auto * p = reinterpret_cast<const __m128i *>(data + i * 4);
+        a = _mm_add_epi32(a, swap32(_mm_loadu_si128(p)));
+        b = _mm_add_epi32(b, swap32(_mm_loadu_si128(p + 1)));
+    }
+    summed = i;
+    return horizontalSum32(_mm_add_epi32(a, b));
+}
+#endif
+
+/* Polynomials over GF(2) modulo a CRC polynomial of `width` bits. Bit i
+ * holds the coefficient of x^i; the x^width term of `poly` is implied. */
+uint32_t multiply(uint32_t a, uint32_t b, uint32_t poly, int width) noexcept
+{
+    const uint32_t top = 1u << (width - 1);
+    const uint32_t mask = top | (top - 1);
+    uint32_t result = 0;
+    for (int i = width - 1; i >= 0; --i)
+    {
+        bool carry = (result & top) != 0;
+        result = (result << 1) & mask;
+        if (carry)
+            result ^= poly;
+        if ((b >> i) & 1)
+            result ^= a;
+    }
+    return result;
+}
+
+uint32_t power(uint32_t base, uint64_t exponent, uint32_t poly, int width) noexcept
+{
+    uint32_t result = 1;
+    while (exponent != 0)
+    {
+        if (exponent & 1)
+            result = multiply(result, base, poly, width);
+        base = multiply(base, base, poly, width);
+        exponent >>= 1;
+    }
+    return result;
+}
+
+/* Inverse of x. The polynomial has a constant term, so
+ * x * (poly - 1) / x = poly - 1 = 1 (mod poly). */
+constexpr uint32_t inverseX(uint32_t poly, int width) noexcept
+{
+    return (poly >> 1) | (1u << (width - 1));
+}
+
+uint32_t reverse32(uint32_t v) noexcept
+{
+    v = ((v >> 1) & 0x55555555u) | ((v & 0x55555555u) << 1);
+    v = ((v >> 2) & 0x33333333u) | ((v & 0x33333333u) << 2);
+    v = ((v >> 4) & 0x0F0F0F0Fu) | ((v & 0x0F0F0F0Fu) << 4);
+    v = ((v >> 8) & 0x00FF00FFu) | ((v & 0x00FF00FFu) << 8);
+    return (v >> 16) | (v << 16);
+}
+
+// CRC-32 is computed bit reflected; this is its normal form polynomial
+constexpr uint32_t Crc32Poly = 0x04C11DB7u;
+constexpr uint32_t Crc16Poly = 0x1021u;
+
+using Crc32Tables = std::array<std::array<uint32_t, 256>, 8>;
+
+const Crc32Tables & crc32Tables() noexcept
+{
+    static const Crc32Tables tables = [] {
+        Crc32Tables t{};
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[0][i] = c;
+        }
+        // t[s][i] is the register after byte i followed by s zero bytes
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            for (std::size_t s = 1; s < t.size(); ++s)
+                t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xFF];
+        }
+        return t;
+    }();
+    return tables;
+}
+
+const std::array<uint16_t, 256> & crc16Table() noexcept
+{
+    static const auto table = [] {
+        std::array<uint16_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t c = i << 8;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 0x8000) ? (c << 1) ^ Crc16Poly : c << 1;
+            t[i] = static_cast<uint16_t>(c);
+        }
+        return t;
+    }();
+    return table;
+}
+
+constexpr uint64_t XxPrime1 = 0x9E3779B185EBCA87ull;
+constexpr uint64_t XxPrime2 = 0xC2B2AE3D27D4EB4Full;
+constexpr uint64_t XxPrime3 = 0x165667B19E3779F9ull;
+constexpr uint64_t XxPrime4 = 0x85EBCA77C2B2AE63ull;
+constexpr uint64_t XxPrime5 = 0x27D4EB2F165667C5ull;
+
+template <typename T> inline T loadLE(const uint8_t * data) noexcept
+{
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return endian::convert<T, Endianness::Little, endian::current>(value);
+}
+
+inline uint64_t rotl64(uint64_t v, int r) noexcept { return (v << r) | (v >> (64 - r)); }
+
+inline uint64_t xxRound(uint64_t acc, uint64_t input) noexcept
+{
+    return rotl64(acc + input * XxPrime2, 31) * XxPrime1;
+}
+
+inline uint64_t xxMerge(uint64_t acc, uint64_t lane) noexcept
+{
+    return (acc ^ xxRound(0, lane)) * XxPrime1 + XxPrime4;
+}
+
+} // namespace
+
+uint32_t sum32BEScalar(const uint8_t * data, std::size_t words) noexcept
+{
+    uint32_t sum = 0;
+    for (std::size_t i = 0; i < words; ++i)
+        sum += loadBE<uint32_t>(data + i * 4);
+    return sum;
+}
+
+Isa supportedIsa() noexcept
+{
+    static const Isa isa = [] {
+#if defined(LT_AVX2_KERNELS) && !defined(__AVX2__)
+        if (__builtin_cpu_supports("avx2"))
+            return Isa::AVX2;
+#elif defined(LT_AVX2_KERNELS)
+        return Isa::AVX2;
+#endif
+#if defined(__SSE2__)
+        return Isa::SSE2;
+#else
+        return Isa::Scalar;
+#endif
+    }();
+    return isa;
+}
+
+uint32_t sum32BE(const uint8_t * data, std::size_t words) noexcept
+{
+    return sum32BE(data, words, supportedIsa());
+}
+
+uint32_t sum32BE(const uint8_t * data, std::size_t words, Isa isa) noexcept
+{
+    std::size_t i = 0;
+    uint32_t sum = 0;
+    switch (isa)
+    {
+#if defined(LT_AVX2_KERNELS)
+    case Isa::AVX2:
+        sum = sum32BEAVX2(data, words, i);
+        break;
+#endif
+#if defined(__SSE2__)
+    case Isa::SSE2:
+        sum = sum32BESSE2(data, words, i);
+        break;
+#endif
+    default:
+        break;
+    }
+    return sum + sum32BEScalar(data + i * 4, words - i);
+}
+
+uint16_t sum16BE(const uint8_t * data, std::size_t words) noexcept
+{
+    std::size_t i = 0;
+    uint16_t sum = 0;
+#if defined(__AVX2__) || defined(__SSE2__)
+    // 16-bit lanes wrap like the result does
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 8 <= words; i += 8)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i * 2));
+        acc = _mm_add_epi16(acc, _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)));
+    }
+    alignas(16) uint16_t lanes[8];
+    _mm_store_si128(reinterpret_cast<__m128i *>(lanes), acc);
+    for (uint16_t lane : lanes)
+        sum = static_cast<uint16_t>(sum + lane);
+#endif
+    for (; i < words; ++i)
+        sum = static_cast<uint16_t>(sum + loadBE<uint16_t>(data + i * 2));
+    return sum;
+}
+
+uint32_t xor32BE(const uint8_t * data, std::size_t words) noexcept
+{
+    // XOR commutes with the byte swap; swap once at the end
+    uint64_t wide = 0;
+    std::size_t i = 0;
+    for (; i + 2 <= words; i += 2)
+    {
+        uint64_t v;
+        std::memcpy(&v, data + i * 4, sizeof(v));
+        wide ^= v;
+    }
+    uint32_t native = static_cast<uint32_t>(wide) ^ static_cast<uint32_t>(wide >> 32);
+    if (i < words)
+    {
+        uint32_t v;
+        std::memcpy(&v, data + i * 4, sizeof(v));
+        native ^= v;
+    }
+    return endian::convert<uint32_t, Endianness::Big, endian::current>(native);
+}
+
+uint32_t crc32Raw(uint32_t crc, const uint8_t * data, std::size_t size) noexcept
+{
+    const Crc32Tables & t = crc32Tables();
+    for (; size >= 8; size -= 8, data += 8)
+    {
+        uint32_t lo = crc ^ (static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1]) << 8 |
+                             static_cast<uint32_t>(data[2]) << 16 | static_cast<uint32_t>(data[3]) << 24);
+        uint32_t hi = static_cast<uint32_t>(data[4]) | static_cast<uint32_t>(data[5]) << 8 |
+                      static_cast<uint32_t>(data[6]) << 16 | static_cast<uint32_t>(data[7]) << 24;
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+              t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+    }
+    for (; size > 0; --size, ++data)
+        crc = t[0][(crc ^ *data) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+uint32_t crc32(const uint8_t * data, std::size_t size, uint32_t crc) noexcept
+{
+    return ~crc32Raw(~crc, data, size);
+}
+
+uint32_t crc32Zeros(uint32_t crc, uint64_t count) noexcept
+{
+    uint32_t shift = power(2, count * 8, Crc32Poly, 32);
+    return reverse32(multiply(reverse32(crc), shift, Crc32Poly, 32));
+}
+
+uint32_t crc32Solve(uint32_t delta, uint64_t distance) noexcept
+{
+    uint32_t shift = power(inverseX(Crc32Poly, 32), distance * 8, Crc32Poly, 32);
+    return reverse32(multiply(reverse32(delta), shift, Crc32Poly, 32));
+}
+
+uint16_t crc16Raw(uint16_t crc, const uint8_t * data, std::size_t size) noexcept
+{
+    const auto & table = crc16Table();
+    for (std::size_t i = 0; i < size; ++i)
+        crc = static_cast<uint16_t>((crc << 8) ^ table[((crc >> 8) ^ data[i]) & 0xFF]);
+    return crc;
+}
+
+uint16_t crc16(const uint8_t * data, std::size_t size, uint16_t crc) noexcept
+{
+    return crc16Raw(crc, data, size);
+}
+
+uint16_t crc16Zeros(uint16_t crc, uint64_t count) noexcept
+{
+    uint32_t shift = power(2, count * 8, Crc16Poly, 16);
+    return static_cast<uint16_t>(multiply(crc, shift, Crc16Poly, 16));
+}
+
+uint16_t crc16Solve(uint16_t delta, uint64_t distance) noexcept
+{
+    uint32_t shift = power(inverseX(Crc16Poly, 16), distance * 8, Crc16Poly, 16);
+    return static_cast<uint16_t>(multiply(delta, shift, Crc16Poly, 16));
+}
+
+uint64_t xxh64(const uint8_t * data, std::size_t size, uint64_t seed) noexcept
+{
+    const uint8_t * end = data + size;
+    uint64_t hash;
+    if (size >= 32)
+    {
+        // Four independent lanes over 32 byte stripes
+        uint64_t v1 = seed + XxPrime1 + XxPrime2;
+        uint64_t v2 = seed + XxPrime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - XxPrime1;
+        for (; end - data >= 32; data += 32)
+        {
+            v1 = xxRound(v1, loadLE<uint64_t>(data));
+            v2 = xxRound(v2, loadLE<uint64_t>(data + 8));
+            v3 = xxRound(v3, loadLE<uint64_t>(data + 16));
+            v4 = xxRound(v4, loadLE<uint64_t>(data + 24));
+        }
+        hash = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        hash = xxMerge(hash, v1);
+        hash = xxMerge(hash, v2);
+        hash = xxMerge(hash, v3);
+        hash = xxMerge(hash, v4);
+    }
+    else
+        hash = seed + XxPrime5;
+    hash += size;
+
+    for (; end - data >= 8; data += 8)
+        hash = rotl64(hash ^ xxRound(0, loadLE<uint64_t>(data)), 27) * XxPrime1 + XxPrime4;
+    if (end - data >= 4)
+    {
+        hash = rotl64(hash ^ (loadLE<uint32_t>(data) * XxPrime1), 23) * XxPrime2 + XxPrime3;
+        data += 4;
+    }
+    for (; data < end; ++data)
+        hash = rotl64(hash ^ (*data * XxPrime5), 11) * XxPrime1;
+
+    hash ^= hash >> 33;
+    hash *= XxPrime2;
+    hash ^= hash >> 29;
+    hash *= XxPrime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+} // namespace checksum
+} // namespace lt
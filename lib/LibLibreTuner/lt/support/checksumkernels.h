@@ -0,0 +1,76 @@
+#ifndef LT_CHECKSUMKERNELS_H
+#define LT_CHECKSUMKERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace lt
+{
+
+/* Checksum primitives over raw bytes. Word sums read big endian words and
+ * use AVX2 when the running CPU has it, SSE2 when the build enables it,
+ * and a scalar loop otherwise. Pointers need no alignment. */
+namespace checksum
+{
+
+// Instruction sets the word sums are written for, narrowest first
+enum class Isa
+{
+    Scalar,
+    SSE2,
+    AVX2,
+};
+
+// Returns the widest instruction set supported by the build and the CPU
+Isa supportedIsa() noexcept;
+
+// Sum of `words` big endian 32-bit words, modulo 2^32
+uint32_t sum32BE(const uint8_t * data, std::size_t words) noexcept;
+// sum32BE() using `isa`, which must not be wider than supportedIsa()
+uint32_t sum32BE(const uint8_t * data, std::size_t words, Isa isa) noexcept;
+// Scalar reference of sum32BE()
+uint32_t sum32BEScalar(const uint8_t * data, std::size_t words) noexcept;
+
+// Sum of `words` big endian 16-bit words, modulo 2^16
+uint16_t sum16BE(const uint8_t * data, std::size_t words) noexcept;
+
+// XOR of `words` big endian 32-bit words
+uint32_t xor32BE(const uint8_t * data, std::size_t words) noexcept;
+
+/* CRC-32 (IEEE 802.3, as used by zlib) of `size` bytes computed
+ * slicing-by-8. Pass the CRC of preceding data as `crc` to continue it. */
+uint32_t crc32(const uint8_t * data, std::size_t size, uint32_t crc = 0) noexcept;
+
+/* CRC-32 register after feeding `size` bytes into `crc`, without the
+ * initial and final inversion. Linear in the data: the register of
+ * `a ^ b` is the XOR of the registers of `a` and `b`. */
+uint32_t crc32Raw(uint32_t crc, const uint8_t * data, std::size_t size) noexcept;
+
+// Returns the CRC-32 register after feeding `count` zero bytes into `crc`
+uint32_t crc32Zeros(uint32_t crc, uint64_t count) noexcept;
+
+/* Returns the 4 bytes (little endian) that, XORed into data `distance`
+ * bytes before its end, change its CRC-32 by `delta` */
+uint32_t crc32Solve(uint32_t delta, uint64_t distance) noexcept;
+
+// CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF)
+uint16_t crc16(const uint8_t * data, std::size_t size, uint16_t crc = 0xFFFF) noexcept;
+
+// CRC-16 register after feeding `size` bytes into `crc`
+uint16_t crc16Raw(uint16_t crc, const uint8_t * data, std::size_t size) noexcept;
+
+// Returns the CRC-16 register after feeding `count` zero bytes into `crc`
+uint16_t crc16Zeros(uint16_t crc, uint64_t count) noexcept;
+
+/* Returns the 2 bytes (big endian) that, XORed into data `distance`
+ * bytes before its end, change its CRC-16 by `delta` */
+uint16_t crc16Solve(uint16_t delta, uint64_t distance) noexcept;
+
+/* XXH64 of `size` bytes. Not a checksum of any ECU; used to identify
+ * data such as the base ROM of a tune file. */
+uint64_t xxh64(const uint8_t * data, std::size_t size, uint64_t seed = 0) noexcept;
+
+} // namespace checksum
+} // namespace lt
+
+#endif // LT_CHECKSUMKERNELS_H
@@ -1,9 +1,11 @@
 #ifndef LT_EVENT_H
 #define LT_EVENT_H
 
-#include <forward_list>
+#include <algorithm>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 namespace lt
 {
@@ -41,6 +43,9 @@ private:
     std::weak_ptr<State> state_;
 };
 
+/* Connections of an event. Dispatching iterates over a snapshot of the
+ * list, so connections may be added or removed from any thread meanwhile,
+ * including from a callback. */
 template <typename... Args> class EventState
 {
 public:
@@ -48,7 +53,8 @@ public:
 
     template <typename... A> void dispatch(A &&... args) const
     {
-        for (const std::weak_ptr<Connection> & connPtr : connections_)
+        std::shared_ptr<const List> connections = snapshot();
+        for (const std::weak_ptr<Connection> & connPtr : *connections)
         {
             if (auto conn = connPtr.lock())
             {
@@ -60,29 +66,60 @@ public:
     // Removes expired connections
     void removeExpired() noexcept
     {
-        connections_.remove_if([](auto & conn) { return conn.expired(); });
+        modify([](List & connections) {
+            connections.erase(std::remove_if(connections.begin(), connections.end(),
+                                             [](auto & conn) { return conn.expired(); }),
+                              connections.end());
+        });
     }
 
     // Adds a connection to the dispatch list
     void add(std::weak_ptr<Connection> conn) noexcept
     {
-        connections_.emplace_front(std::move(conn));
+        modify([&conn](List & connections) {
+            connections.erase(std::remove_if(connections.begin(), connections.end(),
+                                             [](auto & c) { return c.expired(); }),
+                              connections.end());
+            connections.insert(connections.begin(), std::move(conn));
+        });
     }
 
     // Disconnects a connection
     void disconnect(Connection * connection) noexcept
     {
-        connections_.remove_if([connection](auto & c) {
-            if (auto s = c.lock())
-            {
-                return s.get() == connection;
-            }
-            return true; // connection has expired
+        modify([connection](List & connections) {
+            connections.erase(std::remove_if(connections.begin(), connections.end(),
+                                             [connection](auto & c) {
+                                                 if (auto s = c.lock())
+                                                 {
+                                                     return s.get() == connection;
+                                                 }
+                                                 return true; // connection has expired
+                                             }),
+                              connections.end());
         });
     }
 
 private:
-    std::forward_list<std::weak_ptr<Connection>> connections_;
+    using List = std::vector<std::weak_ptr<Connection>>;
+
+    std::shared_ptr<const List> snapshot() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return connections_;
+    }
+
+    // Replaces the list with a modified copy
+    template <typename F> void modify(F && func)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto connections = std::make_shared<List>(*connections_);
+        func(*connections);
+        connections_ = std::move(connections);
+    }
+
+    mutable std::mutex mutex_;
+    std::shared_ptr<const List> connections_{std::make_shared<const List>()};
 };
 
 template <typename... Args> class Event
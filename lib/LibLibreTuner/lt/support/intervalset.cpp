@@ -0,0 +1,55 @@
+#include "intervalset.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace lt
+{
+
+void IntervalSet::insert(int begin, int end)
+{
+    if (begin >= end)
+        return;
+
+    // First range that ends at or after `begin`; ranges are disjoint, so
+    // the one before it is the only candidate that starts earlier
+    auto first = ranges_.upper_bound(begin);
+    if (first != ranges_.begin() && std::prev(first)->second >= begin)
+        --first;
+
+    // Common case: repeated writes inside an existing range
+    if (first != ranges_.end() && first->first <= begin && first->second >= end)
+        return;
+
+    auto last = first;
+    while (last != ranges_.end() && last->first <= end)
+    {
+        begin = std::min(begin, last->first);
+        end = std::max(end, last->second);
+        length_ -= static_cast<std::size_t>(last->second - last->first);
+        ++last;
+    }
+
+    auto hint = ranges_.erase(first, last);
+    ranges_.emplace_hint(hint, begin, end);
+    length_ += static_cast<std::size_t>(end - begin);
+}
+
+void IntervalSet::merge(const IntervalSet & other)
+{
+    for (const auto & [begin, end] : other)
+        insert(begin, end);
+}
+
+bool IntervalSet::intersects(int begin, int end) const noexcept
+{
+    if (begin >= end)
+        return false;
+
+    auto it = ranges_.lower_bound(end);
+    if (it == ranges_.begin())
+        return false;
+    return std::prev(it)->second > begin;
+}
+
+} // namespace lt
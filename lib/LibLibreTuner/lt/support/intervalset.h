@@ -0,0 +1,51 @@
+#ifndef LT_INTERVALSET_H
+#define LT_INTERVALSET_H
+
+#include <cstddef>
+#include <map>
+
+namespace lt
+{
+
+/* Set of half-open integer ranges [begin, end). Touching and overlapping
+ * ranges are merged on insertion, so iteration yields disjoint, sorted
+ * ranges with gaps between them. */
+class IntervalSet
+{
+public:
+    // Maps the beginning of each range to its end
+    using Map = std::map<int, int>;
+    using const_iterator = Map::const_iterator;
+
+    // Adds [begin, end). Empty ranges are ignored.
+    void insert(int begin, int end);
+
+    // Adds every range of `other`
+    void merge(const IntervalSet & other);
+
+    // Returns true if any range overlaps [begin, end)
+    bool intersects(int begin, int end) const noexcept;
+
+    inline void clear() noexcept
+    {
+        ranges_.clear();
+        length_ = 0;
+    }
+
+    inline bool empty() const noexcept { return ranges_.empty(); }
+    // Number of disjoint ranges
+    inline std::size_t size() const noexcept { return ranges_.size(); }
+    // Total number of integers covered
+    inline std::size_t length() const noexcept { return length_; }
+
+    inline const_iterator begin() const noexcept { return ranges_.begin(); }
+    inline const_iterator end() const noexcept { return ranges_.end(); }
+
+private:
+    Map ranges_;
+    std::size_t length_{0};
+};
+
+} // namespace lt
+
+#endif // LT_INTERVALSET_H
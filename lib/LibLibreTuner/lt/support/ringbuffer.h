@@ -0,0 +1,94 @@
+#ifndef LT_RINGBUFFER_H
+#define LT_RINGBUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+namespace lt
+{
+
+/* Lock-free single-producer/single-consumer ring buffer. push() may only
+ * be called from one thread and pop()/drain() from one other thread.
+ * The capacity is rounded up to a power of two. */
+template <typename T> class SpscRing
+{
+    static_assert(std::is_trivially_copyable_v<T>, "ring elements must be trivially copyable");
+
+public:
+    explicit SpscRing(std::size_t capacity)
+    {
+        std::size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+        mask_ = size - 1;
+        buffer_ = std::make_unique<T[]>(size);
+    }
+
+    SpscRing(const SpscRing &) = delete;
+    SpscRing & operator=(const SpscRing &) = delete;
+
+    inline std::size_t capacity() const noexcept { return mask_ + 1; }
+
+    // Adds an element. Returns false if the ring is full. Producer only.
+    bool push(const T & value) noexcept
+    {
+        std::size_t head = head_.load(std::memory_order_relaxed);
+        if (head - tailCache_ > mask_)
+        {
+            tailCache_ = tail_.load(std::memory_order_acquire);
+            if (head - tailCache_ > mask_)
+                return false;
+        }
+        buffer_[head & mask_] = value;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Removes an element. Returns false if the ring is empty. Consumer only.
+    bool pop(T & value) noexcept
+    {
+        std::size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire))
+            return false;
+        value = buffer_[tail & mask_];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /* Calls `func(const T &)` for every available element and removes
+     * them. Returns the number of elements. Consumer only. */
+    template <typename Func> std::size_t drain(Func && func)
+    {
+        std::size_t tail = tail_.load(std::memory_order_relaxed);
+        std::size_t head = head_.load(std::memory_order_acquire);
+        for (std::size_t i = tail; i != head; ++i)
+            func(buffer_[i & mask_]);
+        tail_.store(head, std::memory_order_release);
+        return head - tail;
+    }
+
+    // Returns the number of elements. Approximate while in use.
+    inline std::size_t size() const noexcept
+    {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    inline bool empty() const noexcept { return size() == 0; }
+
+private:
+    std::unique_ptr<T[]> buffer_;
+    std::size_t mask_;
+
+    // Written by the producer. Kept on separate cache lines from the
+    // consumer's index to avoid false sharing.
+    alignas(64) std::atomic<std::size_t> head_{0};
+    std::size_t tailCache_{0};
+
+    alignas(64) std::atomic<std::size_t> tail_{0};
+};
+
+} // namespace lt
+
+#endif // LT_RINGBUFFER_H
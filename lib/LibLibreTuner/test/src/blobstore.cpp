@@ -0,0 +1,126 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include <lt/rom/blobstore.h>
+
+using namespace lt;
+
+namespace
+{
+
+// Blob directory removed at the end of a test
+struct TempStore
+{
+    std::filesystem::path path;
+    BlobStore store;
+
+    explicit TempStore(BlobStore::HashFunction hash = &BlobId::of)
+        : path(std::filesystem::temp_directory_path() / "lt-blobstore-test"), store(path, hash)
+    {
+        std::filesystem::remove_all(path);
+    }
+    ~TempStore()
+    {
+        std::error_code ec;
+        std::filesystem::remove_all(path, ec);
+    }
+};
+
+std::vector<uint8_t> image(uint8_t seed)
+{
+    std::vector<uint8_t> data(4096);
+    for (std::size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>(i * 7 + seed);
+    return data;
+}
+
+// Hashes only the first bytes, so that images differing later collide
+BlobId prefixId(const uint8_t * data, std::size_t size) noexcept
+{
+    return BlobId::of(data, std::min<std::size_t>(size, 16));
+}
+
+std::vector<uint8_t> contents(const os::MappedFile & file)
+{
+    return std::vector<uint8_t>(file.data(), file.data() + file.size());
+}
+
+void overwrite(const std::filesystem::path & path, const std::vector<uint8_t> & data)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::out | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+}
+
+} // namespace
+
+TEST_CASE("Identical images are stored once", "[blobstore]")
+{
+    TempStore temp;
+    const std::vector<uint8_t> a = image(1);
+    const std::vector<uint8_t> b = image(2);
+
+    REQUIRE_FALSE(temp.store.contains(a.data(), a.size()));
+    const BlobId id = *temp.store.put(a.data(), a.size());
+    REQUIRE(id == BlobId::of(a.data(), a.size()));
+    REQUIRE(temp.store.put(a.data(), a.size()) == id);
+    REQUIRE(temp.store.contains(a.data(), a.size()));
+    REQUIRE_FALSE(temp.store.contains(b.data(), b.size()));
+    REQUIRE(temp.store.put(b.data(), b.size()) != id);
+
+    auto file = temp.store.map(id, a.size());
+    REQUIRE(contents(*file) == a);
+    REQUIRE(temp.store.map(id, a.size()) == file);
+    REQUIRE_THROWS_AS(temp.store.map(id, a.size() + 1), std::runtime_error);
+}
+
+TEST_CASE("Blobs whose bytes do not match their id are not trusted", "[blobstore]")
+{
+    TempStore temp;
+    const std::vector<uint8_t> a = image(1);
+    const BlobId id = *temp.store.put(a.data(), a.size());
+
+    // Same size, other contents
+    std::vector<uint8_t> damaged = a;
+    damaged[100] ^= 0xFF;
+    overwrite(temp.store.path(id), damaged);
+
+    REQUIRE_FALSE(temp.store.contains(a.data(), a.size()));
+    REQUIRE_THROWS_AS(temp.store.map(id, a.size()), std::runtime_error);
+
+    // Putting the image again repairs the blob
+    REQUIRE(temp.store.put(a.data(), a.size()) == id);
+    REQUIRE(temp.store.contains(a.data(), a.size()));
+    auto file = temp.store.map(id, a.size());
+    REQUIRE(contents(*file) == a);
+}
+
+TEST_CASE("Colliding images never replace a stored blob", "[blobstore]")
+{
+    TempStore temp(&prefixId);
+    const std::vector<uint8_t> a = image(1);
+    std::vector<uint8_t> b = a;
+    b[1000] ^= 0xFF;
+    const BlobId id = *temp.store.put(a.data(), a.size());
+    REQUIRE(temp.store.idOf(b.data(), b.size()) == id);
+
+    SECTION("Unmapped")
+    {
+        REQUIRE_FALSE(temp.store.put(b.data(), b.size()));
+        REQUIRE_FALSE(temp.store.contains(b.data(), b.size()));
+        REQUIRE(contents(*temp.store.map(id, a.size())) == a);
+    }
+    SECTION("Mapped")
+    {
+        auto file = temp.store.map(id, a.size());
+        REQUIRE_FALSE(temp.store.put(b.data(), b.size()));
+        REQUIRE(temp.store.map(id, a.size()) == file);
+        REQUIRE(contents(os::MappedFile(temp.store.path(id).string())) == a);
+    }
+    REQUIRE(temp.store.contains(a.data(), a.size()));
+}
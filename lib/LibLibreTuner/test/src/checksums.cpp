@@ -0,0 +1,115 @@
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <lt/support/checksumkernels.h>
+
+using namespace lt;
+
+namespace
+{
+
+std::vector<uint8_t> pattern(std::size_t size)
+{
+    std::vector<uint8_t> data(size);
+    for (std::size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>(i * 31 + (i >> 7) + 0x5A);
+    return data;
+}
+
+const uint8_t * bytes(const char * text) { return reinterpret_cast<const uint8_t *>(text); }
+
+} // namespace
+
+TEST_CASE("Every supported word sum kernel matches the scalar loop", "[checksums]")
+{
+    // Padding lets every length start at every alignment
+    const std::vector<uint8_t> data = pattern(4 * 200 + 32);
+
+    for (auto isa : {checksum::Isa::Scalar, checksum::Isa::SSE2, checksum::Isa::AVX2})
+    {
+        if (isa > checksum::supportedIsa())
+            continue;
+        INFO("isa " << static_cast<int>(isa));
+        for (std::size_t offset = 0; offset < 32; offset += 3)
+        {
+            for (std::size_t words = 0; words <= 200; ++words)
+            {
+                const uint8_t * p = data.data() + offset;
+                REQUIRE(checksum::sum32BE(p, words, isa) == checksum::sum32BEScalar(p, words));
+            }
+        }
+    }
+
+    REQUIRE(checksum::sum32BE(data.data(), 200) == checksum::sum32BEScalar(data.data(), 200));
+}
+
+TEST_CASE("Word sums read big endian words and wrap", "[checksums]")
+{
+    const uint8_t words[] = {0x00, 0x00, 0x01, 0x02, 0xFF, 0xFF, 0xFF, 0xFF};
+    REQUIRE(checksum::sum32BE(words, 2) == 0x0101u);
+    REQUIRE(checksum::sum16BE(words, 4) == 0x0100u);
+    REQUIRE(checksum::xor32BE(words, 2) == 0xFFFFFEFDu);
+
+    // Long enough for the vector loops
+    const std::vector<uint8_t> data = pattern(1030);
+    uint16_t sum16 = 0;
+    uint32_t xor32 = 0;
+    for (std::size_t i = 0; i + 2 <= data.size(); i += 2)
+        sum16 = static_cast<uint16_t>(sum16 + (data[i] << 8 | data[i + 1]));
+    for (std::size_t i = 0; i + 4 <= data.size(); i += 4)
+        xor32 ^= static_cast<uint32_t>(data[i]) << 24 | data[i + 1] << 16 | data[i + 2] << 8 | data[i + 3];
+    REQUIRE(checksum::sum16BE(data.data(), data.size() / 2) == sum16);
+    REQUIRE(checksum::xor32BE(data.data(), data.size() / 4) == xor32);
+}
+
+TEST_CASE("CRCs match their check values", "[checksums]")
+{
+    REQUIRE(checksum::crc32(bytes("123456789"), 9) == 0xCBF43926u);
+    REQUIRE(checksum::crc16(bytes("123456789"), 9) == 0x29B1u);
+
+    // Continuing a CRC is the same as computing it at once
+    REQUIRE(checksum::crc32(bytes("6789"), 4, checksum::crc32(bytes("12345"), 5)) == 0xCBF43926u);
+
+    // The slicing loop agrees with byte-at-a-time updates
+    const std::vector<uint8_t> data = pattern(1000);
+    uint32_t crc = 0;
+    for (uint8_t byte : data)
+        crc = checksum::crc32(&byte, 1, crc);
+    REQUIRE(checksum::crc32(data.data(), data.size()) == crc);
+}
+
+TEST_CASE("Solved CRC patches produce the requested change", "[checksums]")
+{
+    std::vector<uint8_t> data = pattern(300);
+    const uint32_t crc32 = checksum::crc32(data.data(), data.size());
+    const uint16_t crc16 = checksum::crc16(data.data(), data.size());
+
+    SECTION("CRC-32")
+    {
+        const uint32_t target = 0xDEADBEEFu;
+        const std::size_t at = 100;
+        uint32_t patch = checksum::crc32Solve(crc32 ^ target, data.size() - at);
+        for (int i = 0; i < 4; ++i)
+            data[at + i] ^= static_cast<uint8_t>(patch >> (8 * i));
+        REQUIRE(checksum::crc32(data.data(), data.size()) == target);
+    }
+    SECTION("CRC-16")
+    {
+        const uint16_t target = 0x1234u;
+        const std::size_t at = 40;
+        uint16_t patch = checksum::crc16Solve(crc16 ^ target, data.size() - at);
+        data[at] ^= static_cast<uint8_t>(patch >> 8);
+        data[at + 1] ^= static_cast<uint8_t>(patch);
+        REQUIRE(checksum::crc16(data.data(), data.size()) == target);
+    }
+}
+
+TEST_CASE("XXH64 matches the reference implementation", "[checksums]")
+{
+    REQUIRE(checksum::xxh64(nullptr, 0) == 0xEF46DB3751D8E999ull);
+    REQUIRE(checksum::xxh64(bytes("a"), 1) == 0xD24EC4F1A98C6E5Bull);
+    REQUIRE(checksum::xxh64(bytes("abc"), 3) == 0x44BC2CF5AD770999ull);
+}
@@ -0,0 +1,121 @@
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <lt/buffer/memorybuffer.h>
+#include <lt/buffer/view.h>
+#include <lt/definition/checksum.h>
+
+using namespace lt;
+
+namespace
+{
+
+constexpr int BufferSize = 1024;
+// Start of the checksummed part, like the flash offset of a platform
+constexpr int Offset = 64;
+constexpr int Size = BufferSize - Offset;
+
+template <typename T> void add(Checksums & checksums, int offset, int size, uint32_t target, int slot, int width)
+{
+    auto checksum = std::make_unique<T>(offset, size, target);
+    checksum->addModifiable(slot, width);
+    checksums.add(std::move(checksum));
+}
+
+// One checksum of every kind. The last covers all others and its
+// modifiable section lies outside of their regions.
+Checksums makeChecksums()
+{
+    Checksums checksums;
+    add<ChecksumBasic>(checksums, 0, 256, 0x12345678, 252, 4);
+    add<ChecksumSum16>(checksums, 256, 128, 0xBEEF, 124, 2);
+    add<ChecksumXor>(checksums, 384, 128, 0xCAFEF00D, 0, 4);
+    add<ChecksumCrc32>(checksums, 512, 256, 0xDEADBEEF, 100, 4);
+    add<ChecksumCrc16>(checksums, 768, 180, 0x1234, 10, 2);
+    add<ChecksumBasic>(checksums, 0, Size, 0x0BADF00D, 956, 4);
+    return checksums;
+}
+
+std::vector<uint8_t> initialData()
+{
+    std::vector<uint8_t> data(BufferSize);
+    for (std::size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>(i * 29 + (i >> 5));
+    return data;
+}
+
+// Every checksum computed over its whole region
+std::vector<uint32_t> recompute(const Checksums & checksums, const MemoryBuffer & buffer)
+{
+    std::vector<uint32_t> sums;
+    for (const ChecksumPtr & checksum : checksums)
+        sums.push_back(checksum->compute(buffer.data() + Offset, Size));
+    return sums;
+}
+
+} // namespace
+
+TEST_CASE("Tracked checksums match a full recompute after writes", "[checksum]")
+{
+    MemoryBuffer buffer(initialData());
+    const Checksums checksums = makeChecksums();
+    ChecksumTracker tracker(buffer);
+    tracker.reset(checksums, Offset);
+    REQUIRE(tracker.sums() == recompute(checksums, buffer));
+
+    std::mt19937 rng(7);
+    // Views may not reach the last byte
+    std::uniform_int_distribution<int> offset(0, BufferSize - 17);
+    std::uniform_int_distribution<int> size(1, 16);
+    std::uniform_int_distribution<int> byte(0, 255);
+
+    for (int round = 0; round < 100; ++round)
+    {
+        // Writes overlap each other and the start of the checksummed part
+        for (int i = 0; i < round % 7 + 1; ++i)
+        {
+            const int at = i == 0 ? Offset - 4 + round % 8 : offset(rng);
+            const int length = size(rng);
+            uint8_t * bytes = buffer.view(at, length).writeBytes(0, length);
+            for (int j = 0; j < length; ++j)
+                bytes[j] = static_cast<uint8_t>(byte(rng));
+        }
+        tracker.update();
+        REQUIRE(tracker.sums() == recompute(checksums, buffer));
+    }
+}
+
+TEST_CASE("Correction patches only modifiable sections", "[checksum]")
+{
+    MemoryBuffer buffer(initialData());
+    const Checksums checksums = makeChecksums();
+    ChecksumTracker tracker(buffer);
+    tracker.reset(checksums, Offset);
+
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<int> offset(0, BufferSize - 17);
+    for (int round = 0; round < 20; ++round)
+    {
+        for (int i = 0; i < 5; ++i)
+            buffer.view(offset(rng), 8).set<uint64_t, Endianness::Big>(rng());
+
+        const std::vector<uint8_t> before(buffer.cbegin(), buffer.cend());
+        const IntervalSet patched = tracker.correct();
+        REQUIRE(checksums.verify(buffer.data() + Offset, Size));
+        REQUIRE(tracker.sums() == recompute(checksums, buffer));
+
+        // Every changed byte lies in a reported range
+        for (int i = 0; i < BufferSize; ++i)
+        {
+            if (buffer[i] != before[i])
+                REQUIRE(patched.intersects(i - Offset, i - Offset + 1));
+        }
+
+        // A second correction has nothing left to do
+        REQUIRE(tracker.correct().empty());
+    }
+}
@@ -0,0 +1,214 @@
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <lt/rom/deltafile.h>
+
+using namespace lt;
+
+namespace
+{
+
+constexpr std::size_t BaseSize = 256;
+
+std::vector<uint8_t> baseData()
+{
+    std::vector<uint8_t> data(BaseSize);
+    for (std::size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>(i);
+    return data;
+}
+
+DeltaHeader baseHeader(const std::string & metadata)
+{
+    DeltaHeader header;
+    header.metadataSize = metadata.size();
+    header.baseHash = 0x1234;
+    header.baseSize = BaseSize;
+    return header;
+}
+
+std::string readFile(const std::filesystem::path & path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::in);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void writeRaw(const std::filesystem::path & path, const std::string & contents)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::out | std::ios::trunc);
+    file.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+}
+
+// Applies the delta file at `path` over the base data
+std::vector<uint8_t> load(const std::filesystem::path & path, DeltaLog & log)
+{
+    const std::string contents = readFile(path);
+    const auto * bytes = reinterpret_cast<const uint8_t *>(contents.data());
+    std::optional<DeltaHeader> header = readDeltaHeader(bytes, contents.size());
+    REQUIRE(header);
+
+    std::vector<uint8_t> data = baseData();
+    log = applyDeltas(bytes, contents.size(), *header, data.data());
+    return data;
+}
+
+// Temporary delta file removed at the end of a test
+struct TempFile
+{
+    std::filesystem::path path;
+
+    TempFile() : path(std::filesystem::temp_directory_path() / "lt-deltafile-test.ltt")
+    {
+        std::filesystem::remove(path);
+    }
+    ~TempFile()
+    {
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+    }
+};
+
+} // namespace
+
+TEST_CASE("Encoded delta files apply over the base", "[deltafile]")
+{
+    const std::string metadata = "meta";
+    std::vector<uint8_t> tune = baseData();
+    tune[3] = 0xAA;
+    tune[200] = 0xBB;
+    tune[201] = 0xCC;
+
+    DeltaFile file = encodeDeltaFile(metadata, baseHeader(metadata), tune.data(), {{3, 4}, {200, 202}});
+    const auto * bytes = reinterpret_cast<const uint8_t *>(file.contents.data());
+    std::optional<DeltaHeader> header = readDeltaHeader(bytes, file.contents.size());
+    REQUIRE(header);
+    REQUIRE(header->metadataSize == metadata.size());
+    REQUIRE(header->baseSize == BaseSize);
+    REQUIRE(file.contents.substr(header->metadataOffset(), metadata.size()) == metadata);
+
+    std::vector<uint8_t> data = baseData();
+    DeltaLog log = applyDeltas(bytes, file.contents.size(), *header, data.data());
+    REQUIRE(data == tune);
+    REQUIRE(log.end == file.contents.size());
+    REQUIRE(log.records == 1);
+    REQUIRE(log.bytes == 3);
+    REQUIRE(log.tail == file.log.tail);
+}
+
+TEST_CASE("Appended records are applied in order on reload", "[deltafile]")
+{
+    TempFile temp;
+    const std::string metadata = "meta";
+    const DeltaHeader header = baseHeader(metadata);
+    std::vector<uint8_t> tune = baseData();
+    tune[10] = 1;
+
+    DeltaFile file = encodeDeltaFile(metadata, header, tune.data(), {{10, 11}});
+    writeDeltaFile(temp.path, file);
+    DeltaLog log = file.log;
+
+    tune[10] = 2;
+    tune[50] = 3;
+    REQUIRE(appendDeltas(temp.path, header, log, tune.data(), {{10, 11}, {50, 51}}));
+    REQUIRE(log.records == 2);
+    REQUIRE(std::filesystem::file_size(temp.path) == log.end);
+
+    DeltaLog loaded;
+    REQUIRE(load(temp.path, loaded) == tune);
+    REQUIRE(loaded.end == log.end);
+    REQUIRE(loaded.records == 2);
+    REQUIRE(loaded.tail == log.tail);
+}
+
+TEST_CASE("A torn last record is ignored and overwritten", "[deltafile]")
+{
+    TempFile temp;
+    const std::string metadata = "meta";
+    const DeltaHeader header = baseHeader(metadata);
+    std::vector<uint8_t> first = baseData();
+    first[20] = 7;
+
+    DeltaFile file = encodeDeltaFile(metadata, header, first.data(), {{20, 21}});
+    writeDeltaFile(temp.path, file);
+    DeltaLog log = file.log;
+
+    std::vector<uint8_t> second = first;
+    second[30] = 8;
+    DeltaLog appended = log;
+    REQUIRE(appendDeltas(temp.path, header, appended, second.data(), {{30, 31}}));
+
+    // An interrupted save leaves part of the record behind
+    std::string contents = readFile(temp.path);
+    writeRaw(temp.path, contents.substr(0, contents.size() - 3));
+
+    DeltaLog loaded;
+    REQUIRE(load(temp.path, loaded) == first);
+    REQUIRE(loaded.end == log.end);
+    REQUIRE(loaded.records == 1);
+
+    // A record whose bytes do not match its hash is ignored the same way
+    contents[log.end + 12] ^= 0xFF;
+    writeRaw(temp.path, contents);
+    REQUIRE(load(temp.path, loaded) == first);
+    REQUIRE(loaded.end == log.end);
+
+    // The next save replaces the remains
+    std::vector<uint8_t> third = first;
+    third[40] = 9;
+    REQUIRE(appendDeltas(temp.path, header, loaded, third.data(), {{40, 41}}));
+    REQUIRE(std::filesystem::file_size(temp.path) == loaded.end);
+
+    DeltaLog reloaded;
+    REQUIRE(load(temp.path, reloaded) == third);
+    REQUIRE(reloaded.records == 2);
+    REQUIRE(reloaded.end == loaded.end);
+}
+
+TEST_CASE("Appending to a foreign file is refused", "[deltafile]")
+{
+    TempFile temp;
+    const std::string metadata = "meta";
+    const DeltaHeader header = baseHeader(metadata);
+    std::vector<uint8_t> tune = baseData();
+    tune[0] = 0xFF;
+
+    DeltaFile file = encodeDeltaFile(metadata, header, tune.data(), {{0, 1}});
+    writeDeltaFile(temp.path, file);
+    DeltaLog log = file.log;
+    const DeltaLog before = log;
+
+    SECTION("Replaced by another delta file")
+    {
+        std::vector<uint8_t> other = baseData();
+        other[1] = 0xEE;
+        writeDeltaFile(temp.path, encodeDeltaFile(metadata, header, other.data(), {{1, 2}}));
+    }
+    SECTION("Saved against another base")
+    {
+        DeltaHeader other = header;
+        other.baseHash = 0x5678;
+        writeDeltaFile(temp.path, encodeDeltaFile(metadata, other, tune.data(), {{0, 1}}));
+    }
+    SECTION("Not a delta file")
+    {
+        writeRaw(temp.path, std::string(file.contents.size(), 'x'));
+    }
+    SECTION("Shorter than the log")
+    {
+        writeRaw(temp.path, file.contents.substr(0, DeltaHeader::size + metadata.size()));
+    }
+
+    const std::string contents = readFile(temp.path);
+    REQUIRE(verifyDeltaFile(temp.path, header, log) == 0);
+    REQUIRE_FALSE(appendDeltas(temp.path, header, log, tune.data(), {{0, 1}}));
+    REQUIRE(readFile(temp.path) == contents);
+    REQUIRE(log.end == before.end);
+    REQUIRE(log.records == before.records);
+}
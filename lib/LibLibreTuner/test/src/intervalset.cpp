@@ -0,0 +1,141 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <lt/buffer/memorybuffer.h>
+#include <lt/buffer/view.h>
+#include <lt/support/intervalset.h>
+
+using namespace lt;
+
+namespace
+{
+
+constexpr int Universe = 200;
+
+// Ranges of the set expanded to one flag per integer
+std::vector<bool> covered(const IntervalSet & set)
+{
+    std::vector<bool> flags(Universe);
+    for (const auto & [begin, end] : set)
+    {
+        for (int i = begin; i < end; ++i)
+            flags[i] = true;
+    }
+    return flags;
+}
+
+// Maximal runs of set flags, the ranges the set must hold
+std::vector<std::pair<int, int>> runs(const std::vector<bool> & flags)
+{
+    std::vector<std::pair<int, int>> result;
+    for (int i = 0; i < Universe;)
+    {
+        if (!flags[i])
+        {
+            ++i;
+            continue;
+        }
+        int begin = i;
+        while (i < Universe && flags[i])
+            ++i;
+        result.emplace_back(begin, i);
+    }
+    return result;
+}
+
+std::vector<std::pair<int, int>> ranges(const IntervalSet & set)
+{
+    return std::vector<std::pair<int, int>>(set.begin(), set.end());
+}
+
+} // namespace
+
+TEST_CASE("Touching and overlapping ranges are merged", "[intervalset]")
+{
+    IntervalSet set;
+    set.insert(10, 20);
+    set.insert(20, 25);
+    set.insert(5, 8);
+    set.insert(30, 30);
+    REQUIRE(ranges(set) == std::vector<std::pair<int, int>>{{5, 8}, {10, 25}});
+    REQUIRE(set.length() == 18);
+
+    set.insert(7, 11);
+    REQUIRE(ranges(set) == std::vector<std::pair<int, int>>{{5, 25}});
+
+    set.insert(12, 14);
+    REQUIRE(set.size() == 1);
+    REQUIRE(set.length() == 20);
+
+    set.clear();
+    REQUIRE(set.empty());
+    REQUIRE(set.length() == 0);
+}
+
+TEST_CASE("Random insertions match a brute-force set", "[intervalset]")
+{
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> position(0, Universe - 1);
+    std::uniform_int_distribution<int> length(0, 12);
+
+    for (int round = 0; round < 50; ++round)
+    {
+        IntervalSet set;
+        IntervalSet other;
+        std::vector<bool> expected(Universe);
+        for (int i = 0; i < 40; ++i)
+        {
+            int begin = position(rng);
+            int end = std::min(Universe, begin + length(rng));
+            (i % 3 == 0 ? other : set).insert(begin, end);
+            for (int j = begin; j < end; ++j)
+                expected[j] = true;
+        }
+        set.merge(other);
+
+        REQUIRE(covered(set) == expected);
+        REQUIRE(ranges(set) == runs(expected));
+
+        std::size_t count = 0;
+        for (bool flag : expected)
+            count += flag ? 1 : 0;
+        REQUIRE(set.length() == count);
+
+        for (int begin = 0; begin < Universe; begin += 3)
+        {
+            for (int end = begin; end <= std::min(Universe, begin + 15); ++end)
+            {
+                bool any = false;
+                for (int j = begin; j < end; ++j)
+                    any = any || expected[j];
+                REQUIRE(set.intersects(begin, end) == any);
+            }
+        }
+    }
+}
+
+TEST_CASE("Writes through views mark their bytes dirty", "[intervalset][memorybuffer]")
+{
+    MemoryBuffer buffer(std::vector<uint8_t>(64));
+    REQUIRE_FALSE(buffer.isDirty());
+
+    View view = buffer.view(8, 32);
+    view.set<uint32_t, Endianness::Big>(1, 0);
+    view.set<uint16_t, Endianness::Little>(2, 4);
+    view.writeBytes(20, 4);
+    REQUIRE(ranges(buffer.dirty()) == std::vector<std::pair<int, int>>{{8, 14}, {28, 32}});
+
+    // Direct writes are only tracked when marked
+    buffer[50] = 1;
+    REQUIRE(buffer.dirty().size() == 2);
+    buffer.markDirty(50, 1);
+    REQUIRE(buffer.dirty().intersects(50, 51));
+
+    buffer.clearDirty();
+    REQUIRE_FALSE(buffer.isDirty());
+}
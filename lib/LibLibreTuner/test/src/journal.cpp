@@ -0,0 +1,264 @@
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include <cereal/archives/binary.hpp>
+#include <cereal/types/vector.hpp>
+
+#include <lt/buffer/journal.h>
+#include <lt/buffer/view.h>
+
+using namespace lt;
+
+namespace
+{
+
+constexpr int BufferSize = 256;
+
+std::vector<uint8_t> initialData()
+{
+    std::vector<uint8_t> data(BufferSize);
+    for (std::size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>(i * 13 + 1);
+    return data;
+}
+
+std::vector<uint8_t> contents(const MemoryBuffer & buffer)
+{
+    return std::vector<uint8_t>(buffer.cbegin(), buffer.cend());
+}
+
+// Writes `size` bytes at `offset` through a view, inverting them
+void invert(MemoryBuffer & buffer, int offset, int size)
+{
+    uint8_t * bytes = buffer.view(offset, size).writeBytes(0, size);
+    for (int i = 0; i < size; ++i)
+        bytes[i] = static_cast<uint8_t>(~bytes[i]);
+}
+
+void write(MemoryBuffer & buffer, int offset, const std::vector<uint8_t> & bytes)
+{
+    const int size = static_cast<int>(bytes.size());
+    std::memcpy(buffer.view(offset, size).writeBytes(0, size), bytes.data(), bytes.size());
+}
+
+// Memory used by an entry of spans of `sizes` bytes
+std::size_t entryUsage(const std::vector<std::size_t> & sizes)
+{
+    std::size_t usage = sizeof(EditJournal::Entry);
+    for (std::size_t size : sizes)
+        usage += sizeof(EditJournal::Span) + 2 * size;
+    return usage;
+}
+
+} // namespace
+
+TEST_CASE("Undo and redo step through every recorded state", "[journal]")
+{
+    MemoryBuffer buffer(initialData());
+    EditJournal journal(buffer);
+
+    std::mt19937 rng(42);
+    // Views may not reach the last byte
+    std::uniform_int_distribution<int> offset(0, BufferSize - 17);
+    std::uniform_int_distribution<int> size(1, 16);
+
+    // The state after each entry; single writes and groups alternate
+    std::vector<std::vector<uint8_t>> states{contents(buffer)};
+    for (int i = 0; i < 40; ++i)
+    {
+        if (i % 4 == 3)
+        {
+            // Disjoint, so that inverting twice cannot undo a write
+            auto group = journal.group();
+            for (int j = 0; j < 5; ++j)
+                invert(buffer, j * 48 + offset(rng) % 32, size(rng));
+        }
+        else
+            invert(buffer, offset(rng), size(rng));
+        states.push_back(contents(buffer));
+    }
+
+    for (std::size_t i = states.size() - 1; i > 0; --i)
+    {
+        buffer.clearDirty();
+        REQUIRE(journal.undo());
+        REQUIRE(contents(buffer) == states[i - 1]);
+        // Restored bytes must be saved like any other edit
+        REQUIRE(buffer.isDirty());
+    }
+    REQUIRE_FALSE(journal.canUndo());
+    REQUIRE_FALSE(journal.undo());
+
+    for (std::size_t i = 1; i < states.size(); ++i)
+    {
+        REQUIRE(journal.redo());
+        REQUIRE(contents(buffer) == states[i]);
+    }
+    REQUIRE_FALSE(journal.redo());
+}
+
+TEST_CASE("Writes within one entry are coalesced", "[journal]")
+{
+    MemoryBuffer buffer(initialData());
+    EditJournal journal(buffer);
+    const std::vector<uint8_t> before = contents(buffer);
+
+    {
+        auto group = journal.group();
+        invert(buffer, 10, 4);
+        invert(buffer, 14, 2);
+        invert(buffer, 12, 8);
+        invert(buffer, 40, 2);
+        // Touches neither span
+        invert(buffer, 43, 1);
+    }
+
+    // [10, 20), [40, 42) and [43, 44)
+    REQUIRE(journal.memoryUsage() == entryUsage({10, 2, 1}));
+
+    REQUIRE(journal.undo());
+    REQUIRE(contents(buffer) == before);
+    REQUIRE_FALSE(journal.canUndo());
+}
+
+TEST_CASE("Groups form one entry and unchanged writes form none", "[journal]")
+{
+    MemoryBuffer buffer(initialData());
+    EditJournal journal(buffer);
+    const std::vector<uint8_t> before = contents(buffer);
+
+    SECTION("Nested groups")
+    {
+        journal.beginGroup();
+        invert(buffer, 0, 4);
+        {
+            auto inner = journal.group();
+            invert(buffer, 100, 4);
+        }
+        invert(buffer, 200, 4);
+        journal.endGroup();
+
+        REQUIRE(journal.undo());
+        REQUIRE(contents(buffer) == before);
+        REQUIRE_FALSE(journal.canUndo());
+    }
+    SECTION("Writes of the same bytes")
+    {
+        write(buffer, 5, {before[5], before[6]});
+        journal.flush();
+        REQUIRE_FALSE(journal.canUndo());
+        REQUIRE(journal.memoryUsage() == 0);
+    }
+    SECTION("A new edit drops the undone entries")
+    {
+        invert(buffer, 0, 1);
+        invert(buffer, 1, 1);
+        REQUIRE(journal.undo());
+        REQUIRE(journal.canRedo());
+        invert(buffer, 2, 1);
+        REQUIRE_FALSE(journal.canRedo());
+        journal.flush();
+        REQUIRE(journal.memoryUsage() == 2 * entryUsage({1}));
+    }
+}
+
+TEST_CASE("The oldest entries are dropped beyond the memory limit", "[journal]")
+{
+    MemoryBuffer buffer(initialData());
+    const std::size_t usage = entryUsage({1});
+    EditJournal journal(buffer, 5 * usage);
+
+    std::vector<std::vector<uint8_t>> states{contents(buffer)};
+    for (int i = 0; i < 20; ++i)
+    {
+        invert(buffer, i * 3, 1);
+        states.push_back(contents(buffer));
+    }
+    journal.flush();
+    REQUIRE(journal.memoryUsage() == 5 * usage);
+
+    int undone = 0;
+    while (journal.undo())
+        ++undone;
+    REQUIRE(undone == 5);
+    REQUIRE(contents(buffer) == states[15]);
+
+    // Lowering the limit keeps the newest entry, even if it alone is
+    // too large
+    while (journal.redo())
+        ;
+    journal.setLimit(1);
+    REQUIRE(journal.memoryUsage() == usage);
+    REQUIRE(journal.undo());
+    REQUIRE(contents(buffer) == states[19]);
+    REQUIRE_FALSE(journal.canUndo());
+}
+
+TEST_CASE("Saved histories are restored for the same data only", "[journal]")
+{
+    MemoryBuffer buffer(initialData());
+    EditJournal journal(buffer);
+    const std::vector<uint8_t> initial = contents(buffer);
+
+    invert(buffer, 0, 8);
+    invert(buffer, 50, 8);
+    const std::vector<uint8_t> undone = contents(buffer);
+    invert(buffer, 100, 8);
+    REQUIRE(journal.undo());
+    // Recorded but not yet sealed
+    invert(buffer, 150, 8);
+    const std::vector<uint8_t> saved = contents(buffer);
+
+    std::stringstream stream;
+    {
+        cereal::BinaryOutputArchive archive(stream);
+        archive(journal);
+    }
+
+    SECTION("Same data")
+    {
+        std::vector<uint8_t> same = saved;
+        MemoryBuffer copy(std::move(same));
+        EditJournal loaded(copy);
+        cereal::BinaryInputArchive archive(stream);
+        archive(loaded);
+
+        // The new edit dropped the undone entry
+        REQUIRE_FALSE(loaded.canRedo());
+        REQUIRE(loaded.undo());
+        REQUIRE(contents(copy) == undone);
+        REQUIRE(loaded.undo());
+        REQUIRE(loaded.undo());
+        REQUIRE(contents(copy) == initial);
+        REQUIRE_FALSE(loaded.undo());
+        while (loaded.redo())
+            ;
+        REQUIRE(contents(copy) == saved);
+    }
+    SECTION("Other data of the same size")
+    {
+        std::vector<uint8_t> other = saved;
+        other[200] ^= 1;
+        MemoryBuffer copy(std::move(other));
+        EditJournal loaded(copy);
+        cereal::BinaryInputArchive archive(stream);
+        archive(loaded);
+        REQUIRE_FALSE(loaded.canUndo());
+        REQUIRE_FALSE(loaded.canRedo());
+    }
+    SECTION("Data of another size")
+    {
+        std::vector<uint8_t> other = saved;
+        other.push_back(0);
+        MemoryBuffer copy(std::move(other));
+        EditJournal loaded(copy);
+        cereal::BinaryInputArchive archive(stream);
+        archive(loaded);
+        REQUIRE_FALSE(loaded.canUndo());
+    }
+}
@@ -0,0 +1,96 @@
+#include <catch2/catch.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <lt/buffer/memorybuffer.h>
+#include <lt/buffer/view.h>
+#include <lt/rom/kernels.h>
+#include <lt/rom/table.h>
+
+using namespace lt;
+
+namespace
+{
+
+template <typename T, Endianness endianness = Endianness::Little>
+std::vector<T> encoded(const std::vector<double> & values, const Affine & transform = Affine{})
+{
+    std::vector<uint8_t> bytes(values.size() * sizeof(T));
+    kernels::encode<T, endianness>(values.data(), values.size(), bytes.data(), transform);
+
+    std::vector<T> stored(values.size());
+    kernels::load<T, endianness>(bytes.data(), values.size(), stored.data());
+    return stored;
+}
+
+} // namespace
+
+TEST_CASE("Identity transform rounds to the nearest stored value", "[kernels]")
+{
+    REQUIRE(encoded<uint8_t>({0.0, 1.0, 1.4, 1.6, 2.5, 254.6}) == std::vector<uint8_t>{0, 1, 1, 2, 2, 255});
+    REQUIRE(encoded<int16_t>({-1.4, -1.6, 100.5, 101.5}) == std::vector<int16_t>{-1, -2, 100, 102});
+    REQUIRE(encoded<uint16_t, Endianness::Big>({513.7}) == std::vector<uint16_t>{514});
+}
+
+TEST_CASE("Scaled values round instead of truncating", "[kernels]")
+{
+    // 0.3 / 0.1 is slightly below 3
+    Affine transform{0.1, 0.0};
+    REQUIRE(encoded<uint8_t>({0.3, 0.7, 25.5}, transform) == std::vector<uint8_t>{3, 7, 255});
+}
+
+TEST_CASE("Out of range values saturate", "[kernels]")
+{
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const double inf = std::numeric_limits<double>::infinity();
+
+    REQUIRE(encoded<uint8_t>({-5.0, 300.0, 1e300, -inf, nan}) == std::vector<uint8_t>{0, 255, 255, 0, 0});
+    REQUIRE(encoded<int16_t>({-1e9, 1e9, 32767.4, -32768.4}) == std::vector<int16_t>{-32768, 32767, 32767, -32768});
+    REQUIRE(encoded<uint32_t>({-1.0, 5e9}) == std::vector<uint32_t>{0, std::numeric_limits<uint32_t>::max()});
+    REQUIRE(encoded<int64_t>({1e30, -1e30}) ==
+            std::vector<int64_t>{std::numeric_limits<int64_t>::max(), std::numeric_limits<int64_t>::lowest()});
+    REQUIRE(encoded<uint64_t>({1e30}) == std::vector<uint64_t>{std::numeric_limits<uint64_t>::max()});
+
+    std::vector<float> floats = encoded<float>({1e300, -1e300, inf});
+    REQUIRE(floats[0] == std::numeric_limits<float>::max());
+    REQUIRE(floats[1] == std::numeric_limits<float>::lowest());
+    REQUIRE(std::isinf(floats[2]));
+}
+
+TEST_CASE("Fill and scaleOffset saturate", "[kernels]")
+{
+    uint8_t bytes[4] = {10, 20, 200, 250};
+    kernels::scaleOffset<uint8_t, Endianness::Little>(bytes, 4, 2.0, 0.0, Affine{});
+    REQUIRE(std::vector<uint8_t>(bytes, bytes + 4) == std::vector<uint8_t>{20, 40, 255, 255});
+
+    kernels::scaleOffset<uint8_t, Endianness::Little>(bytes, 4, 1.0, -30.0, Affine{});
+    REQUIRE(std::vector<uint8_t>(bytes, bytes + 4) == std::vector<uint8_t>{0, 10, 225, 225});
+
+    kernels::fill<uint8_t, Endianness::Little>(bytes, 4, 1000.0, Affine{});
+    REQUIRE(std::vector<uint8_t>(bytes, bytes + 4) == std::vector<uint8_t>{255, 255, 255, 255});
+
+    kernels::fill<uint8_t, Endianness::Little>(bytes, 4, -1.0, Affine{});
+    REQUIRE(std::vector<uint8_t>(bytes, bytes + 4) == std::vector<uint8_t>{0, 0, 0, 0});
+}
+
+TEST_CASE("Table edits saturate at the stored type", "[kernels][table]")
+{
+    MemoryBuffer buffer(std::vector<uint8_t>{100, 150, 200, 250, 0});
+    Table table =
+        Table::Builder()
+            .setSize(4, 1)
+            .setEntries(std::make_unique<EntriesImpl<double, uint8_t, Endianness::Little>>(buffer.view(0, 4)))
+            .build();
+
+    table.edit(CellRange{0, 0, 1, 4}, RangeOperation::Add, 10.0);
+    REQUIRE(table.getAll() == std::vector<double>{110, 160, 210, 255});
+
+    table.edit(CellRange{0, 0, 1, 4}, RangeOperation::Multiply, -1.0);
+    REQUIRE(table.getAll() == std::vector<double>{0, 0, 0, 0});
+
+    table.set(0, 0, 99.6);
+    REQUIRE(table.get(0, 0) == 100);
+}
@@ -1,6 +1,7 @@
 #include "projects.h"
 
 #include <QFileIconProvider>
+#include <QSocketNotifier>
 #include <logger.h>
 #include <uiutil.h>
 
@@ -98,6 +99,9 @@ public:
         return QVariant();
     }
 
+    const lt::Rom::MetaData & metadata() const noexcept { return md_; }
+    void setMetaData(lt::Rom::MetaData md) { md_ = std::move(md); }
+
 private:
     lt::Rom::MetaData md_;
 };
@@ -130,6 +134,9 @@ public:
         return QVariant();
     }
 
+    const lt::Tune::MetaData & metadata() const noexcept { return md_; }
+    void setMetaData(lt::Tune::MetaData md) { md_ = std::move(md); }
+
 private:
     lt::Tune::MetaData md_;
 };
@@ -289,12 +296,35 @@ void Projects::addProject(lt::ProjectPtr project)
     QString romsDir = QString::fromStdString(project->romsDirectory().string());
     QString tunesDir =
         QString::fromStdString(project->tunesDirectory().string());
-    if (!romsWatcher_.addPath(romsDir))
-        Logger::warning("Failed to add roms path '" + romsDir.toStdString() +
-                        "' to file watcher.");
-    if (!tunesWatcher_.addPath(tunesDir))
-        Logger::warning("Failed to add tunes path '" + tunesDir.toStdString() +
-                        "' to file watcher.");
+
+    bool watched = false;
+    try
+    {
+        watched = project->watch();
+    }
+    catch (const std::exception & e)
+    {
+        Logger::warning("Failed to watch project '" + project->name() +
+                        "': " + e.what());
+    }
+
+    if (watched)
+    {
+        // Only the changed files are read again
+        auto * notifier = new QSocketNotifier(project->watchHandle(),
+                                              QSocketNotifier::Read, this);
+        connect(notifier, &QSocketNotifier::activated, this,
+                [this, project]() { projectChanged(project); });
+    }
+    else
+    {
+        if (!romsWatcher_.addPath(romsDir))
+            Logger::warning("Failed to add roms path '" +
+                            romsDir.toStdString() + "' to file watcher.");
+        if (!tunesWatcher_.addPath(tunesDir))
+            Logger::warning("Failed to add tunes path '" +
+                            tunesDir.toStdString() + "' to file watcher.");
+    }
 
     beginInsertRows(QModelIndex(), root_->children.size(),
                     root_->children.size());
@@ -429,6 +459,87 @@ void Projects::refreshTunes(const QModelIndex & index)
     }, tr("Error querying tune metadata"));
 }
 
+template <typename Item, typename MetaData>
+void Projects::updateRow(const QModelIndex & index,
+                         const std::string & filename,
+                         const std::optional<MetaData> & md)
+{
+    auto * dirItem = static_cast<TreeItem *>(index.internalPointer());
+
+    int row = 0;
+    for (; row < dirItem->children.size(); ++row)
+    {
+        auto * item = static_cast<Item *>(dirItem->children[row]);
+        if (item->metadata().path.filename() == filename)
+            break;
+    }
+
+    if (row == dirItem->children.size())
+    {
+        if (!md)
+            return;
+        beginInsertRows(index, row, row);
+        new Item(*md, dirItem);
+        endInsertRows();
+    }
+    else if (md)
+    {
+        static_cast<Item *>(dirItem->children[row])->setMetaData(*md);
+        QModelIndex changed = this->index(row, 0, index);
+        emit dataChanged(changed, changed);
+    }
+    else
+    {
+        beginRemoveRows(index, row, row);
+        delete dirItem->children.takeAt(row);
+        endRemoveRows();
+    }
+}
+
+void Projects::projectChanged(const lt::ProjectPtr & project)
+{
+    using Directory = lt::Project::Change::Directory;
+    const QString romsDir =
+        QString::fromStdString(project->romsDirectory().string());
+    const QString tunesDir =
+        QString::fromStdString(project->tunesDirectory().string());
+
+    std::vector<lt::Project::Change> stale;
+    catchWarning([&]() {
+        for (auto & change : project->pollChanges())
+        {
+            if (change.directory == Directory::Logs)
+                continue;
+
+            const bool roms = change.directory == Directory::Roms;
+            QModelIndex index =
+                roms ? romsIndex(romsDir) : tunesIndex(tunesDir);
+            if (!index.isValid())
+                continue;
+
+            // Only the changed row is touched so the view keeps its
+            // selection and expansion
+            if (change.filename.empty() && roms)
+                refreshRoms(index);
+            else if (change.filename.empty())
+                refreshTunes(index);
+            else if (roms)
+                updateRow<RomItem>(index, change.filename,
+                                   project->romMetaData(change.filename));
+            else
+                updateRow<TuneItem>(index, change.filename,
+                                    project->tuneMetaData(change.filename));
+
+            if (change.stale)
+                stale.emplace_back(std::move(change));
+        }
+    }, tr("Error updating project"));
+
+    // After updating, as the handlers may reload the files
+    for (const auto & change : stale)
+        emit fileStale(project, change);
+}
+
 void Projects::tunesDirectoryChanged(const QString & path)
 {
     QModelIndex index = tunesIndex(path);
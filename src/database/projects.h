@@ -6,10 +6,14 @@
 
 #include <lt/project/project.h>
 
+#include <optional>
+#include <string>
+
 struct TreeItem;
 
 class Projects : public QAbstractItemModel
 {
+    Q_OBJECT
 public:
     explicit Projects(QObject * parent = nullptr);
     ~Projects() override;
@@ -38,6 +42,12 @@ public:
 
     QModelIndex tunesIndex(const QString & tunesPath);
 
+signals:
+    /* Emitted when the file of an open ROM or tune of `project` was
+     * changed or removed by another program */
+    void fileStale(const lt::ProjectPtr & project,
+                   const lt::Project::Change & change);
+
 private:
     TreeItem * root_;
     QFileSystemWatcher romsWatcher_;
@@ -46,6 +56,16 @@ private:
     void refreshRoms(const QModelIndex & index);
     void refreshTunes(const QModelIndex & index);
 
+    /* Inserts, updates or removes the row of `filename` under the ROMs or
+     * tunes directory `index` to match `md`, which is empty if the file
+     * is no longer indexed */
+    template <typename Item, typename MetaData>
+    void updateRow(const QModelIndex & index, const std::string & filename,
+                   const std::optional<MetaData> & md);
+
+    // Applies the changes reported by the project's watcher
+    void projectChanged(const lt::ProjectPtr & project);
+
 private slots:
     void romsDirectoryChanged(const QString & path);
     void tunesDirectoryChanged(const QString & path);
@@ -3,14 +3,100 @@
 #include <QColor>
 
 #include <cmath>
+#include <optional>
 
-void TableModel::setTable(lt::Table * table) noexcept
+TableModel::~TableModel()
+{
+    if (journal_ != nullptr)
+        journal_->buffer().removeObserver(this);
+}
+
+void TableModel::setTable(lt::Table * table, lt::EditJournal * journal) noexcept
 {
     beginResetModel();
+    if (journal_ != nullptr)
+        journal_->buffer().removeObserver(this);
     table_ = table;
+    journal_ = journal;
+    // Undo, redo and other editors of the tune may touch any table
+    if (journal_ != nullptr)
+        journal_->buffer().addObserver(this);
+    values_ = table_ != nullptr ? table_->getAll() : std::vector<double>();
+    stale_ = false;
+    // Hits belong to the previous table
+    hits_.reset();
+    maxHits_ = 0;
     endResetModel();
 }
 
+void TableModel::reload()
+{
+    if (table_ == nullptr)
+        return;
+
+    values_ = table_->getAll();
+    stale_ = false;
+    if (table_->width() > 0 && table_->height() > 0)
+        emit dataChanged(index(0, 0), index(table_->height() - 1, table_->width() - 1));
+}
+
+bool TableModel::editRange(const lt::CellRange & range, lt::RangeOperation operation, double argument)
+{
+    if (table_ == nullptr || range.size() == 0)
+        return false;
+
+    // One journal entry for the whole range
+    std::optional<lt::EditJournal::Group> group;
+    if (journal_ != nullptr)
+        group.emplace(*journal_);
+    if (!table_->edit(range, operation, argument).changed())
+        return false;
+    rangeChanged(range);
+    return true;
+}
+
+bool TableModel::undo() { return journal_ != nullptr && journal_->undo(); }
+
+bool TableModel::redo() { return journal_ != nullptr && journal_->redo(); }
+
+void TableModel::rangeChanged(const lt::CellRange & range)
+{
+    // Read back the stored values, which may have been rounded
+    values_ = table_->getAll();
+    stale_ = false;
+    emit dataChanged(index(range.row, range.column),
+                     index(range.row + range.rows - 1, range.column + range.columns - 1));
+}
+
+void TableModel::beforeWrite(const lt::MemoryBuffer & /*buffer*/, int /*offset*/, int /*size*/)
+{
+    if (stale_)
+        return;
+    // Writes arrive before the bytes change and often in bursts, so read
+    // the table once they are done. Edits made here read it right away.
+    stale_ = true;
+    QMetaObject::invokeMethod(this, [this]() {
+        if (stale_)
+            reload();
+    }, Qt::QueuedConnection);
+}
+
+void TableModel::setHits(lt::CellHitsPtr hits) noexcept
+{
+    hits_ = std::move(hits);
+    maxHits_ = hits_ ? hits_->maxHits() : 0;
+    if (rowCount(QModelIndex()) > 0 && columnCount(QModelIndex()) > 0)
+        emit dataChanged(index(0, 0), index(rowCount(QModelIndex()) - 1, columnCount(QModelIndex()) - 1),
+                         {Qt::BackgroundColorRole, Qt::ToolTipRole});
+}
+
+const lt::CellStats * TableModel::cellHits(const QModelIndex & index) const noexcept
+{
+    if (!hits_ || hits_->width() != table_->width() || hits_->height() != table_->height())
+        return nullptr;
+    return &hits_->at(index.row(), index.column());
+}
+
 int TableModel::rowCount(const QModelIndex & parent) const
 {
     if (table_ == nullptr || parent.isValid())
@@ -33,14 +119,14 @@ QVariant TableModel::data(const QModelIndex & index, int role) const
         return QVariant();
 
     if (role != Qt::UserRole && role != Qt::DisplayRole && role != Qt::BackgroundColorRole &&
-        role != Qt::ForegroundRole)
+        role != Qt::ForegroundRole && role != Qt::ToolTipRole)
         return QVariant();
 
     if (index.row() < 0 || index.row() >= table_->height() || index.column() < 0 || index.column() >= table_->width())
         return QVariant();
 
     if (role == Qt::DisplayRole)
-        return table_->get(index.row(), index.column());
+        return value(index);
 
     if (role == Qt::ForegroundRole)
     {
@@ -50,17 +136,34 @@ QVariant TableModel::data(const QModelIndex & index, int role) const
         return QColor(0, 0, 0);
     }
 
+    if (role == Qt::ToolTipRole)
+    {
+        const lt::CellStats * hits = cellHits(index);
+        if (hits == nullptr || hits->empty())
+            return QVariant();
+
+        QString tip = tr("Hits: %1\nDwell: %2 s").arg(hits->hits, 0, 'f', 1).arg(hits->dwell / 1000.0, 0, 'f', 2);
+        if (hits_->hasValues())
+            tip += tr("\nMean: %1 (%2 - %3)").arg(hits->mean()).arg(hits->min).arg(hits->max);
+        return tip;
+    }
+
     if (role == Qt::BackgroundColorRole)
     {
         if (table_->isScalar())
             return QVariant();
 
+        // Fade cells by hit count when overlaying hits
+        double saturation = 1.0;
+        if (const lt::CellStats * hits = cellHits(index))
+            saturation = hits->empty() || maxHits_ <= 0 ? 0.15 : 0.35 + 0.65 * (hits->hits / maxHits_);
+
         double diff = table_->maximum() - table_->minimum();
         if (diff == 0.0)
-            return QColor::fromHsvF((1.0 / 3.0), 1.0, 1.0);
-        double ratio = static_cast<double>(table_->get(index.row(), index.column()) - table_->minimum()) / diff;
+            return QColor::fromHsvF((1.0 / 3.0), saturation, 1.0);
+        double ratio = static_cast<double>(value(index) - table_->minimum()) / diff;
         ratio = std::clamp(ratio, 0.0, 1.0);
-        return QColor::fromHsvF((1.0 - ratio) * (1.0 / 3.0), 1.0, 1.0);
+        return QColor::fromHsvF((1.0 - ratio) * (1.0 / 3.0), saturation, 1.0);
     }
 
     return QVariant();
@@ -99,8 +202,7 @@ bool TableModel::setData(const QModelIndex & index, const QVariant & value, int
     if (!ok)
         return false;
 
-    table_->set(index.row(), index.column(), val);
-    emit dataChanged(index, index);
+    editRange(lt::CellRange{index.row(), index.column(), 1, 1}, lt::RangeOperation::Set, val);
     return true;
 }
 
@@ -1,17 +1,48 @@
 #ifndef TABLEMODEL_H
 #define TABLEMODEL_H
 
+#include "lt/buffer/journal.h"
+#include "lt/datalog/cellhits.h"
 #include "lt/rom/table.h"
 #include <QAbstractTableModel>
 
-class TableModel : public QAbstractTableModel
+#include <vector>
+
+class TableModel : public QAbstractTableModel, private lt::WriteObserver
 {
 public:
     TableModel() = default;
+    ~TableModel() override;
 
-    void setTable(lt::Table * table) noexcept;
+    /* Sets the table to display. If `journal` is not null, edits are
+     * recorded in the journal of the tune that owns the table and undo
+     * and redo go through it; otherwise edits cannot be undone. The
+     * cached values are then read again whenever the tune's buffer is
+     * written, by this model or not. */
+    void setTable(lt::Table * table, lt::EditJournal * journal = nullptr) noexcept;
     inline lt::Table * table() const noexcept { return table_; }
 
+    // Reads the table values again after the table changed elsewhere
+    void reload();
+
+    /* Overlays logged operating points. Cells without hits are faded and
+     * cells with hits are shaded by their hit count. Pass nullptr to
+     * remove the overlay. */
+    void setHits(lt::CellHitsPtr hits) noexcept;
+    inline const lt::CellHitsPtr & hits() const noexcept { return hits_; }
+
+    /* Applies `operation` to the cells in `range` as a single table edit
+     * with one dataChanged signal and one journal entry. Returns false if
+     * there is no table or nothing changed. */
+    bool editRange(const lt::CellRange & range, lt::RangeOperation operation, double argument = 0.0);
+
+    /* Undoes or redoes the last edit of the tune through the journal.
+     * Returns false if there is none. */
+    bool undo();
+    bool redo();
+    inline bool canUndo() const noexcept { return journal_ != nullptr && journal_->canUndo(); }
+    inline bool canRedo() const noexcept { return journal_ != nullptr && journal_->canRedo(); }
+
     virtual int rowCount(const QModelIndex & parent) const override;
     virtual int columnCount(const QModelIndex & parent) const override;
     virtual QVariant data(const QModelIndex & index, int role) const override;
@@ -23,6 +54,30 @@ public:
 
 private:
     lt::Table * table_{nullptr};
+    // Presented values of the table in row-major order. Views query
+    // cells one at a time, so the table is decoded once up front.
+    std::vector<double> values_;
+
+    // History of the tune that owns the table, if any
+    lt::EditJournal * journal_{nullptr};
+    // True if the buffer was written since values_ was read
+    bool stale_{false};
+
+    // WriteObserver of the journal's buffer. Schedules a reload.
+    void beforeWrite(const lt::MemoryBuffer & buffer, int offset, int size) override;
+
+    // Updates the cached values of `range` and notifies views
+    void rangeChanged(const lt::CellRange & range);
+    lt::CellHitsPtr hits_;
+    double maxHits_{0};
+
+    // Returns the hits of a cell or nullptr if there is no overlay
+    const lt::CellStats * cellHits(const QModelIndex & index) const noexcept;
+
+    inline double value(const QModelIndex & index) const noexcept
+    {
+        return values_[index.row() * table_->width() + index.column()];
+    }
 };
 
 #endif
@@ -18,6 +18,8 @@
 
 #include "dataloggerwindow.h"
 
+#include <QDateTime>
+#include <QFileDialog>
 #include <QHBoxLayout>
 #include <QHeaderView>
 #include <QLabel>
@@ -32,11 +34,18 @@
 #include "backgroundtask.h"
 #include "libretuner.h"
 #include "lt/datalog/datalogger.h"
+#include "lt/datalog/logfile.h"
 #include "lt/definition/platform.h"
 #include "lt/link/datalink.h"
 #include "widget/datalogliveview.h"
 #include "widget/datalogview.h"
 
+namespace
+{
+// Name of the PID of a list item. The text also shows the sample rate.
+constexpr int NameRole = Qt::UserRole + 1;
+} // namespace
+
 DataLoggerWindow::DataLoggerWindow(QWidget * parent)
     : QWidget(parent), log_(std::make_shared<lt::DataLog>())
 {
@@ -60,9 +69,16 @@ DataLoggerWindow::DataLoggerWindow(QWidget * parent)
 
     buttonLog_ = new QPushButton(tr("Start logging"));
     auto * buttonSave = new QPushButton(tr("Save log"));
+    auto * buttonOpen = new QPushButton(tr("Open log"));
 
     auto * buttonSimulate = new QPushButton(tr("Simulate"));
 
+    statusLabel_ = new QLabel;
+    statusTimer_ = new QTimer(this);
+    statusTimer_->setInterval(500);
+    connect(statusTimer_, &QTimer::timeout, this,
+            &DataLoggerWindow::updateStatus);
+
     auto * splitter = new QSplitter;
     splitter->setOrientation(Qt::Vertical);
     splitter->addWidget(dataLogView_);
@@ -70,7 +86,10 @@ DataLoggerWindow::DataLoggerWindow(QWidget * parent)
 
     auto * logLayout = new QVBoxLayout;
     logLayout->addWidget(splitter);
+    logLayout->addWidget(statusLabel_);
     logLayout->addWidget(buttonLog_);
+    logLayout->addWidget(buttonSave);
+    logLayout->addWidget(buttonOpen);
     logLayout->addWidget(buttonSimulate);
 
     // PIDs layout
@@ -90,6 +109,8 @@ DataLoggerWindow::DataLoggerWindow(QWidget * parent)
             &DataLoggerWindow::toggleLogger);
     connect(buttonSave, &QPushButton::clicked, this,
             &DataLoggerWindow::saveLog);
+    connect(buttonOpen, &QPushButton::clicked, this,
+            &DataLoggerWindow::openLog);
     connect(buttonSimulate, &QPushButton::clicked, [this]() { simulate(); });
     reset();
 }
@@ -130,7 +151,72 @@ void DataLoggerWindow::closeEvent(QCloseEvent * event)
     }
 }
 
-void DataLoggerWindow::saveLog() {}
+void DataLoggerWindow::saveLog()
+{
+    if (logger_)
+    {
+        QMessageBox::warning(this, tr("Save log"),
+                             tr("Stop the data logger before saving"));
+        return;
+    }
+
+    QString path = QFileDialog::getSaveFileName(
+        this, tr("Save log"), QString(),
+        tr("LibreTuner log (*.ltlog);;All Files (*)"));
+    if (path.isNull())
+    {
+        return;
+    }
+
+    try
+    {
+        if (!autosavePath_.empty() && std::filesystem::exists(autosavePath_))
+        {
+            // The log was already streamed to disk while recording
+            std::filesystem::copy_file(
+                autosavePath_, path.toStdString(),
+                std::filesystem::copy_options::overwrite_existing);
+        }
+        else
+        {
+            lt::DataLogWriter writer(path.toStdString());
+            writer.write(*log_);
+            writer.close();
+        }
+    }
+    catch (const std::exception & error)
+    {
+        QMessageBox::critical(this, tr("Save log"), error.what());
+    }
+}
+
+void DataLoggerWindow::openLog()
+{
+    QString path = QFileDialog::getOpenFileName(
+        this, tr("Open log"), QString(),
+        tr("LibreTuner log (*.ltlog);;All Files (*)"));
+    if (path.isNull())
+    {
+        return;
+    }
+
+    try
+    {
+        auto file = std::make_shared<lt::DataLogFile>(path.toStdString());
+        if (!file->complete())
+        {
+            QMessageBox::warning(
+                this, tr("Open log"),
+                tr("The log was not closed properly. Samples after the last "
+                   "complete chunk are missing."));
+        }
+        dataLogView_->setLogFile(std::move(file));
+    }
+    catch (const std::exception & error)
+    {
+        QMessageBox::critical(this, tr("Open log"), error.what());
+    }
+}
 
 void DataLoggerWindow::simulate()
 {
@@ -171,6 +257,17 @@ void DataLoggerWindow::toggleLogger()
         resetLog();
         logger_ = link.datalogger(*log_);
 
+        // Stream the log to disk so it survives a crash
+        std::filesystem::path logDir = LT()->rootPath() / "logs";
+        std::filesystem::create_directories(logDir);
+        autosavePath_ =
+            logDir / (QDateTime::currentDateTime()
+                          .toString("yyyyMMdd-HHmmss")
+                          .toStdString() +
+                      ".ltlog");
+        writer_ = std::make_unique<lt::DataLogWriter>(autosavePath_.string());
+        writer_->attach(*log_);
+
         // Add PIDs
         for (QListWidgetItem * item : pidItems_)
         {
@@ -194,23 +291,89 @@ void DataLoggerWindow::toggleLogger()
         BackgroundTask<void()> task([&]() { logger_->run(); });
 
         buttonLog_->setText(tr("Stop logging"));
+        statusTimer_->start();
         task();
 
-        // Catch any exceptions
-        task.future().get();
-
+        statusTimer_->stop();
+        updateStatus();
         logger_.reset();
+        clearRates();
         buttonLog_->setText(tr("Start logging"));
+        closeWriter();
+
+        // Catch any exceptions
+        task.future().get();
     }
     catch (const std::runtime_error & error)
     {
+        statusTimer_->stop();
+        logger_.reset();
+        clearRates();
+        buttonLog_->setText(tr("Start logging"));
+        try
+        {
+            closeWriter();
+        }
+        catch (const std::runtime_error &)
+        {
+        }
         QMessageBox::critical(this, "Datalog error", error.what());
     }
 }
 
+void DataLoggerWindow::updateStatus()
+{
+    if (!logger_)
+    {
+        return;
+    }
+
+    std::size_t dropped = logger_->droppedSamples();
+    statusLabel_->setText(
+        dropped == 0 ? QString()
+                     : tr("%1 samples dropped: storage fell behind")
+                           .arg(static_cast<qulonglong>(dropped)));
+
+    // Show the achieved rate of every logged PID next to its name
+    for (const lt::PidRate & rate : logger_->rates())
+    {
+        for (QListWidgetItem * item : pidItems_)
+        {
+            if (item->data(Qt::UserRole).toUInt() != rate.code)
+                continue;
+            QString name = item->data(NameRole).toString();
+            if (rate.requested > 0)
+                item->setText(tr("%1 (%2 of %3 Hz)")
+                                  .arg(name)
+                                  .arg(rate.achieved, 0, 'f', 1)
+                                  .arg(rate.requested));
+            else
+                item->setText(
+                    tr("%1 (%2 Hz)").arg(name).arg(rate.achieved, 0, 'f', 1));
+        }
+    }
+}
+
+void DataLoggerWindow::clearRates()
+{
+    for (QListWidgetItem * item : pidItems_)
+        item->setText(item->data(NameRole).toString());
+}
+
+void DataLoggerWindow::closeWriter()
+{
+    if (writer_)
+    {
+        // Reset before closing so a failed close does not leave a writer
+        auto writer = std::move(writer_);
+        writer->close();
+    }
+}
+
 void DataLoggerWindow::reset()
 {
     pidList_->clear();
+    pidItems_.clear();
 
     const lt::PlatformPtr & platform = LT()->platform();
 
@@ -224,6 +387,7 @@ void DataLoggerWindow::reset()
     {
         auto * item = new QListWidgetItem;
         item->setText(QString::fromStdString(pid.name));
+        item->setData(NameRole, QString::fromStdString(pid.name));
         item->setData(Qt::UserRole, QVariant::fromValue<uint32_t>(pid.code));
         item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
         item->setCheckState(Qt::Unchecked);
@@ -239,6 +403,7 @@ void DataLoggerWindow::reset()
 void DataLoggerWindow::resetLog()
 {
     log_ = std::make_shared<lt::DataLog>();
+    autosavePath_.clear();
 
     dataLogView_->setDataLog(log_);
     dataLogLiveView_->setDataLog(log_);
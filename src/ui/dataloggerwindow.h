@@ -23,6 +23,7 @@
 #include <QTreeWidget>
 #include <QWidget>
 
+#include <filesystem>
 #include <memory>
 #include <unordered_map>
 
@@ -32,9 +33,12 @@ namespace lt
 {
 class DataLogger;
 using DataLoggerPtr = std::unique_ptr<DataLogger>;
+class DataLogWriter;
 } // namespace lt
 
+class QLabel;
 class QListWidget;
+class QTimer;
 class QTreeWidgetItem;
 class QListWidgetItem;
 class DataLogView;
@@ -57,25 +61,41 @@ public:
 
     void resetLog();
 
+    // Returns the log being recorded or viewed
+    inline const lt::DataLogPtr & dataLog() const noexcept { return log_; }
+
 signals:
 
 public slots:
     /* Callback for the start/stop button */
     void toggleLogger();
     void saveLog();
+    void openLog();
 
 private:
     lt::DataLogPtr log_;
     lt::DataLoggerPtr logger_;
+    // Streams the running log to autosavePath_
+    std::unique_ptr<lt::DataLogWriter> writer_;
+    std::filesystem::path autosavePath_;
 
     QListWidget * pidList_;
     QPushButton * buttonLog_;
+    // Shows samples dropped while logging
+    QLabel * statusLabel_;
+    QTimer * statusTimer_;
     DataLogView * dataLogView_;
     DataLogLiveView * dataLogLiveView_;
 
     std::vector<QListWidgetItem *> pidItems_;
 
     void reset();
+    // Shows dropped samples and the sample rate of every logged PID
+    void updateStatus();
+    // Shows PID names without sample rates
+    void clearRates();
+    // Finishes the autosave file. Throws an exception on failure.
+    void closeWriter();
 };
 
 #endif // DATALOGGERWINDOW_H
@@ -125,6 +125,9 @@ void GraphWidget::refresh()
     else if (table->height() == 1 && table->width() > 1)
     {
         auto * series = new QLineSeries;
+        std::vector<double> values = table->getAll();
+        QVector<QPointF> points;
+        points.reserve(table->width());
         if (table->xAxis())
         {
             for (int x = 0; x < table->width(); ++x)
@@ -132,17 +135,17 @@ void GraphWidget::refresh()
                 double index = 0;
                 if (x < table->xAxis()->size())
                     index = table->xAxis()->index(x);
-                series->append(index,
-                               table->get(0, x)); // Should always be a float
+                points.append(QPointF(index, values[x]));
             }
         }
         else
         {
             for (int x = 0; x < table->width(); ++x)
             {
-                series->append(x, table->get(0, x)); // Should always be a float
+                points.append(QPointF(x, values[x]));
             }
         }
+        series->replace(points);
 
         chart_->removeAllSeries();
         chart_->addSeries(series);
@@ -137,6 +137,11 @@ void FlasherWindow::buttonFlashClicked()
                 return;
             }
 
+            /* Correct and verify checksums here; the tune is shared with
+             * the editors and must not be written from the task. */
+            selectedTune_->correctChecksums(true);
+            lt::FlashMap flashMap = lt::FlashMap::fromTune(*selectedTune_);
+
             // Create progress dialog
             QProgressDialog progress(tr("Flashing tune..."), tr("Abort"), 0,
                                      100, this);
@@ -153,7 +158,7 @@ void FlasherWindow::buttonFlashClicked()
 
             // Create task
             BackgroundTask<bool()> task([&]() {
-                return flasher->flash(lt::FlashMap::fromTune(*selectedTune_));
+                return flasher->flash(flashMap);
             });
 
             bool canceled = false;
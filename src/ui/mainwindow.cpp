@@ -33,6 +33,7 @@
 #include "widget/scalarview.h"
 
 #include "windows/definitionswindow.h"
+#include "windows/tunediffdialog.h"
 
 #include "datalinkswidget.h"
 #include "dataloggerwindow.h"
@@ -201,15 +202,24 @@ void MainWindow::setTune(const lt::TunePtr & tune)
 
     for (auto & [id, view] : views_)
     {
-        if (view)
-            view->close();
+        if (!view)
+            continue;
+        view->close();
+        // Views are deleted later but refer to the tables and journal of
+        // the current tune, which goes away below.
+        if (auto * tableView = dynamic_cast<TableView *>(view.data()))
+            tableView->setTable(nullptr);
+        else if (auto * scalarView = dynamic_cast<ScalarView *>(view.data()))
+            scalarView->setTable(nullptr);
     }
+    views_.clear();
 
     tune_ = tune;
     emit tuneChanged(tune_.get());
 
     flashCurrentAction_->setEnabled(!!tune);
     saveCurrentAction_->setEnabled(!!tune);
+    compareCurrentAction_->setEnabled(!!tune);
 
     if (tune)
         setWindowTitle(tr("LibreTuner") + " - " + QString::fromStdString(tune->name()));
@@ -321,7 +331,11 @@ void MainWindow::setTable(const lt::TableDefinition * table)
             {
                 auto * view = new TableView;
                 view->resize(QGuiApplication::primaryScreen()->size() * 0.5);
-                view->setTable(tab);
+                view->setTable(tab, &tune_->journal());
+                view->setLogSource([this]() {
+                    return dataLoggerWindow_ ? dataLoggerWindow_->dataLog()
+                                             : nullptr;
+                });
                 view->setAttribute(Qt::WA_DeleteOnClose);
                 view->setWindowFlag(Qt::WindowStaysOnTopHint);
                 view->show();
@@ -368,6 +382,7 @@ QDockWidget * MainWindow::createExplorerDock()
 
     explorer_ = new ExplorerWidget(dock);
     explorer_->setModel(&LT()->projects());
+    connect(&LT()->projects(), &Projects::fileStale, this, &MainWindow::fileStale);
     connect(explorer_->menu().actionNewProject(), &QAction::triggered, this, &MainWindow::newProject);
     connect(explorer_->menu().actionCreateTune(), &QAction::triggered, this, &MainWindow::openCreateTune);
     connect(explorer_, &ExplorerWidget::tuneOpened, this, &MainWindow::openTune);
@@ -501,6 +516,17 @@ void MainWindow::setupMenu()
     QAction * diagnosticsAction = toolsMenu->addAction(tr("Trouble Code Scanner"));
     connect(diagnosticsAction, &QAction::triggered, [this]() { diagnosticsWindow_.show(); });
 
+    compareCurrentAction_ = toolsMenu->addAction(tr("Compare With Base ROM"));
+    compareCurrentAction_->setEnabled(false);
+    connect(compareCurrentAction_, &QAction::triggered, [this]() {
+        if (!tune_)
+            return;
+        TuneDiffDialog dialog(this);
+        dialog.setTune(tune_);
+        connect(&dialog, &TuneDiffDialog::tableActivated, this, &MainWindow::setTable);
+        dialog.exec();
+    });
+
     setMenuBar(menuBar);
 }
 
@@ -558,6 +584,7 @@ void MainWindow::newLogClicked()
 {
     auto * window = new DataLoggerWindow;
     window->setAttribute(Qt::WA_DeleteOnClose);
+    dataLoggerWindow_ = window;
     window->setWindowModality(Qt::WindowModal);
     window->show();
 }
@@ -611,6 +638,54 @@ void MainWindow::openProject()
 
 void MainWindow::openTune(const lt::TunePtr & tune) { setTune(tune); }
 
+void MainWindow::fileStale(const lt::ProjectPtr & project,
+                           const lt::Project::Change & change)
+{
+    if (!tune_)
+        return;
+
+    using Directory = lt::Project::Change::Directory;
+    const bool isTune = change.directory == Directory::Tunes;
+    const std::filesystem::path & path =
+        isTune ? tune_->path() : tune_->base()->path();
+    const std::filesystem::path & directory =
+        isTune ? project->tunesDirectory() : project->romsDirectory();
+    if (change.directory == Directory::Logs ||
+        path.parent_path() != directory ||
+        path.filename().string() != change.filename)
+        return;
+
+    const QString name = QString::fromStdString(
+        isTune ? tune_->name() : tune_->base()->name());
+    if (change.event == lt::os::FileWatcher::Event::Removed)
+    {
+        QMessageBox::warning(
+            this, tr("File removed"),
+            isTune ? tr("The file of tune '%1' was removed by another "
+                        "program. Saving the tune writes it again.")
+                         .arg(name)
+                   : tr("The file of ROM '%1' was removed by another "
+                        "program. The tune stays open until closed.")
+                         .arg(name));
+        return;
+    }
+
+    if (QMessageBox::question(
+            this, tr("File changed"),
+            tr("The file of '%1' was changed by another program. Do you "
+               "want to reload the tune?")
+                .arg(name)) != QMessageBox::Yes)
+        return;
+
+    catchCritical(
+        [&]() {
+            std::string filename = tune_->path().filename().string();
+            if (lt::TunePtr tune = project->loadTune(filename))
+                setTune(tune);
+        },
+        tr("Error reloading tune"));
+}
+
 void MainWindow::addRecent(const QString & path)
 {
     // Check for duplicates
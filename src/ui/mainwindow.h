@@ -27,6 +27,8 @@
 #include <filesystem>
 #include <unordered_map>
 
+#include <lt/project/project.h>
+
 #include "database/links.h"
 #include "datalinkswidget.h"
 #include "models/tablemodel.h"
@@ -41,6 +43,7 @@ class TuneData;
 class SidebarWidget;
 class GraphWidget;
 class DefinitionsWindow;
+class DataLoggerWindow;
 class ExplorerWidget;
 class VehicleInformationWidget;
 
@@ -76,6 +79,9 @@ private slots:
     void newProject();
     void openProject();
     void openTune(const lt::TunePtr & tune);
+    // Offers to reload the tune if its file or base ROM file changed
+    void fileStale(const lt::ProjectPtr & project,
+                   const lt::Project::Change & change);
 
 signals:
     void tuneChanged(const lt::Tune * tune);
@@ -96,6 +102,7 @@ private:
 
     QAction * flashCurrentAction_;
     QAction * saveCurrentAction_;
+    QAction * compareCurrentAction_;
 
     // Docks
     QDockWidget * logDock_;
@@ -135,6 +142,8 @@ private:
     DiagnosticsWidget diagnosticsWindow_;
 
     QPointer<DefinitionsWindow> definitionsWindow_;
+    // Last opened logger window. Its log is overlaid on tables.
+    QPointer<DataLoggerWindow> dataLoggerWindow_;
     VehicleInformationWidget * infoWidget_{nullptr};
 
     QStringList recentProjects_;
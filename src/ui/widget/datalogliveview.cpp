@@ -1,6 +1,7 @@
 #include "datalogliveview.h"
 
 #include <QStringList>
+#include <QTimer>
 #include <QVBoxLayout>
 
 DataLogLiveView::DataLogLiveView(QWidget * parent) : QTreeWidget(parent)
@@ -10,43 +11,53 @@ DataLogLiveView::DataLogLiveView(QWidget * parent) : QTreeWidget(parent)
     QStringList headerLabels;
     headerLabels << tr("Name") << tr("Last Value");
     setHeaderLabels(headerLabels);
+
+    timer_ = new QTimer(this);
+    timer_->setInterval(RefreshInterval);
+    connect(timer_, &QTimer::timeout, this, &DataLogLiveView::refresh);
 }
 
 void DataLogLiveView::setDataLog(lt::DataLogPtr dataLog) noexcept
 {
+    feed_.reset();
     dataLog_ = std::move(dataLog);
     clear();
     pids_.clear();
 
     if (!dataLog_)
     {
-        connection_.reset();
+        timer_->stop();
         return;
     }
 
-    connection_ = dataLog_->onAdd(
-        [this](const lt::PidLog & log, const lt::PidLogEntry & entry) {
-            onAdded(log, entry);
-        });
+    feed_ = std::make_unique<lt::DataLogFeed>(*dataLog_);
+    timer_->start();
 }
 
-void DataLogLiveView::onAdded(const lt::PidLog & log,
-                              const lt::PidLogEntry & entry) noexcept
+void DataLogLiveView::refresh()
 {
-    auto it = pids_.find(log.pid.code);
-
-    QTreeWidgetItem * item;
-    if (it == pids_.end())
+    if (!feed_)
     {
-        item = new QTreeWidgetItem;
-        item->setText(0, QString::fromStdString(log.pid.name));
-        addTopLevelItem(item);
-        pids_.emplace(log.pid.code, item);
-    }
-    else
-    {
-        item = it->second;
+        return;
     }
 
-    item->setData(1, Qt::DisplayRole, entry.value);
+    feed_->drain([this](const lt::PidLog & log,
+                        const lt::PidLogEntry * entries, std::size_t count) {
+        auto it = pids_.find(log.pid.code);
+
+        QTreeWidgetItem * item;
+        if (it == pids_.end())
+        {
+            item = new QTreeWidgetItem;
+            item->setText(0, QString::fromStdString(log.pid.name));
+            addTopLevelItem(item);
+            pids_.emplace(log.pid.code, item);
+        }
+        else
+        {
+            item = it->second;
+        }
+
+        item->setData(1, Qt::DisplayRole, entries[count - 1].value);
+    });
 }
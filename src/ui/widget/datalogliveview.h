@@ -8,6 +8,9 @@
 #include <unordered_map>
 
 #include "lt/datalog/datalog.h"
+#include "lt/datalog/datalogfeed.h"
+
+class QTimer;
 
 class DataLogLiveView : public QTreeWidget
 {
@@ -17,14 +20,17 @@ public:
     void setDataLog(lt::DataLogPtr dataLog) noexcept;
 
 private:
-    lt::DataLogPtr dataLog_;
+    // Refresh interval in milliseconds (30 Hz)
+    static constexpr int RefreshInterval = 33;
 
-    lt::DataLog::AddConnectionPtr connection_;
+    lt::DataLogPtr dataLog_;
+    std::unique_ptr<lt::DataLogFeed> feed_;
+    QTimer * timer_;
 
     std::unordered_map<std::size_t, QTreeWidgetItem *> pids_;
 
-    void onAdded(const lt::PidLog & log,
-                 const lt::PidLogEntry & entry) noexcept;
+    // Shows the latest values added since the last refresh
+    void refresh();
 };
 
 #endif // DATALOGLIVEVIEW_H
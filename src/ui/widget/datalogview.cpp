@@ -2,10 +2,143 @@
 
 #include "../qcustomplot.h"
 
+#include <algorithm>
+
 #include <QCheckBox>
 #include <QListWidget>
+#include <QTimer>
 #include <QVBoxLayout>
 
+namespace
+{
+// Range of samples to draw, including one sample on each side of the
+// visible range so lines reach the edges
+template <typename Log>
+std::pair<std::size_t, std::size_t>
+visibleSamples(const Log & log, std::size_t first, std::size_t last)
+{
+    std::size_t begin = log.lowerBound(first);
+    begin = begin > 0 ? begin - 1 : 0;
+    std::size_t end = std::min(log.size(), log.lowerBound(last) + 1);
+    return {begin, std::max(begin, end)};
+}
+
+void appendEntry(QVector<QCPGraphData> & data, const lt::PidLogEntry & entry)
+{
+    data.append(QCPGraphData(entry.time / 1000.0, entry.value));
+}
+
+// Draws a bucket as its first, min, max and last values
+void appendBucket(QVector<QCPGraphData> & data, const lt::LodBucket & bucket)
+{
+    double mid = (bucket.firstTime + bucket.lastTime) / 2000.0;
+    data.append(QCPGraphData(bucket.firstTime / 1000.0, bucket.first));
+    data.append(QCPGraphData(mid, bucket.min));
+    data.append(QCPGraphData(mid, bucket.max));
+    data.append(QCPGraphData(bucket.lastTime / 1000.0, bucket.last));
+}
+
+QVector<QCPGraphData> decimate(const lt::PidLog & log, std::size_t first,
+                               std::size_t last, std::size_t maxBuckets)
+{
+    auto [begin, end] = visibleSamples(log, first, last);
+
+    QVector<QCPGraphData> data;
+    int level = log.lod().levelFor(end - begin, maxBuckets);
+    if (level == 0)
+    {
+        data.reserve(static_cast<int>(end - begin));
+        log.forEach(begin, end, [&data](const lt::PidLogEntry & entry) {
+            appendEntry(data, entry);
+        });
+        return data;
+    }
+
+    const std::vector<lt::LodBucket> & buckets = log.lod().level(level);
+    std::size_t firstBucket = begin >> level;
+    std::size_t lastBucket = std::min((end - 1) >> level, buckets.size() - 1);
+    data.reserve(static_cast<int>((lastBucket - firstBucket + 1) * 4));
+    for (std::size_t i = firstBucket; i <= lastBucket; ++i)
+    {
+        appendBucket(data, buckets[i]);
+    }
+    return data;
+}
+
+/* Log files have no pyramid. Zoomed far out, chunk summaries from the
+ * index are merged; otherwise the visible samples are bucketed. */
+QVector<QCPGraphData> decimate(const lt::DataLogFile::Channel & channel,
+                               std::size_t first, std::size_t last,
+                               std::size_t maxBuckets)
+{
+    auto [begin, end] = visibleSamples(channel, first, last);
+
+    QVector<QCPGraphData> data;
+    if (end - begin <= maxBuckets * 4)
+    {
+        data.reserve(static_cast<int>(end - begin));
+        channel.forEach(begin, end, [&data](const lt::PidLogEntry & entry) {
+            appendEntry(data, entry);
+        });
+        return data;
+    }
+
+    const std::vector<lt::DataLogFile::Chunk> & chunks = channel.chunks();
+    auto byStart = [](std::size_t index, const lt::DataLogFile::Chunk & chunk) {
+        return index < chunk.start;
+    };
+    std::size_t firstChunk = static_cast<std::size_t>(
+        std::upper_bound(chunks.begin(), chunks.end(), begin, byStart) -
+        chunks.begin() - 1);
+    std::size_t lastChunk = static_cast<std::size_t>(
+        std::upper_bound(chunks.begin(), chunks.end(), end - 1, byStart) -
+        chunks.begin() - 1);
+
+    std::size_t chunkCount = lastChunk - firstChunk + 1;
+    if (chunkCount >= maxBuckets)
+    {
+        std::size_t group = (chunkCount + maxBuckets - 1) / maxBuckets;
+        data.reserve(static_cast<int>(chunkCount / group + 1) * 4);
+        for (std::size_t i = firstChunk; i <= lastChunk; i += group)
+        {
+            lt::LodBucket bucket = chunks[i].bucket();
+            for (std::size_t j = i + 1; j < i + group && j <= lastChunk; ++j)
+            {
+                bucket.merge(chunks[j].bucket());
+            }
+            appendBucket(data, bucket);
+        }
+        return data;
+    }
+
+    std::size_t size = (end - begin + maxBuckets - 1) / maxBuckets;
+    data.reserve(static_cast<int>(maxBuckets + 1) * 4);
+
+    lt::LodBucket bucket{};
+    std::size_t count = 0;
+    channel.forEach(begin, end, [&](const lt::PidLogEntry & entry) {
+        if (count == 0)
+        {
+            bucket = lt::LodBucket::from(entry);
+        }
+        else
+        {
+            bucket.add(entry);
+        }
+        if (++count == size)
+        {
+            appendBucket(data, bucket);
+            count = 0;
+        }
+    });
+    if (count != 0)
+    {
+        appendBucket(data, bucket);
+    }
+    return data;
+}
+} // namespace
+
 DataLogView::DataLogView(QWidget * parent) : QWidget(parent)
 {
     plot_ = new QCustomPlot;
@@ -18,16 +151,29 @@ DataLogView::DataLogView(QWidget * parent) : QWidget(parent)
     // Set maximum range
     connect(plot_->xAxis, qOverload<const QCPRange &>(&QCPAxis::rangeChanged),
             this, [this](const QCPRange & newRange) {
-                if (dataLog_)
+                if (logFile_)
+                {
+                    plot_->xAxis->setRange(
+                        newRange.bounded(0, logFile_->maxTime() / 1000.0));
+                    loadVisibleRange();
+                }
+                else if (dataLog_)
                 {
                     plot_->xAxis->setRange(
                         newRange.bounded(0, dataLog_->maxTime() / 1000.0));
+                    loadVisibleRange();
                 }
             });
 
     connect(plot_->yAxis, qOverload<const QCPRange &>(&QCPAxis::rangeChanged),
             this, [this](const QCPRange & newRange) {
-                if (dataLog_)
+                if (logFile_)
+                {
+                    plot_->yAxis->setRange(
+                        newRange.bounded(logFile_->minValue() - 5.0,
+                                         logFile_->maxValue() + 5.0));
+                }
+                else if (dataLog_)
                 {
                     plot_->yAxis->setRange(
                         newRange.bounded(dataLog_->minValue() - 5.0,
@@ -35,6 +181,10 @@ DataLogView::DataLogView(QWidget * parent) : QWidget(parent)
                 }
             });
 
+    timer_ = new QTimer(this);
+    timer_->setInterval(RefreshInterval);
+    connect(timer_, &QTimer::timeout, this, &DataLogView::refresh);
+
     checkLive_ = new QCheckBox(tr("Update range with live data"));
     checkLive_->setCheckState(Qt::Checked);
 
@@ -65,41 +215,98 @@ QCPGraph * DataLogView::getOrCreateGraph(const lt::Pid & pid) noexcept
     return it->second;
 }
 
-void DataLogView::onAdded(const lt::PidLog & log,
-                          const lt::PidLogEntry & entry) noexcept
+void DataLogView::refresh()
 {
-    QMetaObject::invokeMethod(
-        this,
-        [this, log, entry] {
-            QCPGraph * graph = getOrCreateGraph(log.pid);
-            graph->addData(static_cast<double>(entry.time) / 1000.0,
-                           entry.value);
-
-            if (checkLive_->isChecked())
-            {
-                plot_->xAxis->setRange(dataLog_->maxTime() / 1000.0, 8,
-                                       Qt::AlignRight);
-            }
+    if (!dataLog_)
+    {
+        return;
+    }
+
+    // The graphs are drawn from the log, so only changes are checked here
+    std::size_t samples = dataLog_->sampleCount();
+    if (samples == shownSamples_)
+    {
+        return;
+    }
+    shownSamples_ = samples;
 
-            plot_->replot(QCustomPlot::rpQueuedReplot);
-        },
-        Qt::QueuedConnection);
+    if (checkLive_->isChecked())
+    {
+        std::size_t maxTime;
+        {
+            auto lock = dataLog_->lock();
+            maxTime = dataLog_->maxTime();
+        }
+        plot_->xAxis->setRange(maxTime / 1000.0, 8, Qt::AlignRight);
+    }
+    loadVisibleRange();
 }
 
 void DataLogView::setDataLog(lt::DataLogPtr dataLog)
 {
+    logFile_.reset();
     dataLog_ = std::move(dataLog);
+    shownSamples_ = 0;
     graphs_.clear();
     plot_->clearGraphs();
 
     if (!dataLog_)
     {
-        connection_.reset();
+        timer_->stop();
         return;
     }
 
-    connection_ = dataLog_->onAdd(
-        [this](const lt::PidLog & log, const lt::PidLogEntry & entry) {
-            onAdded(log, entry);
-        });
+    timer_->start();
+}
+
+void DataLogView::setLogFile(lt::DataLogFilePtr logFile)
+{
+    setDataLog(nullptr);
+    logFile_ = std::move(logFile);
+    if (!logFile_)
+    {
+        return;
+    }
+
+    for (const lt::DataLogFile::Channel & channel : logFile_->channels())
+    {
+        getOrCreateGraph(channel.pid());
+    }
+
+    checkLive_->setCheckState(Qt::Unchecked);
+    plot_->yAxis->setRange(logFile_->minValue() - 5.0,
+                           logFile_->maxValue() + 5.0);
+    plot_->xAxis->setRange(0, logFile_->maxTime() / 1000.0);
+    loadVisibleRange();
+}
+
+void DataLogView::loadVisibleRange()
+{
+    const QCPRange range = plot_->xAxis->range();
+    auto first = static_cast<std::size_t>(std::max(range.lower, 0.0) * 1000.0);
+    auto last = static_cast<std::size_t>(std::max(range.upper, 0.0) * 1000.0);
+
+    // One bucket per pixel
+    auto maxBuckets = static_cast<std::size_t>(std::max(plot_->width(), 100));
+
+    if (logFile_)
+    {
+        for (const lt::DataLogFile::Channel & channel : logFile_->channels())
+        {
+            getOrCreateGraph(channel.pid())
+                ->data()
+                ->set(decimate(channel, first, last, maxBuckets), true);
+        }
+    }
+    else if (dataLog_)
+    {
+        auto lock = dataLog_->lock();
+        for (const auto & [code, log] : dataLog_->logs())
+        {
+            getOrCreateGraph(log.pid)->data()->set(
+                decimate(log, first, last, maxBuckets), true);
+        }
+    }
+
+    plot_->replot(QCustomPlot::rpQueuedReplot);
 }
@@ -2,14 +2,18 @@
 #define DATALOGVIEW_H
 
 #include <QWidget>
+
+#include <memory>
 #include <unordered_map>
 
 #include "lt/datalog/datalog.h"
+#include "lt/datalog/logfile.h"
 
 class QCPGraph;
 class QCustomPlot;
 class QListWidget;
 class QCheckBox;
+class QTimer;
 
 namespace lt
 {
@@ -26,17 +30,31 @@ public:
 
     void setDataLog(lt::DataLogPtr dataLog);
 
+    /* Displays a log file. Only the samples in the visible range are
+     * read from the file. */
+    void setLogFile(lt::DataLogFilePtr logFile);
+
 private:
-    void onAdded(const lt::PidLog & log,
-                 const lt::PidLogEntry & entry) noexcept;
+    // Refresh interval in milliseconds (30 Hz)
+    static constexpr int RefreshInterval = 33;
+
+    // Redraws the graphs if samples were added since the last refresh
+    void refresh();
 
     QCPGraph * getOrCreateGraph(const lt::Pid & pid) noexcept;
 
+    /* Reloads graph data for the visible range, decimated to the
+     * plot width */
+    void loadVisibleRange();
+
     QCustomPlot * plot_;
     QCheckBox * checkLive_;
 
     lt::DataLogPtr dataLog_;
-    lt::DataLog::AddConnectionPtr connection_;
+    // Samples in the log at the last refresh
+    std::size_t shownSamples_{0};
+    QTimer * timer_;
+    lt::DataLogFilePtr logFile_;
 
     // Map PIDs to graphs
     std::unordered_map<std::size_t, QCPGraph *> graphs_;
@@ -3,12 +3,18 @@
 #include <QAbstractItemView>
 #include <QHBoxLayout>
 #include <QHeaderView>
+#include <QInputDialog>
 #include <QLabel>
+#include <QMenu>
+#include <QMessageBox>
 #include <QPainter>
 #include <QStyledItemDelegate>
 #include <QTableView>
 #include <QVBoxLayout>
 
+#include <algorithm>
+#include <limits>
+
 #include "../docks/graphwidget.h"
 
 class TableDelegate : public QStyledItemDelegate
@@ -53,6 +59,20 @@ TableView::TableView(QWidget * parent)
 
     // view_->setItemDelegate(new TableDelegate);
 
+    view_->setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(view_, &QTableView::customContextMenuRequested, this, &TableView::showContextMenu);
+
+    actionUndo_ = new QAction(tr("Undo"), this);
+    actionUndo_->setShortcut(QKeySequence::Undo);
+    actionUndo_->setShortcutContext(Qt::WidgetWithChildrenShortcut);
+    actionRedo_ = new QAction(tr("Redo"), this);
+    actionRedo_->setShortcut(QKeySequence::Redo);
+    actionRedo_->setShortcutContext(Qt::WidgetWithChildrenShortcut);
+    addAction(actionUndo_);
+    addAction(actionRedo_);
+    connect(actionUndo_, &QAction::triggered, &model_, &TableModel::undo);
+    connect(actionRedo_, &QAction::triggered, &model_, &TableModel::redo);
+
     labelY_ = new VerticalLabel("Y-Axis");
     labelY_->setAlignment(Qt::AlignCenter);
     hLayout->addWidget(labelY_);
@@ -111,9 +131,161 @@ void TableView::axesChanged()
     }
 }
 
-void TableView::setTable(lt::Table * table)
+void TableView::setTable(lt::Table * table, lt::EditJournal * journal)
 {
-    model_.setTable(table);
+    model_.setTable(table, journal);
     if (table != nullptr)
         setWindowTitle(QString::fromStdString(table->name()));
 }
+
+bool TableView::selectedRange(lt::CellRange & range) const
+{
+    QModelIndexList selected = view_->selectionModel()->selectedIndexes();
+    if (selected.isEmpty())
+        return false;
+
+    int top = selected.front().row(), bottom = top;
+    int left = selected.front().column(), right = left;
+    for (const QModelIndex & index : selected)
+    {
+        top = std::min(top, index.row());
+        bottom = std::max(bottom, index.row());
+        left = std::min(left, index.column());
+        right = std::max(right, index.column());
+    }
+    range = lt::CellRange{top, left, bottom - top + 1, right - left + 1};
+    return true;
+}
+
+void TableView::editSelection(lt::RangeOperation operation, const QString & prompt, double initial)
+{
+    lt::CellRange range;
+    if (!selectedRange(range))
+        return;
+
+    double argument = 0.0;
+    if (!prompt.isEmpty())
+    {
+        bool ok;
+        argument = QInputDialog::getDouble(this, windowTitle(), prompt, initial,
+                                           -std::numeric_limits<double>::max(),
+                                           std::numeric_limits<double>::max(), 3, &ok);
+        if (!ok)
+            return;
+    }
+
+    try
+    {
+        model_.editRange(range, operation, argument);
+    }
+    catch (const std::runtime_error & error)
+    {
+        QMessageBox::critical(this, tr("Edit error"), error.what());
+    }
+}
+
+void TableView::showContextMenu(const QPoint & point)
+{
+    if (model_.table() == nullptr)
+        return;
+
+    lt::CellRange range;
+    bool selected = selectedRange(range);
+
+    QMenu menu;
+    QAction * set = menu.addAction(tr("Set value..."));
+    QAction * add = menu.addAction(tr("Add..."));
+    QAction * multiply = menu.addAction(tr("Multiply..."));
+    QAction * percent = menu.addAction(tr("Change by percent..."));
+    menu.addSeparator();
+    QAction * interpolate = menu.addAction(tr("Interpolate"));
+    QAction * smooth = menu.addAction(tr("Smooth"));
+    for (QAction * action : {set, add, multiply, percent, interpolate, smooth})
+        action->setEnabled(selected);
+    menu.addSeparator();
+    lt::DataLogPtr log = logSource_ ? logSource_() : nullptr;
+    QAction * overlay = menu.addAction(tr("Show log hits..."));
+    overlay->setEnabled(log && !log->empty());
+    QAction * clearOverlay = menu.addAction(tr("Clear log hits"));
+    clearOverlay->setEnabled(model_.hits() != nullptr);
+    menu.addSeparator();
+    menu.addAction(actionUndo_);
+    menu.addAction(actionRedo_);
+    actionUndo_->setEnabled(model_.canUndo());
+    actionRedo_->setEnabled(model_.canRedo());
+
+    QAction * chosen = menu.exec(view_->viewport()->mapToGlobal(point));
+    actionUndo_->setEnabled(true);
+    actionRedo_->setEnabled(true);
+
+    if (chosen == set)
+        editSelection(lt::RangeOperation::Set, tr("Value:"), model_.table()->get(range.row, range.column));
+    else if (chosen == add)
+        editSelection(lt::RangeOperation::Add, tr("Amount to add:"));
+    else if (chosen == multiply)
+        editSelection(lt::RangeOperation::Multiply, tr("Factor:"), 1.0);
+    else if (chosen == percent)
+        editSelection(lt::RangeOperation::Percent, tr("Percent change:"));
+    else if (chosen == interpolate)
+        editSelection(lt::RangeOperation::Interpolate);
+    else if (chosen == smooth)
+        editSelection(lt::RangeOperation::Smooth);
+    else if (chosen == overlay)
+        showHits(*log);
+    else if (chosen == clearOverlay)
+        model_.setHits(nullptr);
+}
+
+void TableView::showHits(const lt::DataLog & log)
+{
+    lt::Table * table = model_.table();
+
+    std::vector<lt::Pid> pids;
+    {
+        auto lock = log.lock();
+        for (const auto & [code, pidLog] : log.logs())
+            pids.push_back(pidLog.pid);
+    }
+    QStringList names;
+    for (const lt::Pid & pid : pids)
+        names.append(QString::fromStdString(pid.name));
+
+    // Suggests the PID named like the axis, if any
+    auto choose = [&](const QString & prompt, const lt::Table::AxisTypePtr & axis, int & chosen) {
+        int current = 0;
+        if (axis)
+        {
+            QString name = QString::fromStdString(axis->name());
+            for (int i = 0; i < names.size(); ++i)
+            {
+                if (names[i].compare(name, Qt::CaseInsensitive) == 0)
+                    current = i;
+            }
+        }
+        bool ok;
+        QString name = QInputDialog::getItem(this, windowTitle(), prompt, names, current, false, &ok);
+        chosen = names.indexOf(name);
+        return ok && chosen != -1;
+    };
+
+    int x, y = -1;
+    if (!choose(tr("X axis PID:"), table->xAxis(), x))
+        return;
+    if (table->height() > 1 && !choose(tr("Y axis PID:"), table->yAxis(), y))
+        return;
+
+    try
+    {
+        auto hits = std::make_shared<lt::CellHits>(
+            lt::accumulateCellHits(log, *table, pids[x], y != -1 ? &pids[y] : nullptr, nullptr));
+        model_.setHits(hits);
+        if (hits->invalidSamples() != 0)
+            QMessageBox::information(this, windowTitle(),
+                                     tr("%n sample(s) were skipped because a PID was not a finite number.", "",
+                                        static_cast<int>(hits->invalidSamples())));
+    }
+    catch (const std::runtime_error & error)
+    {
+        QMessageBox::critical(this, tr("Log hits error"), error.what());
+    }
+}
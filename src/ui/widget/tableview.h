@@ -3,9 +3,12 @@
 
 #include <QWidget>
 
+#include <functional>
+
 #include "../verticallabel.h"
 #include "models/tablemodel.h"
 
+class QAction;
 class QTableView;
 class QLabel;
 class GraphWidget;
@@ -17,10 +20,16 @@ public:
     explicit TableView(QWidget * parent = nullptr);
     ~TableView() override;
 
-    void setTable(lt::Table * table);
+    // Sets the table. Edits are recorded in `journal` if it is not null.
+    void setTable(lt::Table * table, lt::EditJournal * journal = nullptr);
+
+    /* Sets where the log overlaid by "Show log hits" comes from. The
+     * source may return nullptr if no log is open. */
+    inline void setLogSource(std::function<lt::DataLogPtr()> source) { logSource_ = std::move(source); }
 
 private slots:
     void axesChanged();
+    void showContextMenu(const QPoint & point);
 
 private:
     QTableView * view_;
@@ -29,7 +38,23 @@ private:
     GraphWidget * graph_;
     QBoxLayout * layout_;
 
+    QAction * actionUndo_;
+    QAction * actionRedo_;
+
     TableModel model_;
+    std::function<lt::DataLogPtr()> logSource_;
+
+    // Returns the bounding range of the selected cells. Returns false if
+    // nothing is selected.
+    bool selectedRange(lt::CellRange & range) const;
+
+    /* Applies `operation` to the selection, asking for the argument with
+     * `prompt` if it is not empty. */
+    void editSelection(lt::RangeOperation operation, const QString & prompt = QString(), double initial = 0.0);
+
+    /* Asks for the axis PIDs and overlays where the samples of `log`
+     * fall on the table */
+    void showHits(const lt::DataLog & log);
 };
 
 #endif // LIBRETUNER_TABLEVIEW_H
@@ -0,0 +1,117 @@
+#include "tunediffdialog.h"
+
+#include "uiutil.h"
+
+#include <QDialogButtonBox>
+#include <QHeaderView>
+#include <QLabel>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+#include "lt/definition/model.h"
+#include "lt/rom/diff.h"
+
+namespace
+{
+enum Column
+{
+    ColumnName,
+    ColumnType,
+    ColumnOffset,
+    ColumnBytes,
+    ColumnEntries,
+};
+} // namespace
+
+TuneDiffDialog::TuneDiffDialog(QWidget * parent) : QDialog(parent)
+{
+    setWindowTitle(tr("Compare With Base ROM - LibreTuner"));
+    resize(600, 400);
+
+    labelSummary_ = new QLabel;
+
+    treeChanges_ = new QTreeWidget;
+    treeChanges_->setRootIsDecorated(false);
+    treeChanges_->setSortingEnabled(true);
+    treeChanges_->setHeaderLabels({tr("Name"), tr("Type"), tr("Offset"),
+                                   tr("Changed bytes"),
+                                   tr("Changed entries")});
+    treeChanges_->header()->setSectionResizeMode(ColumnName,
+                                                 QHeaderView::Stretch);
+
+    auto * buttons = new QDialogButtonBox(QDialogButtonBox::Close);
+
+    auto * layout = new QVBoxLayout;
+    layout->addWidget(labelSummary_);
+    layout->addWidget(treeChanges_);
+    layout->addWidget(buttons);
+    setLayout(layout);
+
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    connect(treeChanges_, &QTreeWidget::itemDoubleClicked, this,
+            [this](QTreeWidgetItem * item) { itemActivated(item); });
+}
+
+void TuneDiffDialog::setTune(const lt::TunePtr & tune)
+{
+    tune_ = tune;
+    treeChanges_->clear();
+    labelSummary_->clear();
+    if (!tune_)
+        return;
+
+    catchCritical(
+        [&]() {
+            lt::TuneDiff diff = lt::diffTune(*tune_);
+            const lt::ModelPtr & model = tune_->base()->model();
+
+            labelSummary_->setText(
+                tr("%1 bytes differ in %2 tables and axes; %3 bytes are "
+                   "outside of every definition.")
+                    .arg(diff.changedBytes)
+                    .arg(diff.definitions.size())
+                    .arg(diff.unattributedBytes));
+
+            for (const lt::DefinitionDiff & change : diff.definitions)
+            {
+                QString name = QString::fromStdString(change.id);
+                if (!change.axis)
+                {
+                    if (const lt::TableDefinition * table =
+                            model->getTable(change.id))
+                        name = QString::fromStdString(table->name);
+                }
+
+                auto * item = new QTreeWidgetItem;
+                item->setText(ColumnName, name);
+                item->setData(ColumnName, Qt::UserRole,
+                              QString::fromStdString(change.id));
+                item->setText(ColumnType,
+                              change.axis ? tr("Axis") : tr("Table"));
+                item->setData(ColumnType, Qt::UserRole, change.axis);
+                // Padded so the column sorts by offset
+                item->setText(ColumnOffset, QStringLiteral("0x%1").arg(
+                                                change.offset, 8, 16,
+                                                QLatin1Char('0')));
+                item->setData(ColumnBytes, Qt::DisplayRole,
+                              change.changedBytes);
+                item->setData(ColumnEntries, Qt::DisplayRole,
+                              change.changedEntries);
+                treeChanges_->addTopLevelItem(item);
+            }
+            treeChanges_->sortByColumn(ColumnOffset, Qt::AscendingOrder);
+        },
+        tr("Error comparing tune"));
+}
+
+void TuneDiffDialog::itemActivated(QTreeWidgetItem * item)
+{
+    if (!tune_ || item->data(ColumnType, Qt::UserRole).toBool())
+        return;
+
+    std::string id =
+        item->data(ColumnName, Qt::UserRole).toString().toStdString();
+    if (const lt::TableDefinition * table =
+            tune_->base()->model()->getTable(id))
+        emit tableActivated(table);
+}
@@ -0,0 +1,40 @@
+#ifndef LIBRETUNER_TUNEDIFFDIALOG_H
+#define LIBRETUNER_TUNEDIFFDIALOG_H
+
+#include <QDialog>
+
+#include "lt/rom/rom.h"
+
+class QLabel;
+class QTreeWidget;
+class QTreeWidgetItem;
+
+namespace lt
+{
+struct TableDefinition;
+}
+
+/* Lists the tables and axes of a tune that differ from its base ROM */
+class TuneDiffDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit TuneDiffDialog(QWidget * parent = nullptr);
+
+    // Compares `tune` with its base ROM and shows the changes
+    void setTune(const lt::TunePtr & tune);
+
+signals:
+    // Emitted when a changed table is double clicked
+    void tableActivated(const lt::TableDefinition * table);
+
+private:
+    lt::TunePtr tune_;
+
+    QLabel * labelSummary_;
+    QTreeWidget * treeChanges_;
+
+    void itemActivated(QTreeWidgetItem * item);
+};
+
+#endif // LIBRETUNER_TUNEDIFFDIALOG_H